@@ -14,6 +14,9 @@ namespace xserializer::io_functions
     {
         xerr Err;
 
+        // The texel layout is not serialized, only row major bitmaps can go through
+        assert( Bitmap.getLayout() == xbitmap::texel_layout::LINEAR );
+
         false
         || (Err = Stream.Serialize(reinterpret_cast<const std::byte* const&>(Bitmap.m_pData), Bitmap.m_DataSize, mem_type{ .m_bUnique = true } ))
         || (Err = Stream.Serialize(Bitmap.m_DataSize))
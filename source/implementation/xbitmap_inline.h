@@ -27,6 +27,52 @@ namespace xbitmap_details
         return x < 1 ? 0 : Log2Int(x) + 1; 
     }
 
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Spreads the low 16 bits of a value to the even bits, half of a Morton code
+    //------------------------------------------------------------------------------
+    constexpr std::uint32_t MortonSpread( std::uint32_t V ) noexcept
+    {
+        V &= 0xffff;
+        V  = ( V | ( V << 8 ) ) & 0x00ff00ff;
+        V  = ( V | ( V << 4 ) ) & 0x0f0f0f0f;
+        V  = ( V | ( V << 2 ) ) & 0x33333333;
+        V  = ( V | ( V << 1 ) ) & 0x55555555;
+        return V;
+    }
+
+    //------------------------------------------------------------------------------
+    // Description:
+    //      Index of texel (x, y) in a W x H mip stored with the given layout.
+    //      Morton interleaves the bits of the shorter side and stacks the squares
+    //      along the longer one. Tiles at the right and bottom edges are as small
+    //      as the mip requires so no space is wasted.
+    //------------------------------------------------------------------------------
+    constexpr std::uint32_t getTexelIndex( const xbitmap::texel_layout Layout, const std::uint32_t x, const std::uint32_t y, const std::uint32_t W, const std::uint32_t H ) noexcept
+    {
+        switch( Layout )
+        {
+        case xbitmap::texel_layout::MORTON:
+        {
+            const auto Small = std::min( W, H );
+            const auto Mask  = Small - 1;
+            return ( MortonSpread( x & Mask ) | ( MortonSpread( y & Mask ) << 1 ) ) + ( ( x | y ) & ~Mask ) * Small;
+        }
+        case xbitmap::texel_layout::TILED_4X4:
+        case xbitmap::texel_layout::TILED_8X8:
+        {
+            const std::uint32_t T  = Layout == xbitmap::texel_layout::TILED_4X4 ? 4 : 8;
+            const auto          X0 = x & ~( T - 1 );
+            const auto          Y0 = y & ~( T - 1 );
+            const auto          TW = std::min( T, W - X0 );
+            const auto          TH = std::min( T, H - Y0 );
+            return Y0 * W + X0 * TH + ( y - Y0 ) * TW + ( x - X0 );
+        }
+        default:
+            return y * W + x;
+        }
+    }
+
     //------------------------------------------------------------------------------
     template< class T > constexpr
     bool isPowTwo(const T x) noexcept
@@ -77,12 +123,14 @@ void xbitmap::Kill(void) noexcept
 {
     if (m_pData && m_Flags.m_bOwnsMemory) delete m_pData;
 
+    m_pData         = nullptr;
     m_DataSize      = 0;
     m_FaceSize      = 0;
     m_Height        = 0;
     m_Width         = 0;
     m_Flags.m_Value = 0;
     m_nMips         = 0;
+    m_Layout        = texel_layout::LINEAR;
 }
 
 //-----------------------------------------------------------------------------------
@@ -167,6 +215,20 @@ xbitmap::color_space xbitmap::getColorSpace( void ) const noexcept
     return static_cast<xbitmap::color_space>(m_Flags.m_bLinearSpace);
 }
 
+//-----------------------------------------------------------------------------------
+constexpr
+xbitmap::texel_layout xbitmap::getLayout( void ) const noexcept
+{
+    return m_Layout;
+}
+
+//-----------------------------------------------------------------------------------
+
+std::uint32_t xbitmap::getTexelIndex( const std::uint32_t x, const std::uint32_t y, const int iMip ) const noexcept
+{
+    return xbitmap_details::getTexelIndex( m_Layout, x, y, std::max( 1u, std::uint32_t(m_Width) >> iMip ), std::max( 1u, std::uint32_t(m_Height) >> iMip ) );
+}
+
 //-----------------------------------------------------------------------------------
 
 constexpr
@@ -289,8 +351,9 @@ std::uint32_t xbitmap::getMipSize( int iMip ) const noexcept
 
 int xbitmap::getFullMipChainCount( void ) const noexcept
 {
-    const auto SmallerDimension  = std::min( m_Height, m_Width );
-    const auto nMips             = xbitmap_details::Log2IntRoundUp( SmallerDimension ) + 1;
+    // Every level halves (rounding down) until both sides reach 1 texel
+    const auto LargerDimension   = std::max( m_Height, m_Width );
+    const auto nMips             = xbitmap_details::Log2Int( LargerDimension ) + 1;
     return nMips;
 }
 
@@ -364,3 +427,38 @@ bool xbitmap::isPowerOfTwo( void ) const noexcept
     assert( m_Height > 0 );
     return xbitmap_details::isPowTwo( m_Width ) && xbitmap_details::isPowTwo( m_Height );
 }
+
+//-------------------------------------------------------------------------------
+
+template< typename T >
+template< typename U >
+std::span<U> xbitmap::basic_view<T>::getRow( const std::uint32_t y ) const noexcept
+{
+    static_assert( std::is_const_v<T> == false || std::is_const_v<U>, "Rows of a const view must be const" );
+    assert( y < m_Height );
+    return { reinterpret_cast<U*>( m_pData + std::size_t(y) * m_RowPitch ), std::size_t(m_Width) * m_TexelSize / sizeof(U) };
+}
+
+//-------------------------------------------------------------------------------
+
+template< typename T >
+xbitmap::basic_view<T> xbitmap::basic_view<T>::getSubView( const rect& Rect ) const noexcept
+{
+    assert( Rect.m_Left <= Rect.m_Right  && Rect.m_Right  <= m_Width  );
+    assert( Rect.m_Top  <= Rect.m_Bottom && Rect.m_Bottom <= m_Height );
+
+    auto View = *this;
+    View.m_pData  = m_pData + std::size_t(Rect.m_Top) * m_RowPitch + std::size_t(Rect.m_Left) * m_TexelSize;
+    View.m_Width  = Rect.m_Right  - Rect.m_Left;
+    View.m_Height = Rect.m_Bottom - Rect.m_Top;
+    return View;
+}
+
+//-------------------------------------------------------------------------------
+
+template< typename T >
+constexpr
+xbitmap::basic_view<T>::operator xbitmap::basic_view<const std::byte>( void ) const noexcept
+{
+    return { m_pData, m_Width, m_Height, m_RowPitch, m_TexelSize, m_Format };
+}
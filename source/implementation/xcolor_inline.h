@@ -11,6 +11,16 @@ namespace xcolor
         template< typename T >
         using to_uint_t = byte_size_uint_t<sizeof(T)>;
 
+        //------------------------------------------------------------------------------
+        // Computes round( A * B / 255 ) exactly for 8 bit values without a division.
+        // (the same trick used by the SIMD kernels in xbitmap)
+        //------------------------------------------------------------------------------
+        constexpr std::uint8_t MulDiv255( std::uint32_t A, std::uint32_t B ) noexcept
+        {
+            const std::uint32_t T = A * B + 128u;
+            return static_cast<std::uint8_t>( (T + (T >> 8)) >> 8 );
+        }
+
         namespace endian
         {
             //------------------------------------------------------------------------------
@@ -591,10 +601,11 @@ namespace xcolor
     {
         if constexpr (std::is_integral_v<T>)
         {
-            parent_t::m_A = static_cast<element>(std::min(0xffu, std::max(0u, std::uint32_t(parent_t::m_A) * C.m_A)));
-            parent_t::m_R = static_cast<element>(std::min(0xffu, std::max(0u, std::uint32_t(parent_t::m_R) * C.m_R)));
-            parent_t::m_G = static_cast<element>(std::min(0xffu, std::max(0u, std::uint32_t(parent_t::m_G) * C.m_G)));
-            parent_t::m_B = static_cast<element>(std::min(0xffu, std::max(0u, std::uint32_t(parent_t::m_B) * C.m_B)));
+            // Normalized multiply, 255 * 255 == 255
+            parent_t::m_A = details::MulDiv255(parent_t::m_A, C.m_A);
+            parent_t::m_R = details::MulDiv255(parent_t::m_R, C.m_R);
+            parent_t::m_G = details::MulDiv255(parent_t::m_G, C.m_G);
+            parent_t::m_B = details::MulDiv255(parent_t::m_B, C.m_B);
         }
         else
         {
@@ -1,8 +1,10 @@
 #include "../../source/xbitmap.h"
 #include "../../source/unit_test/xcolor_unittest.h"
+#include "../../source/unit_test/xbitmap_unittest.h"
 
 int main()
 {
     xcolor::unit_test::Test();
+    xbitmap_unit_test::Test();
     return 0;
 }
@@ -0,0 +1,1550 @@
+#include <array>
+#include <cmath>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace xbitmap_unit_test
+{
+    template<typename T>
+    bool approx_equal(T a, T b, T epsilon = 0.0001)
+    {
+        return std::abs(a - b) < epsilon;
+    }
+
+    void Test()
+    {
+        // Normal maps
+        {
+            std::cout << "\nTesting xbitmap normal maps\n";
+            // Flat height gives straight up normals
+            {
+                xbitmap Height;
+                Height.CreateBitmap(8, 8);
+                for (auto& C : Height.getMip<xcolori>(0)) C = xcolori(100, 100, 100, 255);
+
+                xbitmap Normal;
+                Height.CreateNormalMapFromHeight(Normal);
+                for (const auto& C : Normal.getMip<xcolori>(0))
+                {
+                    assert(C == xcolori{}.setupFromNormal({ 0.0f, 0.0f, 1.0f }));
+                }
+            }
+            // A ramp going up to the right and wrapping around
+            {
+                xbitmap Height;
+                Height.CreateBitmap(16, 4);
+                Height.setUWrapMode(xbitmap::wrap_mode::CLAMP_TO_EDGE);
+                auto Data = Height.getMip<xcolori>(0);
+                for (auto y = 0u; y < 4; ++y)
+                for (auto x = 0u; x < 16; ++x)
+                {
+                    const auto H = static_cast<std::uint8_t>(x * 16);
+                    Data[x + y * 16] = xcolori(H, H, H, 255);
+                }
+
+                xbitmap Normal;
+                Height.CreateNormalMapFromHeight(Normal, 4.0f, xbitmap::normal_kernel::SCHARR);
+                const auto N = Normal.getMip<xcolori>(0)[5 + 16].getNormal();
+                assert(N[0] < -0.1f);
+                assert(approx_equal(N[1], 0.0f, 0.01f));
+                assert(N[2] > 0.5f);
+                assert(Normal.getUWrapMode() == xbitmap::wrap_mode::CLAMP_TO_EDGE);
+            }
+            // Bulk pack/unpack match the per color functions
+            {
+                std::vector<std::array<float, 3>> Normals(37);
+                for (auto i = 0u; i < Normals.size(); ++i)
+                {
+                    const float a = i * 0.3f;
+                    Normals[i] = { std::cos(a) * 0.6f, std::sin(a) * 0.6f, 0.8f };
+                }
+
+                std::vector<xcolori> Colors(Normals.size());
+                xbitmap::PackNormals(Colors, Normals);
+                for (auto i = 0u; i < Normals.size(); ++i)
+                {
+                    assert(Colors[i] == xcolori{}.setupFromNormal(Normals[i]));
+                }
+
+                std::vector<std::array<float, 3>> Unpacked(Normals.size());
+                xbitmap::UnpackNormals(Unpacked, Colors);
+                for (auto i = 0u; i < Normals.size(); ++i)
+                {
+                    assert(approx_equal(Unpacked[i][0], Colors[i].getNormal()[0]));
+                    assert(approx_equal(Unpacked[i][2], Colors[i].getNormal()[2]));
+                }
+
+                xbitmap::UnpackNormalsXY(Unpacked, Colors);
+                for (auto i = 0u; i < Normals.size(); ++i)
+                {
+                    assert(approx_equal(Unpacked[i][2], 0.8f, 0.02f));
+                }
+            }
+            // Reconstruct Z of a two channel normal map
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(5, 3);
+                for (auto& C : Bitmap.getMip<xcolori>(0)) C = xcolori{}.setupFromNormal({ 0.6f, 0.0f, 0.0f });
+                Bitmap.ReconstructNormalZ();
+                for (const auto& C : Bitmap.getMip<xcolori>(0))
+                {
+                    assert(approx_equal(C.getNormal()[2], 0.8f, 0.02f));
+                    assert(C.m_A == 255);
+                }
+            }
+        }
+        // Saturating arithmetic
+        {
+            std::cout << "\nTesting xbitmap arithmetic\n";
+            auto Fill = [](xbitmap& B, std::uint32_t Seed)
+            {
+                for (auto& C : B.getMip<xcolori>(0))
+                {
+                    Seed = Seed * 1664525u + 1013904223u;
+                    C.m_Value = Seed;
+                }
+            };
+
+            xbitmap A, B;
+            A.CreateBitmap(13, 7);
+            B.CreateBitmap(13, 7);
+            Fill(A, 1);
+            Fill(B, 2);
+
+            std::vector<xcolori> Expected(A.getMip<xcolori>(0).begin(), A.getMip<xcolori>(0).end());
+            A.Add(B);
+            for (auto i = 0u; i < Expected.size(); ++i) { auto C = Expected[i]; C += B.getMip<xcolori>(0)[i]; assert(A.getMip<xcolori>(0)[i] == C); Expected[i] = C; }
+            A.Subtract(B);
+            for (auto i = 0u; i < Expected.size(); ++i) { auto C = Expected[i]; C -= B.getMip<xcolori>(0)[i]; assert(A.getMip<xcolori>(0)[i] == C); Expected[i] = C; }
+            A.Multiply(B);
+            for (auto i = 0u; i < Expected.size(); ++i) { auto C = Expected[i]; C *= B.getMip<xcolori>(0)[i]; assert(A.getMip<xcolori>(0)[i] == C); Expected[i] = C; }
+
+            A.Multiply(xcolori(255, 255, 255, 255));
+            for (auto i = 0u; i < Expected.size(); ++i) assert(A.getMip<xcolori>(0)[i] == Expected[i]);
+
+            A.Add(xcolori(0, 0, 0, 255));
+            for (const auto& C : A.getMip<xcolori>(0)) assert(C.m_A == 255);
+
+            A.ScaleBias(xcolorf(0.0f, 1.0f, 1.0f, 1.0f), xcolorf(0.5f, 0.0f, 0.0f, -1.0f));
+            for (auto i = 0u; i < Expected.size(); ++i)
+            {
+                const auto& C = A.getMip<xcolori>(0)[i];
+                assert(C.m_R == 128);
+                assert(C.m_G == Expected[i].m_G);
+                assert(C.m_A == 0);
+            }
+
+            // Sources shorter than 16 bytes, a whole bitmap and the rows of a view
+            xbitmap TinyA, TinyB;
+            TinyA.CreateBitmap(1, 1, xbitmap::format::R8);
+            TinyB.CreateBitmap(1, 1, xbitmap::format::R8);
+            TinyA.getMip<std::uint8_t>(0)[0] = 200;
+            TinyB.getMip<std::uint8_t>(0)[0] = 100;
+            TinyA.Add(TinyB);
+            assert(TinyA.getMip<std::uint8_t>(0)[0] == 255);
+
+            xbitmap NarrowA, NarrowB;
+            NarrowA.CreateBitmap(3, 2, xbitmap::format::R8);
+            NarrowB.CreateBitmap(3, 2, xbitmap::format::R8);
+            for (auto& V : NarrowA.getMip<std::uint8_t>(0)) V = 50;
+            for (auto& V : NarrowB.getMip<std::uint8_t>(0)) V = 20;
+            xbitmap::Subtract(NarrowA.getView(), NarrowB.getView());
+            for (const auto V : NarrowA.getMip<std::uint8_t>(0)) assert(V == 30);
+        }
+        // Mip generation
+        {
+            std::cout << "\nTesting xbitmap mip generation\n";
+            // Chain length
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(256, 64);
+                assert(Bitmap.getFullMipChainCount() == 9);
+                Bitmap.CreateBitmap(300, 7);
+                assert(Bitmap.getFullMipChainCount() == 9);
+            }
+            // Box filter of a 32 bit bitmap
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(16, 8);
+                Bitmap.setUWrapMode(xbitmap::wrap_mode::MIRROR);
+                Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+                auto Data = Bitmap.getMip<xcolori>(0);
+                for (auto y = 0u; y < 8; ++y)
+                for (auto x = 0u; x < 16; ++x)
+                {
+                    Data[x + y * 16] = xcolori(std::uint8_t(x * 16), std::uint8_t(y * 32), ((x ^ y) & 1) ? 255 : 0, 255);
+                }
+
+                Bitmap.GenerateMips();
+                assert(Bitmap.getMipCount() == 5);
+                assert(Bitmap.getUWrapMode() == xbitmap::wrap_mode::MIRROR);
+
+                const auto Mip1 = Bitmap.getMip<xcolori>(1);
+                assert(Mip1.size() == 8 * 4);
+                for (auto y = 0u; y < 4; ++y)
+                for (auto x = 0u; x < 8; ++x)
+                {
+                    const auto& C = Mip1[x + y * 8];
+                    assert(C.m_R == (x * 32 + x * 32 + 16 + x * 32 + x * 32 + 16 + 2) / 4);
+                    assert(C.m_G == (y * 64 * 2 + (y * 64 + 32) * 2 + 2) / 4);
+                    assert(C.m_B == 128);
+                    assert(C.m_A == 255);
+                }
+
+                const auto Last = Bitmap.getMip<xcolori>(4);
+                assert(Last.size() == 1);
+                assert(Last[0].m_B == 128);
+            }
+            // Cube maps with float texels
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(4, 4, xbitmap::format::R32G32B32A32_FLOAT, 1, 2, true);
+                assert(Bitmap.getFaceCount() == 6);
+                assert(Bitmap.getFrameCount() == 2);
+                for (int iFrame = 0; iFrame < 2; ++iFrame)
+                for (int iFace = 0; iFace < 6; ++iFace)
+                {
+                    auto Data = Bitmap.getMip<float>(0, iFace, iFrame);
+                    for (auto i = 0u; i < Data.size(); ++i) Data[i] = float(iFace + iFrame * 10) + ((i / 4) & 1);
+                }
+
+                Bitmap.GenerateMips();
+                assert(Bitmap.getMipCount() == 3);
+                for (int iFrame = 0; iFrame < 2; ++iFrame)
+                for (int iFace = 0; iFace < 6; ++iFace)
+                {
+                    for (auto V : Bitmap.getMip<float>(2, iFace, iFrame)) assert(approx_equal(V, float(iFace + iFrame * 10) + 0.5f));
+                }
+            }
+        }
+        // Gamma correct mips
+        {
+            std::cout << "\nTesting xbitmap sRGB mips\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(8, 8);
+            assert(Bitmap.getColorSpace() == xbitmap::color_space::SRGB);
+            auto Data = Bitmap.getMip<xcolori>(0);
+            for (auto y = 0u; y < 8; ++y)
+            for (auto x = 0u; x < 8; ++x)
+            {
+                const std::uint8_t V = ((x ^ y) & 1) ? 255 : 0;
+                Data[x + y * 8] = xcolori(V, V, 100, V);
+            }
+
+            Bitmap.GenerateMips();
+            for (int iMip = 1; iMip < Bitmap.getMipCount(); ++iMip)
+            {
+                for (const auto& C : Bitmap.getMip<xcolori>(iMip))
+                {
+                    // Half black half white is linear 0.5, which is 188 in sRGB; alpha is not gamma encoded
+                    assert(C.m_R >= 187 && C.m_R <= 188);
+                    assert(C.m_G == C.m_R);
+                    assert(C.m_B >= 99 && C.m_B <= 101);
+                    assert(C.m_A == 128);
+                }
+            }
+        }
+        // Separable mip filters
+        {
+            std::cout << "\nTesting xbitmap mip filters\n";
+            for (auto Filter : { xbitmap::mip_filter::KAISER, xbitmap::mip_filter::LANCZOS3, xbitmap::mip_filter::MITCHELL })
+            {
+                xbitmap::mip_settings Settings;
+                Settings.m_Filter = Filter;
+
+                // A flat color stays flat, even in sRGB
+                {
+                    xbitmap Bitmap;
+                    Bitmap.CreateBitmap(32, 16);
+                    for (auto& C : Bitmap.getMip<xcolori>(0)) C = xcolori(200, 100, 50, 255);
+                    Bitmap.GenerateMips(Settings);
+                    assert(Bitmap.getMipCount() == 6);
+                    for (int iMip = 1; iMip < Bitmap.getMipCount(); ++iMip)
+                    for (const auto& C : Bitmap.getMip<xcolori>(iMip))
+                    {
+                        assert(std::abs(int(C.m_R) - 200) <= 1);
+                        assert(std::abs(int(C.m_G) - 100) <= 1);
+                        assert(std::abs(int(C.m_B) - 50) <= 1);
+                        assert(C.m_A == 255);
+                    }
+                }
+
+                // Symmetric kernels keep a ramp a ramp away from the borders
+                {
+                    xbitmap Bitmap;
+                    Bitmap.CreateBitmap(32, 4, xbitmap::format::R32_FLOAT);
+                    auto Data = Bitmap.getMip<float>(0);
+                    for (auto i = 0u; i < Data.size(); ++i) Data[i] = float(i % 32);
+                    Bitmap.GenerateMips(Settings, 2);
+
+                    const auto Mip1 = Bitmap.getMip<float>(1);
+                    for (auto y = 0u; y < 2; ++y)
+                    for (auto x = 4u; x < 12; ++x) assert(approx_equal(Mip1[x + y * 16], 2.0f * x + 0.5f, 0.01f));
+                }
+
+                // The clamp color bleeds into the borders
+                {
+                    xbitmap Edge, Color;
+                    Edge.CreateBitmap(16, 16);
+                    Color.CreateBitmap(16, 16);
+                    for (auto& C : Edge.getMip<xcolori>(0))  C = xcolori(255, 255, 255, 255);
+                    for (auto& C : Color.getMip<xcolori>(0)) C = xcolori(255, 255, 255, 255);
+                    Color.setUWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR);
+                    Color.m_ClampColor = xcolori(0, 0, 0, 255);
+
+                    Edge.GenerateMips(Settings, 2);
+                    Color.GenerateMips(Settings, 2);
+                    assert(Edge.getMip<xcolori>(1)[0].m_R == 255);
+                    assert(Color.getMip<xcolori>(1)[0].m_R < 255);
+                    assert(Color.getMip<xcolori>(1)[0].m_R == Color.getMip<xcolori>(1)[7].m_R);
+                    assert(Color.getMip<xcolori>(1)[3].m_R >= 254);
+                }
+            }
+        }
+        // Non power of two mips
+        {
+            std::cout << "\nTesting xbitmap NPOT mips\n";
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(5, 1, xbitmap::format::R32_FLOAT);
+                auto Data = Bitmap.getMip<float>(0);
+                for (auto i = 0u; i < 5; ++i) Data[i] = float(1 << i);
+                Bitmap.GenerateMips();
+                assert(Bitmap.getMipCount() == 3);
+
+                const auto Mip1 = Bitmap.getMip<float>(1);
+                assert(approx_equal(Mip1[0], (2 * 1.0f + 2 * 2.0f + 1 * 4.0f) / 5));
+                assert(approx_equal(Mip1[1], (1 * 4.0f + 2 * 8.0f + 2 * 16.0f) / 5));
+
+                // Every source texel counts the same, so the total is preserved
+                assert(approx_equal(Bitmap.getMip<float>(2)[0], 31.0f / 5));
+            }
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(7, 3);
+                Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+                auto Data = Bitmap.getMip<xcolori>(0);
+                for (auto y = 0u; y < 3; ++y)
+                for (auto x = 0u; x < 7; ++x) Data[x + y * 7] = xcolori(x == 6 ? 255 : 0, y == 2 ? 255 : 0, 90, 255);
+                Bitmap.GenerateMips();
+                assert(Bitmap.getMipCount() == 3);
+
+                // The last column and row are not dropped
+                const auto Mip1 = Bitmap.getMip<xcolori>(1);
+                assert(Mip1.size() == 3);
+                assert(Mip1[0].m_R == 0 && Mip1[2].m_R == 109);
+                for (const auto& C : Mip1)
+                {
+                    assert(C.m_G == 85);
+                    assert(C.m_B == 90);
+                }
+            }
+        }
+        // Alpha coverage
+        {
+            std::cout << "\nTesting xbitmap alpha coverage\n";
+            const auto getCoverage = [](std::span<const xcolori> Colors, float Reference)
+            {
+                std::size_t Count = 0;
+                for (const auto& C : Colors) Count += C.m_A > Reference * 255;
+                return float(Count) / float(Colors.size());
+            };
+
+            xbitmap::mip_settings Settings;
+            Settings.m_AlphaReference = 0.7f;
+
+            for (bool bPreserve : { false, true })
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(64, 64);
+                std::uint32_t Seed = 1234;
+                for (auto& C : Bitmap.getMip<xcolori>(0))
+                {
+                    Seed = Seed * 1664525u + 1013904223u;
+                    C = xcolori(10, 200, 30, std::uint8_t(Seed >> 24));
+                }
+
+                Settings.m_bPreserveAlphaCoverage = bPreserve;
+                Bitmap.GenerateMips(Settings);
+
+                const auto Target = getCoverage(Bitmap.getMip<xcolori>(0), Settings.m_AlphaReference);
+                for (int iMip = 1; iMip < 4; ++iMip)
+                {
+                    const auto Coverage = getCoverage(Bitmap.getMip<xcolori>(iMip), Settings.m_AlphaReference);
+                    if (bPreserve) assert(std::abs(Coverage - Target) < 0.05f);
+                    else           assert(Coverage < Target * 0.5f);
+
+                    // Color is not touched
+                    assert(Bitmap.getMip<xcolori>(iMip)[0].m_G == 200);
+                }
+            }
+
+            // Float formats
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(32, 32, xbitmap::format::R32G32B32A32_FLOAT);
+                auto Data = Bitmap.getMip<float>(0);
+                std::uint32_t Seed = 99;
+                for (auto i = 3u; i < Data.size(); i += 4)
+                {
+                    Seed = Seed * 1664525u + 1013904223u;
+                    Data[i] = float(Seed >> 8) / float(1 << 24);
+                }
+
+                Settings.m_bPreserveAlphaCoverage = true;
+                Bitmap.GenerateMips(Settings, 3);
+
+                const auto getFloatCoverage = [&](std::span<const float> Texels)
+                {
+                    std::size_t Count = 0;
+                    for (auto i = 3u; i < Texels.size(); i += 4) Count += Texels[i] > Settings.m_AlphaReference;
+                    return float(Count) / float(Texels.size() / 4);
+                };
+                const auto Target = getFloatCoverage(Bitmap.getMip<float>(0));
+                assert(std::abs(getFloatCoverage(Bitmap.getMip<float>(2)) - Target) < 0.05f);
+            }
+        }
+        // Normal map mips
+        {
+            std::cout << "\nTesting xbitmap normal map mips\n";
+            for (const auto Size : { 16u, 6u })
+            {
+                xbitmap Bitmap, Toksvig;
+                Bitmap.CreateBitmap(Size, Size);
+                Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+                auto Data = Bitmap.getMip<xcolori>(0);
+                for (auto y = 0u; y < Size; ++y)
+                for (auto x = 0u; x < Size; ++x)
+                {
+                    Data[x + y * Size].setupFromNormal(std::array<float, 3>{ ((x ^ y) & 1) ? 0.6f : -0.6f, 0, 0.8f });
+                }
+
+                xbitmap::mip_settings Settings;
+                Settings.m_bNormalMap     = true;
+                Settings.m_ToksvigPower   = 4;
+                Settings.m_ToksvigChannel = 3;
+                Settings.m_pToksvigBitmap = &Toksvig;
+                Bitmap.GenerateMips(Settings, 2);
+
+                assert(Toksvig.getMipCount() == 2);
+                assert(Toksvig.getFormat() == xbitmap::format::R8);
+                for (auto F : Toksvig.getMip<std::uint8_t>(0)) assert(F == 255);
+                assert(Bitmap.getMip<xcolori>(0)[0].m_A == 255);
+
+                // The average (0, 0, 0.8) comes back as a unit normal, the lost length is the variance
+                const auto Factor = std::uint8_t(0.8f / (0.8f + 4 * 0.2f) * 255 + 0.5f);
+                for (const auto& C : Bitmap.getMip<xcolori>(1))
+                {
+                    assert(std::abs(int(C.m_R) - 127) <= 1);
+                    assert(C.m_G == 127);
+                    assert(C.m_B == 254);
+                    assert(std::abs(int(C.m_A) - Factor) <= 2);
+                }
+                for (auto F : Toksvig.getMip<std::uint8_t>(1)) assert(std::abs(int(F) - Factor) <= 2);
+            }
+        }
+        // Seamless cube map mips
+        {
+            std::cout << "\nTesting xbitmap seamless cube map mips\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(8, 8, xbitmap::format::R32G32B32A32_FLOAT, 1, 1, true);
+            for (int iFace = 0; iFace < 6; ++iFace)
+            {
+                auto Data = Bitmap.getMip<float>(0, iFace);
+                for (auto i = 0u; i < Data.size(); ++i) Data[i] = (i % 4) == 3 ? 1.0f : float(iFace * 10 + (i % 4));
+            }
+
+            xbitmap::mip_settings Settings;
+            Settings.m_bSeamlessCubemap = true;
+            Bitmap.GenerateMips(Settings);
+            assert(Bitmap.getMipCount() == 4);
+
+            for (int iMip = 1; iMip < 3; ++iMip)
+            {
+                const auto Size  = 8u >> iMip;
+                const auto Last  = Size - 1;
+                const auto Texel = [&](int iFace, std::uint32_t x, std::uint32_t y) { return &Bitmap.getMip<float>(iMip, iFace)[(x + y * Size) * 4]; };
+
+                for (auto i = 0u; i < Size; ++i)
+                {
+                    // +Z right edge is the +X left edge, +Y bottom edge is the +Z top edge
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        assert(approx_equal(Texel(4, Last, i)[c], Texel(0, 0, i)[c]));
+                        assert(approx_equal(Texel(2, i, Last)[c], Texel(4, i, 0)[c]));
+                    }
+                }
+
+                // The +X +Y +Z corner
+                for (int c = 0; c < 3; ++c)
+                {
+                    assert(approx_equal(Texel(4, Last, 0)[c], Texel(0, 0, 0)[c]));
+                    assert(approx_equal(Texel(4, Last, 0)[c], Texel(2, Last, Last)[c]));
+                }
+
+                // Away from the edges each face keeps its color, alpha stays 1
+                if (Size >= 4) assert(approx_equal(Texel(5, 1, 1)[0], 50.0f));
+                for (int iFace = 0; iFace < 6; ++iFace) assert(approx_equal(Texel(iFace, 0, 0)[3], 1.0f));
+            }
+        }
+        // GGX prefiltered specular
+        {
+            std::cout << "\nTesting xbitmap GGX specular cube map\n";
+            for (auto Format : { xbitmap::format::R32G32B32A32_FLOAT, xbitmap::format::R16G16B16A16_SFLOAT })
+            {
+                xbitmap Flat, Sky;
+                Flat.CreateBitmap(16, 16, Format, 1, 1, true);
+                Sky.CreateBitmap(16, 16, xbitmap::format::R32G32B32A32_FLOAT, 1, 1, true);
+                for (int iFace = 0; iFace < 6; ++iFace)
+                {
+                    if (Format == xbitmap::format::R32G32B32A32_FLOAT) for (auto& V : Flat.getMip<float>(0, iFace)) V = 2.0f;
+                    else                                               for (auto& V : Flat.getMip<std::uint16_t>(0, iFace)) V = 0x4000; // 2.0 in half
+                    for (auto& V : Sky.getMip<float>(0, iFace)) V = iFace == 2 ? 10.0f : 0.0f;
+                }
+
+                // A constant environment stays constant at every roughness
+                xbitmap Dest;
+                Flat.CreateGGXSpecularCubemap(Dest, 5, 32);
+                assert(Dest.getMipCount() == 5 && Dest.isCubemap() && Dest.getFormat() == Format);
+                for (int iMip = 0; iMip < 5; ++iMip)
+                for (int iFace = 0; iFace < 6; ++iFace)
+                {
+                    if (Format == xbitmap::format::R32G32B32A32_FLOAT) { for (auto V : Dest.getMip<float>(iMip, iFace)) assert(approx_equal(V, 2.0f, 0.001f)); }
+                    else                                               { for (auto V : Dest.getMip<std::uint16_t>(iMip, iFace)) assert(V == 0x4000); }
+                }
+
+                // A bright sky spreads more with roughness
+                Sky.CreateGGXSpecularCubemap(Dest, 5, 64);
+                const auto Center = [&](int iMip, int iFace) { const auto S = 16u >> iMip; return Dest.getMip<float>(iMip, iFace)[((S / 2) * S + S / 2) * 4]; };
+                assert(approx_equal(Center(0, 2), 10.0f));
+                assert(Center(4, 2) < Center(1, 2));
+                assert(Center(4, 2) > 0.0f);
+                assert(Center(1, 4) < Center(4, 4));
+                assert(approx_equal(Center(4, 3), 0.0f));
+            }
+        }
+        // Spherical harmonics
+        {
+            std::cout << "\nTesting xbitmap SH9\n";
+            xbitmap Cube, Equirect;
+            Cube.CreateBitmap(16, 16, xbitmap::format::R32G32B32A32_FLOAT, 1, 1, true);
+            Equirect.CreateBitmap(128, 64, xbitmap::format::R32G32B32A32_FLOAT);
+
+            // Constant radiance of 1 only has the DC term, 4pi * Y00, and irradiance pi
+            for (int iFace = 0; iFace < 6; ++iFace) for (auto& V : Cube.getMip<float>(0, iFace)) V = 1.0f;
+            for (auto& V : Equirect.getMip<float>(0)) V = 1.0f;
+
+            for (const auto* pBitmap : { &Cube, &Equirect })
+            {
+                const auto SH = pBitmap->ProjectSH9();
+                assert(approx_equal(SH[0][0], 3.544908f, 0.01f));
+                for (int i = 1; i < 9; ++i) assert(approx_equal(SH[i][1], 0.0f, 0.01f));
+
+                xbitmap Irradiance;
+                Irradiance.CreateIrradianceCubemap(SH, 8);
+                assert(Irradiance.isCubemap() && Irradiance.getWidth() == 8);
+                for (int iFace = 0; iFace < 6; ++iFace)
+                for (auto i = 0u; i < 8 * 8 * 4; i += 4)
+                {
+                    assert(approx_equal(Irradiance.getMip<float>(0, iFace)[i], 3.14159f, 0.02f));
+                    assert(Irradiance.getMip<float>(0, iFace)[i + 3] == 1.0f);
+                }
+            }
+
+            // Light from above, both layouts agree
+            for (int iFace = 0; iFace < 6; ++iFace) for (auto& V : Cube.getMip<float>(0, iFace)) V = iFace == 2 ? 1.0f : 0.0f;
+            auto Data = Equirect.getMip<float>(0);
+            for (auto i = 0u; i < Data.size(); ++i) Data[i] = (i / 4 / 128) < 16 ? 1.0f : 0.0f;
+
+            const auto A = Cube.ProjectSH9();
+            const auto B = Equirect.ProjectSH9();
+            assert(A[1][0] > 0.5f);
+            assert(approx_equal(A[3][0], 0.0f, 0.01f) && approx_equal(A[2][0], 0.0f, 0.01f));
+            assert(approx_equal(B[3][0], 0.0f, 0.01f) && approx_equal(B[2][0], 0.0f, 0.01f));
+            assert(B[1][0] > 0.5f);
+
+            xbitmap Irradiance;
+            Irradiance.CreateIrradianceCubemap(A, 4, xbitmap::format::R16G16B16A16_SFLOAT);
+            assert(Irradiance.getFormat() == xbitmap::format::R16G16B16A16_SFLOAT);
+        }
+        // Incremental mips
+        {
+            std::cout << "\nTesting xbitmap incremental mips\n";
+            for (const auto Size : { std::array<std::uint32_t, 2>{ 64, 64 }, std::array<std::uint32_t, 2>{ 37, 20 } })
+            {
+                xbitmap Full, Partial;
+                for (auto* p : { &Full, &Partial })
+                {
+                    p->CreateBitmap(Size[0], Size[1]);
+                    auto Data = p->getMip<xcolori>(0);
+                    for (auto i = 0u; i < Data.size(); ++i) Data[i] = xcolori(std::uint8_t(i * 7), std::uint8_t(i * 13), std::uint8_t(i), 255);
+                    p->GenerateMips();
+                }
+
+                // Paint two spots
+                const xbitmap::rect Spots[] = { { 3, 4, 9, 7 }, { 20, 10, 31, 19 } };
+                for (auto* p : { &Full, &Partial })
+                {
+                    auto Data = p->getMip<xcolori>(0);
+                    for (const auto& R : Spots)
+                    for (auto y = R.m_Top; y < R.m_Bottom; ++y)
+                    for (auto x = R.m_Left; x < R.m_Right; ++x) Data[x + y * Size[0]] = xcolori(255, 0, 255, 0);
+                }
+
+                Full.GenerateMips();
+
+                xbitmap_mip_updater Updater;
+                for (const auto& R : Spots) Updater.MarkDirty(R);
+                assert(Updater.getPending().size() == 2);
+                Updater.Flush(Partial);
+                Updater.Wait();
+                assert(Updater.isBusy() == false);
+
+                for (int iMip = 0; iMip < Full.getMipCount(); ++iMip)
+                {
+                    const auto A = Full.getMip<std::uint32_t>(iMip);
+                    const auto B = Partial.getMip<std::uint32_t>(iMip);
+                    assert(std::equal(A.begin(), A.end(), B.begin()));
+                }
+            }
+
+            // Empty rectangles touch no mip
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(16, 16);
+                for (auto& C : Bitmap.getMip<xcolori>(0)) C = xcolori(255, 255, 255, 255);
+                Bitmap.GenerateMips();
+                for (int iMip = 1; iMip < Bitmap.getMipCount(); ++iMip)
+                    for (auto& C : Bitmap.getMip<xcolori>(iMip)) C = xcolori(1, 2, 3, 4);
+
+                const xbitmap::rect Empty[] = { { 5, 5, 5, 9 }, { 2, 7, 10, 7 }, { 20, 0, 30, 4 } };
+                Bitmap.RegenerateMips(Empty);
+                for (int iMip = 1; iMip < Bitmap.getMipCount(); ++iMip)
+                    for (const auto& C : Bitmap.getMip<xcolori>(iMip)) assert(C.m_Value == xcolori(1, 2, 3, 4).m_Value);
+            }
+
+            // Touching rectangles are merged
+            xbitmap_mip_updater Updater;
+            Updater.MarkDirty({ 0, 0, 4, 4 });
+            Updater.MarkDirty({ 10, 10, 12, 12 });
+            Updater.MarkDirty({ 4, 2, 10, 3 });
+            assert(Updater.getPending().size() == 2);
+            Updater.MarkDirty({ 9, 3, 11, 10 });
+            assert(Updater.getPending().size() == 1);
+            assert(Updater.getPending()[0].m_Right == 12 && Updater.getPending()[0].m_Bottom == 12);
+        }
+        // Alpha bleeding
+        {
+            std::cout << "\nTesting xbitmap alpha bleeding\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(40, 30);
+            auto Data = Bitmap.getMip<xcolori>(0);
+            for (auto& C : Data) C = xcolori(0, 0, 0, 0);
+
+            struct site { std::uint32_t x, y; xcolori C; };
+            const site Sites[] = { { 3, 4, xcolori(255, 0, 0, 255) }, { 30, 5, xcolori(0, 255, 0, 10) }, { 20, 25, xcolori(0, 0, 255, 128) } };
+            for (const auto& S : Sites) Data[S.x + S.y * 40] = S.C;
+
+            Bitmap.BleedAlpha();
+
+            for (std::uint32_t y = 0; y < 30; ++y)
+            for (std::uint32_t x = 0; x < 40; ++x)
+            {
+                // Brute force nearest site
+                std::uint32_t Best = ~0u, BestDist = ~0u, Tie = 0;
+                for (std::uint32_t i = 0; i < 3; ++i)
+                {
+                    const auto dx = int(x) - int(Sites[i].x), dy = int(y) - int(Sites[i].y);
+                    const auto d  = std::uint32_t(dx * dx + dy * dy);
+                    if (d < BestDist) { BestDist = d; Best = i; Tie = 0; }
+                    else if (d == BestDist) Tie = 1;
+                }
+
+                const auto& C = Data[x + y * 40];
+                if (BestDist == 0) { assert(C.m_Value == Sites[Best].C.m_Value); continue; }
+                assert(C.m_A == 0);
+                if (Tie == 0) assert(C.m_R == Sites[Best].C.m_R && C.m_G == Sites[Best].C.m_G && C.m_B == Sites[Best].C.m_B);
+            }
+        }
+        // Resize
+        {
+            std::cout << "\nTesting xbitmap resize\n";
+            for (auto Filter : { xbitmap::mip_filter::BOX, xbitmap::mip_filter::KAISER, xbitmap::mip_filter::LANCZOS3, xbitmap::mip_filter::MITCHELL })
+            {
+                xbitmap Bitmap, Dest;
+                Bitmap.CreateBitmap(64, 48);
+                for (auto& C : Bitmap.getMip<xcolori>(0)) C = xcolori(10, 120, 240, 255);
+                Bitmap.setUWrapMode(xbitmap::wrap_mode::WRAP);
+
+                Bitmap.CreateResizedBitmap(Dest, 23, 97, Filter);
+                assert(Dest.getWidth() == 23 && Dest.getHeight() == 97 && Dest.getMipCount() == 1);
+                assert(Dest.getUWrapMode() == xbitmap::wrap_mode::WRAP);
+                for (const auto& C : Dest.getMip<xcolori>(0))
+                {
+                    assert(std::abs(int(C.m_R) - 10) <= 1 && std::abs(int(C.m_G) - 120) <= 1 && std::abs(int(C.m_B) - 240) <= 1 && C.m_A == 255);
+                }
+
+                // Upsampling a ramp keeps it in order
+                xbitmap Ramp;
+                Ramp.CreateBitmap(16, 1, xbitmap::format::R32_FLOAT);
+                auto Data = Ramp.getMip<float>(0);
+                for (auto i = 0u; i < 16; ++i) Data[i] = float(i);
+                Ramp.CreateResizedBitmap(Dest, 64, 3, Filter);
+                const auto Out = Dest.getMip<float>(0);
+                for (auto i = 9u; i < 54; ++i) assert(Out[i] <= Out[i + 1] + 0.001f);
+            }
+
+            // Transparent texels do not darken the result unless the alpha is premultiplied
+            {
+                xbitmap Bitmap, Dest;
+                Bitmap.CreateBitmap(2, 1);
+                Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+                Bitmap.getMip<xcolori>(0)[0] = xcolori(255, 255, 255, 255);
+                Bitmap.getMip<xcolori>(0)[1] = xcolori(0, 0, 0, 0);
+
+                Bitmap.CreateResizedBitmap(Dest, 1, 1, xbitmap::mip_filter::BOX);
+                assert(Dest.getMip<xcolori>(0)[0].m_R == 255 && Dest.getMip<xcolori>(0)[0].m_A == 128);
+
+                Bitmap.m_Flags.m_bAlphaPremultiplied = true;
+                Bitmap.CreateResizedBitmap(Dest, 1, 1, xbitmap::mip_filter::BOX);
+                assert(Dest.getMip<xcolori>(0)[0].m_R == 128 && Dest.getMip<xcolori>(0)[0].m_A == 128);
+            }
+        }
+        // Rotation
+        {
+            std::cout << "\nTesting xbitmap rotation\n";
+            for (auto Format : { xbitmap::format::R8G8B8A8, xbitmap::format::R8, xbitmap::format::R32G32B32_FLOAT })
+            for (auto Size : { std::array<std::uint32_t, 2>{ 5, 3 }, std::array<std::uint32_t, 2>{ 70, 37 } })
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(Size[0], Size[1], Format, 2, 2);
+                Bitmap.setUWrapMode(xbitmap::wrap_mode::WRAP);
+                std::size_t Counter = 0;
+                for (int iFrame = 0; iFrame < 2; ++iFrame)
+                for (int iMip = 0; iMip < 2; ++iMip)
+                    for (auto& B : Bitmap.getMip<std::byte>(iMip, 0, iFrame)) { B = std::byte(Counter * 7 + Counter / 251); ++Counter; }
+
+                const auto TexelSize = Bitmap.getMip<std::byte>(0).size() / (Size[0] * Size[1]);
+                auto Texel = [&](const xbitmap& B, int iMip, int iFrame, std::uint32_t x, std::uint32_t y)
+                {
+                    const auto W = std::max(1u, B.getWidth() >> iMip);
+                    return &B.getMip<std::byte>(iMip, 0, iFrame)[(x + y * W) * TexelSize];
+                };
+
+                for (int iRot = 0; iRot < 4; ++iRot)
+                {
+                    xbitmap Rotated;
+                    Rotated.CreateBitmap(Size[0], Size[1], Format, 2, 2);
+                    Rotated.setUWrapMode(xbitmap::wrap_mode::WRAP);
+                    for (int iFrame = 0; iFrame < 2; ++iFrame)
+                    for (int iMip = 0; iMip < 2; ++iMip)
+                        std::ranges::copy(Bitmap.getMip<std::byte>(iMip, 0, iFrame), Rotated.getMip<std::byte>(iMip, 0, iFrame).begin());
+                    if (iRot == 3) Rotated.Transpose();
+                    else           Rotated.Rotate(xbitmap::rotation(iRot));
+
+                    const bool bSwap = iRot != 1;
+                    assert(Rotated.getWidth() == (bSwap ? Size[1] : Size[0]) && Rotated.getHeight() == (bSwap ? Size[0] : Size[1]));
+                    assert(Rotated.getVWrapMode() == (bSwap ? xbitmap::wrap_mode::WRAP : xbitmap::wrap_mode::CLAMP_TO_EDGE));
+
+                    for (int iFrame = 0; iFrame < 2; ++iFrame)
+                    for (int iMip = 0; iMip < 2; ++iMip)
+                    {
+                        const auto W = std::max(1u, Size[0] >> iMip), H = std::max(1u, Size[1] >> iMip);
+                        for (std::uint32_t y = 0; y < H; ++y)
+                        for (std::uint32_t x = 0; x < W; ++x)
+                        {
+                            std::uint32_t dx = 0, dy = 0;
+                            switch (iRot)
+                            {
+                            case 0: dx = H - 1 - y; dy = x;         break;
+                            case 1: dx = W - 1 - x; dy = H - 1 - y; break;
+                            case 2: dx = y;         dy = W - 1 - x; break;
+                            case 3: dx = y;         dy = x;         break;
+                            }
+                            assert(std::memcmp(Texel(Rotated, iMip, iFrame, dx, dy), Texel(Bitmap, iMip, iFrame, x, y), TexelSize) == 0);
+                        }
+                    }
+                }
+            }
+        }
+        // Flip in Y
+        {
+            std::cout << "\nTesting xbitmap flip in Y\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(37, 21, xbitmap::format::R16G16B16A16_SFLOAT, 3, 2);
+            for (int iFrame = 0; iFrame < 2; ++iFrame)
+            for (int iMip = 0; iMip < 3; ++iMip)
+            {
+                // Mips are only 4 byte aligned, the 8 byte texels go through memcpy
+                auto Data = Bitmap.getMip<std::byte>(iMip, 0, iFrame);
+                for (std::size_t i = 0; i < Data.size() / 8; ++i)
+                {
+                    const std::uint64_t Value = i * 0x9E3779B97F4A7C15ull + iFrame;
+                    std::memcpy(&Data[i * 8], &Value, 8);
+                }
+            }
+
+            Bitmap.FlipImageInY();
+            for (int iFrame = 0; iFrame < 2; ++iFrame)
+            for (int iMip = 0; iMip < 3; ++iMip)
+            {
+                const auto W = std::max(1u, 37u >> iMip), H = std::max(1u, 21u >> iMip);
+                const auto Data = Bitmap.getMip<const std::byte>(iMip, 0, iFrame);
+                for (std::uint32_t y = 0; y < H; ++y)
+                for (std::uint32_t x = 0; x < W; ++x)
+                {
+                    std::uint64_t Value;
+                    std::memcpy(&Value, &Data[(x + y * W) * 8], 8);
+                    assert(Value == (x + (H - 1 - y) * W) * 0x9E3779B97F4A7C15ull + iFrame);
+                }
+            }
+
+            // BC4 indices are 3 bits per texel, 12 bits per row; an 8x8 BC5 has two channels and two block rows
+            auto Pack = [](std::uint8_t* pBlock, auto Index)
+            {
+                std::uint64_t Bits = 0;
+                for (int i = 0; i < 16; ++i) Bits |= std::uint64_t(Index(i % 4, i / 4) & 7) << (3 * i);
+                for (int i = 0; i < 6; ++i) pBlock[2 + i] = std::uint8_t(Bits >> (8 * i));
+            };
+            auto Unpack = [](const std::uint8_t* pBlock, int x, int y)
+            {
+                std::uint64_t Bits = 0;
+                for (int i = 0; i < 6; ++i) Bits |= std::uint64_t(pBlock[2 + i]) << (8 * i);
+                return int((Bits >> (3 * (x + y * 4))) & 7);
+            };
+
+            xbitmap BC;
+            BC.CreateBitmap(8, 8, xbitmap::format::BC5_8RG, 3);
+            auto Blocks = BC.getMip<std::uint8_t>(0);
+            for (int b = 0; b < 8; ++b)
+            {
+                Blocks[b * 8] = std::uint8_t(b);
+                Pack(&Blocks[b * 8], [&](int x, int y) { return x + y * 2 + b; });
+            }
+            auto Small = BC.getMip<std::uint8_t>(2);
+            Pack(&Small[0], [](int x, int y) { return x + y * 3; });
+
+            BC.FlipImageInY();
+            for (int b = 0; b < 8; ++b)
+            {
+                const int Src = (b / 4) * 4 == 0 ? b + 4 : b - 4;       // Block rows swap, 2 blocks of 16 bytes per row
+                assert(Blocks[b * 8] == Src);
+                for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                    assert(Unpack(&Blocks[b * 8], x, y) == ((x + (3 - y) * 2 + Src) & 7));
+            }
+
+            // The 2x2 mip only flips its two visible rows
+            for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                assert(Unpack(&Small[0], x, y) == ((x + (y < 2 ? 1 - y : y) * 3) & 7));
+
+            // A 12 tall texture has a 6 tall mip; its block rows get encoded again. With every
+            // block spanning the full range the end points survive and so do the indices
+            xbitmap Partial;
+            Partial.CreateBitmap(8, 12, xbitmap::format::BC5_8RG, 2);
+            auto Mip = Partial.getMip<std::uint8_t>(1);
+            auto Pattern = [](int Part, int x, int y) { return (x + y * 2 + Part * 4) & 7; };
+            for (int b = 0; b < 2; ++b)
+            for (int Part = 0; Part < 2; ++Part)
+            {
+                auto pBlock = &Mip[b * 16 + Part * 8];
+                pBlock[0] = 255;
+                pBlock[1] = 0;
+                Pack(pBlock, [&](int x, int y) { return Pattern(Part, x, b * 4 + y); });
+            }
+
+            Partial.FlipImageInY();
+            for (int b = 0; b < 2; ++b)
+            for (int Part = 0; Part < 2; ++Part)
+            {
+                const auto pBlock = &Mip[b * 16 + Part * 8];
+                assert(pBlock[0] == 255 && pBlock[1] == 0);
+                for (int y = 0; y < 4 && b * 4 + y < 6; ++y)
+                for (int x = 0; x < 4; ++x)
+                    assert(Unpack(pBlock, x, y) == Pattern(Part, x, 5 - (b * 4 + y)));
+            }
+
+            // Blocks that do not span the full range are fit again, which is lossy. BC4: one 8 value
+            // block and one 6 value block (indices below 6), every value within [40, 200]
+            auto DecodeBC4 = [&](const std::uint8_t* pBlock, int x, int y)
+            {
+                const int A0 = pBlock[0], A1 = pBlock[1], i = Unpack(pBlock, x, y);
+                if (i < 2)   return i ? A1 : A0;
+                if (A0 > A1) return ((8 - i) * A0 + (i - 1) * A1 + 3) / 7;
+                if (i < 6)   return ((6 - i) * A0 + (i - 1) * A1 + 2) / 5;
+                return i == 6 ? 0 : 255;
+            };
+
+            xbitmap Ranged;
+            Ranged.CreateBitmap(4, 6, xbitmap::format::BC4_4R, 1);
+            auto R = Ranged.getMip<std::uint8_t>(0);
+            R[0] = 200; R[1] = 40;
+            Pack(&R[0], [](int x, int y) { return (x * 3 + y) & 7; });
+            R[8] = 90; R[9] = 150;
+            Pack(&R[8], [](int x, int y) { return (x + y * 2) % 6; });
+
+            int Before[6][4];
+            for (int y = 0; y < 6; ++y)
+            for (int x = 0; x < 4; ++x) Before[y][x] = DecodeBC4(&R[(y / 4) * 8], x, y % 4);
+
+            Ranged.FlipImageInY();
+            for (int y = 0; y < 6; ++y)
+            for (int x = 0; x < 4; ++x)
+                assert(std::abs(DecodeBC4(&R[(y / 4) * 8], x, y % 4) - Before[5 - y][x]) <= 12);
+
+            // BC1 without alpha: a 3 color block keeps its black texels black, the rest is fit again
+            auto DecodeBC1 = [](const std::uint8_t* pBlock, int x, int y)
+            {
+                auto Expand = [](int C) { return std::array<int, 3>{ ((C >> 11) & 31) * 255 / 31, ((C >> 5) & 63) * 255 / 63, (C & 31) * 255 / 31 }; };
+                const int  C0 = pBlock[0] | pBlock[1] << 8, C1 = pBlock[2] | pBlock[3] << 8;
+                const auto E0 = Expand(C0), E1 = Expand(C1);
+                const int  i  = (pBlock[4 + y] >> (2 * x)) & 3;
+
+                std::array<int, 3> C;
+                for (int c = 0; c < 3; ++c)
+                {
+                    if (i < 2)         C[c] = i ? E1[c] : E0[c];
+                    else if (C0 > C1)  C[c] = i == 2 ? (2 * E0[c] + E1[c] + 1) / 3 : (E0[c] + 2 * E1[c] + 1) / 3;
+                    else               C[c] = i == 2 ? (E0[c] + E1[c] + 1) / 2 : 0;
+                }
+                return C;
+            };
+            auto To565 = [](int R, int G, int B) { return std::uint16_t((R * 31 / 255) << 11 | (G * 63 / 255) << 5 | (B * 31 / 255)); };
+
+            xbitmap Color;
+            Color.CreateBitmap(4, 6, xbitmap::format::BC1_4RGB, 1);
+            auto C = Color.getMip<std::uint8_t>(0);
+            const std::uint16_t Ends[] = { To565(150, 120, 60), To565(100, 110, 90), To565(90, 100, 70), To565(140, 130, 80) };
+            for (int b = 0; b < 2; ++b)
+            {
+                C[b * 8 + 0] = std::uint8_t(Ends[b * 2]);
+                C[b * 8 + 1] = std::uint8_t(Ends[b * 2] >> 8);
+                C[b * 8 + 2] = std::uint8_t(Ends[b * 2 + 1]);
+                C[b * 8 + 3] = std::uint8_t(Ends[b * 2 + 1] >> 8);
+                for (int y = 0; y < 4; ++y) C[b * 8 + 4 + y] = std::uint8_t(b ? 0xE4 >> (y & 1) * 2 : 0x1B << (y & 1) * 2);
+            }
+            assert((C[8] | C[9] << 8) <= (C[10] | C[11] << 8));                 // The second block is in 3 color mode
+
+            std::array<int, 3> Colors[6][4];
+            for (int y = 0; y < 6; ++y)
+            for (int x = 0; x < 4; ++x) Colors[y][x] = DecodeBC1(&C[(y / 4) * 8], x, y % 4);
+
+            Color.FlipImageInY();
+            for (int y = 0; y < 6; ++y)
+            for (int x = 0; x < 4; ++x)
+            {
+                const auto  Got      = DecodeBC1(&C[(y / 4) * 8], x, y % 4);
+                const auto& Expected = Colors[5 - y][x];
+                if (Expected == std::array<int, 3>{ 0, 0, 0 }) assert(Got == Expected);
+                else for (int c = 0; c < 3; ++c) assert(std::abs(Got[c] - Expected[c]) <= 16);
+            }
+        }
+        // Views
+        {
+            std::cout << "\nTesting xbitmap views\n";
+            xbitmap A, B;
+            A.CreateBitmap(16, 12);
+            B.CreateBitmap(16, 12);
+            auto DataA = A.getMip<xcolori>(0);
+            auto DataB = B.getMip<xcolori>(0);
+            for (std::uint32_t i = 0; i < DataA.size(); ++i)
+            {
+                DataA[i] = xcolori(std::uint8_t(i), 10, 20, 255);
+                DataB[i] = xcolori(1, 2, 3, 4);
+            }
+
+            const xbitmap::rect Rect{ 3, 2, 10, 7 };
+            auto SubA = A.getView().getSubView(Rect);
+            assert(SubA.m_Width == 7 && SubA.m_Height == 5 && SubA.m_RowPitch == 16 * 4);
+            assert(SubA.getRow<xcolori>(1)[2].m_Value == DataA[5 + 3 * 16].m_Value);
+
+            // Blend one window into another, the rest of the bitmap is left alone
+            xbitmap::Add(B.getView().getSubView({ 0, 0, 7, 5 }), SubA);
+            for (std::uint32_t y = 0; y < 12; ++y)
+            for (std::uint32_t x = 0; x < 16; ++x)
+            {
+                const auto& C = DataB[x + y * 16];
+                if (x < 7 && y < 5) assert(C.m_R == std::uint8_t(DataA[x + 3 + (y + 2) * 16].m_R + 1) && C.m_G == 12 && C.m_A == 255);
+                else                assert(C.m_Value == xcolori(1, 2, 3, 4).m_Value);
+            }
+
+            // Flip a window in place
+            xbitmap::FlipImageInY(SubA);
+            for (std::uint32_t y = 0; y < 12; ++y)
+            for (std::uint32_t x = 0; x < 16; ++x)
+            {
+                const bool bInside = x >= 3 && x < 10 && y >= 2 && y < 7;
+                const auto i       = bInside ? x + (8 - y) * 16 : x + y * 16;
+                assert(DataA[x + y * 16].m_R == std::uint8_t(i));
+            }
+
+            // Resize a window into a window
+            xbitmap::Resize(B.getView().getSubView({ 8, 6, 12, 8 }), A.getView().getSubView({ 0, 8, 16, 12 }), xbitmap::mip_filter::BOX);
+            assert(DataB[7 + 6 * 16].m_Value == xcolori(1, 2, 3, 4).m_Value && DataB[12 + 6 * 16].m_Value == xcolori(1, 2, 3, 4).m_Value);
+            for (std::uint32_t y = 6; y < 8; ++y)
+            for (std::uint32_t x = 8; x < 12; ++x)
+                assert(DataB[x + y * 16].m_G == 10 && DataB[x + y * 16].m_A == 255);
+        }
+        // Blit
+        {
+            std::cout << "\nTesting xbitmap blit\n";
+            xbitmap Src;
+            Src.CreateBitmap(9, 7);
+            auto SrcData = Src.getMip<xcolori>(0);
+            for (std::uint32_t i = 0; i < SrcData.size(); ++i) SrcData[i] = xcolori(std::uint8_t(i * 3), std::uint8_t(i * 5), std::uint8_t(i * 7), std::uint8_t(i * 11));
+
+            const xbitmap::rect SrcRect{ 1, 2, 8, 6 };
+            for (auto Format : { xbitmap::format::R8G8B8A8, xbitmap::format::B8G8R8A8, xbitmap::format::A8R8G8B8, xbitmap::format::R32G32B32A32_FLOAT, xbitmap::format::R16G16B16A16 })
+            for (bool bPremultiply : { false, true })
+            for (bool bFlip : { false, true })
+            {
+                xbitmap Dest;
+                Dest.CreateBitmap(10, 10, Format);
+                xbitmap::Blit(Dest, { 2, 3, 9, 7 }, Src, SrcRect, { bPremultiply, bFlip });
+
+                // Back to RGBA8 to compare
+                xbitmap Check;
+                Check.CreateBitmap(7, 4);
+                xbitmap::Blit(Check, { 0, 0, 7, 4 }, Dest, { 2, 3, 9, 7 }, {});
+
+                for (std::uint32_t y = 0; y < 4; ++y)
+                for (std::uint32_t x = 0; x < 7; ++x)
+                {
+                    auto Expected = SrcData[x + 1 + (bFlip ? 5 - y : y + 2) * 9];
+                    if (bPremultiply) Expected = Expected.PremultiplyAlpha();
+                    const auto& C = Check.getMip<xcolori>(0)[x + y * 7];
+                    for (int c = 0; c < 4; ++c) assert(std::abs(int(C[c]) - int(Expected[c])) <= (bPremultiply || Format == xbitmap::format::R32G32B32A32_FLOAT || Format == xbitmap::format::R16G16B16A16 ? 1 : 0));
+                }
+            }
+
+            // Premultiplying into a format without alpha gives the same colors on the byte and float paths
+            xbitmap BGRA;
+            BGRA.CreateBitmap(9, 7, xbitmap::format::B8G8R8A8);
+            xbitmap::Blit(BGRA, { 0, 0, 9, 7 }, Src, { 0, 0, 9, 7 }, {});
+            for (auto Format : { xbitmap::format::R8G8B8U8, xbitmap::format::R32G32B32_FLOAT })
+            {
+                xbitmap Opaque;
+                Opaque.CreateBitmap(9, 7, Format);
+                xbitmap::Blit(Opaque, { 0, 0, 9, 7 }, BGRA, { 0, 0, 9, 7 }, { true, false });
+
+                xbitmap Check;
+                Check.CreateBitmap(9, 7);
+                xbitmap::Blit(Check, { 0, 0, 9, 7 }, Opaque, { 0, 0, 9, 7 }, {});
+                for (std::uint32_t i = 0; i < SrcData.size(); ++i)
+                {
+                    const auto  Expected = SrcData[i].PremultiplyAlpha();
+                    const auto& C        = Check.getMip<xcolori>(0)[i];
+                    for (int c = 0; c < 3; ++c) assert(std::abs(int(C[c]) - int(Expected[c])) <= 1);
+                }
+            }
+
+            // Channels missing in the source read as 0 for color and 255 for alpha
+            xbitmap RG;
+            RG.CreateBitmap(2, 1, xbitmap::format::R8G8);
+            RG.getMip<std::uint8_t>(0)[0] = 10;
+            RG.getMip<std::uint8_t>(0)[1] = 20;
+            xbitmap Dest;
+            Dest.CreateBitmap(1, 1, xbitmap::format::B8G8R8A8);
+            xbitmap::Blit(Dest, { 0, 0, 1, 1 }, RG, { 0, 0, 1, 1 }, {});
+            const auto Out = Dest.getMip<std::uint8_t>(0);
+            assert(Out[0] == 0 && Out[1] == 20 && Out[2] == 10 && Out[3] == 255);
+        }
+        // Equirect <-> cube map
+        {
+            std::cout << "\nTesting xbitmap equirect and cube map conversion\n";
+            // Each texel stores its own direction
+            xbitmap Equirect;
+            Equirect.CreateBitmap(128, 64, xbitmap::format::R32G32B32A32_FLOAT);
+            Equirect.setColorSpace(xbitmap::color_space::LINEAR);
+            auto Data = Equirect.getMip<std::array<float, 4>>(0);
+            for (std::uint32_t y = 0; y < 64; ++y)
+            for (std::uint32_t x = 0; x < 128; ++x)
+            {
+                const float Phi = ((x + 0.5f) / 128 - 0.5f) * 2 * 3.14159265f, Theta = (y + 0.5f) / 64 * 3.14159265f;
+                Data[x + y * 128] = { std::sin(Theta) * std::sin(Phi) + 2, std::cos(Theta) + 2, std::sin(Theta) * std::cos(Phi) + 2, 1 };
+            }
+
+            const std::array<std::array<float, 3>, 6> FaceDir{ { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } } };
+            for (auto Filter : { xbitmap::sample_filter::BILINEAR, xbitmap::sample_filter::BICUBIC })
+            {
+                xbitmap Cube, Back;
+                Equirect.CreateCubemapFromEquirect(Cube, 16, Filter);
+                assert(Cube.isCubemap() && Cube.getWidth() == 16 && Cube.getFaceCount() == 6);
+
+                // The middle of the faces look down the axes (the poles are blurry in an equirect)
+                for (int iFace = 0; iFace < 6; ++iFace)
+                {
+                    float Dot = 0;
+                    for (int y = 7; y < 9; ++y)
+                    for (int x = 7; x < 9; ++x)
+                    for (int c = 0; c < 3; ++c) Dot += (Cube.getMip<std::array<float, 4>>(0, iFace)[x + y * 16][c] - 2) * FaceDir[iFace][c] * 0.25f;
+                    assert(Dot > (iFace == 2 || iFace == 3 ? 0.95f : 0.99f));
+                }
+
+                Cube.CreateEquirectFromCubemap(Back, 64, Filter);
+                assert(Back.getWidth() == 64 && Back.getHeight() == 32 && Back.isCubemap() == false);
+                for (std::uint32_t y = 6; y < 26; ++y)
+                for (std::uint32_t x = 0; x < 64; ++x)
+                {
+                    const auto& C = Back.getMip<std::array<float, 4>>(0)[x + y * 64];
+                    const auto& E = Data[x * 2 + 1 + (y * 2 + 1) * 128];
+                    for (int c = 0; c < 3; ++c) assert(std::abs(C[c] - E[c]) < 0.05f);
+                }
+            }
+        }
+        // Atlas
+        {
+            std::cout << "\nTesting xbitmap atlas\n";
+            std::vector<xbitmap> Sources(12);
+            for (std::uint32_t i = 0; i < Sources.size(); ++i)
+            {
+                auto& S = Sources[i];
+                S.CreateBitmap(3 + (i * 7) % 13, 2 + (i * 5) % 11);
+                auto Data = S.getMip<xcolori>(0);
+                for (std::uint32_t t = 0; t < Data.size(); ++t) Data[t] = xcolori(std::uint8_t(i * 20), std::uint8_t(t), std::uint8_t(t % S.getWidth()), 255);
+                if (i == 1) S.setUWrapMode(xbitmap::wrap_mode::WRAP);
+                if (i == 2) { S.setVWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR); S.m_ClampColor = xcolori(1, 2, 3, 4); }
+            }
+
+            xbitmap::atlas_settings Settings;
+            Settings.m_nMips = -1;
+            std::vector<xbitmap::atlas_entry> Entries(Sources.size());
+            xbitmap Atlas;
+            assert(!xbitmap::CreateAtlas(Atlas, Entries, Sources, Settings));
+            assert(Atlas.getMipCount() == Atlas.getFullMipChainCount());
+
+            const auto W    = Atlas.getWidth();
+            const auto Data = Atlas.getMip<xcolori>(0);
+            for (std::uint32_t i = 0; i < Sources.size(); ++i)
+            {
+                const auto& R = Entries[i].m_Rect;
+                const auto& S = Sources[i];
+                assert(R.m_Right - R.m_Left == S.getWidth() && R.m_Bottom - R.m_Top == S.getHeight());
+                assert((R.m_Left - 2) % 4 == 0 && (R.m_Top - 2) % 4 == 0);
+                assert(Entries[i].m_UV[0] == float(R.m_Left) / W && Entries[i].m_UV[3] == float(R.m_Bottom) / Atlas.getHeight());
+
+                for (std::uint32_t y = 0; y < S.getHeight(); ++y)
+                for (std::uint32_t x = 0; x < S.getWidth(); ++x)
+                    assert(Data[R.m_Left + x + (R.m_Top + y) * W].m_Value == S.getMip<xcolori>(0)[x + y * S.getWidth()].m_Value);
+
+                // Slots (gutters included) do not overlap
+                for (std::uint32_t j = 0; j < i; ++j)
+                {
+                    const auto& O = Entries[j].m_Rect;
+                    assert(R.m_Right + 2 <= O.m_Left - 2 || O.m_Right + 2 <= R.m_Left - 2 || R.m_Bottom + 2 <= O.m_Top - 2 || O.m_Bottom + 2 <= R.m_Top - 2);
+                }
+
+                // The gutter extends the edges following the wrap modes
+                const auto& Left  = Data[R.m_Left - 1 + R.m_Top * W];
+                const auto& Above = Data[R.m_Left + (R.m_Top - 1) * W];
+                const auto  Src   = S.getMip<xcolori>(0);
+                assert(Left.m_Value  == Src[i == 1 ? S.getWidth() - 1 : 0].m_Value);
+                assert(Above.m_Value == (i == 2 ? xcolori(1, 2, 3, 4).m_Value : Src[0].m_Value));
+            }
+
+            // Too small an atlas fails
+            Settings.m_MaxSize = 16;
+            assert(xbitmap::CreateAtlas(Atlas, Entries, Sources, Settings));
+        }
+        // Texel layouts
+        {
+            std::cout << "\nTesting xbitmap texel layouts\n";
+            for (auto Format : { xbitmap::format::R8G8B8A8, xbitmap::format::R32G32B32_FLOAT })
+            for (auto Size : { std::array<std::uint32_t, 2>{ 32, 8 }, std::array<std::uint32_t, 2>{ 37, 13 } })
+            {
+                xbitmap Bitmap, Original;
+                Bitmap.CreateBitmap(Size[0], Size[1], Format, 3, 2);
+                Original.CreateBitmap(Size[0], Size[1], Format, 3, 2);
+                const auto Bytes = Bitmap.getDataSize() - 3 * sizeof(std::int32_t);
+                for (std::size_t i = 0; i < Bytes; ++i) Bitmap.getMip<std::byte>(0).data()[i] = Original.getMip<std::byte>(0).data()[i] = std::byte(i * 13 + i / 97);
+
+                const auto TexelSize = Bitmap.getMip<std::byte>(0).size() / (Size[0] * Size[1]);
+                const bool bPow2     = Size[0] == 32;
+                for (auto Layout : { xbitmap::texel_layout::MORTON, xbitmap::texel_layout::TILED_4X4, xbitmap::texel_layout::TILED_8X8, xbitmap::texel_layout::MORTON })
+                {
+                    if (Layout == xbitmap::texel_layout::MORTON && !bPow2) continue;
+                    Bitmap.setLayout(Layout);
+                    assert(Bitmap.getLayout() == Layout);
+
+                    for (int iFrame = 0; iFrame < 2; ++iFrame)
+                    for (int iMip = 0; iMip < 3; ++iMip)
+                    {
+                        const auto W = std::max(1u, Size[0] >> iMip), H = std::max(1u, Size[1] >> iMip);
+                        for (std::uint32_t y = 0; y < H; ++y)
+                        for (std::uint32_t x = 0; x < W; ++x)
+                            assert(0 == std::memcmp(&Bitmap.getMip<std::byte>(iMip, 0, iFrame)[Bitmap.getTexelIndex(x, y, iMip) * TexelSize], &Original.getMip<std::byte>(iMip, 0, iFrame)[(x + y * W) * TexelSize], TexelSize));
+                    }
+                }
+
+                Bitmap.setLayout(xbitmap::texel_layout::LINEAR);
+                assert(0 == std::memcmp(Bitmap.getMip<std::byte>(0).data(), Original.getMip<std::byte>(0).data(), Bytes));
+            }
+
+            // Kernels that walk rows see the same image whatever the layout
+            for (auto Layout : { xbitmap::texel_layout::MORTON, xbitmap::texel_layout::TILED_4X4, xbitmap::texel_layout::TILED_8X8 })
+            for (auto Size : { std::array<std::uint32_t, 2>{ 16, 16 }, std::array<std::uint32_t, 2>{ 32, 8 }, std::array<std::uint32_t, 2>{ 13, 10 } })
+            for (auto Filter : { xbitmap::mip_filter::BOX, xbitmap::mip_filter::MITCHELL })
+            {
+                if (Layout == xbitmap::texel_layout::MORTON && Size[0] == 13) continue;
+
+                const auto N = Size[0] * Size[1];
+                xbitmap    A, B;
+                A.CreateBitmap(Size[0], Size[1]);
+                B.CreateBitmap(Size[0], Size[1]);
+                for (std::uint32_t i = 0; i < N; ++i) A.getMip<xcolori>(0)[i] = B.getMip<xcolori>(0)[i] = xcolori(std::uint8_t(i), std::uint8_t(i * 3), 7, std::uint8_t(255 - i));
+                B.setLayout(Layout);
+
+                xbitmap::mip_settings Settings;
+                Settings.m_Filter = Filter;
+                A.GenerateMips(Settings, -1);
+                B.GenerateMips(Settings, -1);
+                assert(B.getLayout() == Layout);
+
+                const xbitmap::rect Dirty{ 1, 2, 5, 7 };
+                A.getMip<xcolori>(0)[Size[0] * 3 + 2] = xcolori(9, 9, 9, 9);
+                B.getMip<xcolori>(0)[B.getTexelIndex(2, 3)] = xcolori(9, 9, 9, 9);
+                A.RegenerateMips({ &Dirty, 1 });
+                B.RegenerateMips({ &Dirty, 1 });
+
+                xbitmap RA, RB;
+                A.CreateResizedBitmap(RA, 7, 5, xbitmap::mip_filter::MITCHELL);
+                B.CreateResizedBitmap(RB, 7, 5, xbitmap::mip_filter::MITCHELL);
+                assert(0 == std::memcmp(RA.getMip<std::byte>(0).data(), RB.getMip<std::byte>(0).data(), RA.getMip<std::byte>(0).size()));
+
+                A.Rotate(xbitmap::rotation::CW_90);
+                B.Rotate(xbitmap::rotation::CW_90);
+                A.Rotate(xbitmap::rotation::CW_180);
+                B.Rotate(xbitmap::rotation::CW_180);
+                assert(B.getLayout() == Layout);
+                B.setLayout(xbitmap::texel_layout::LINEAR);
+                assert(0 == std::memcmp(A.getMip<std::byte>(0).data(), B.getMip<std::byte>(0).data(), A.getDataSize() - A.getMipCount() * sizeof(std::int32_t)));
+            }
+        }
+        // GPU staging layouts
+        {
+            std::cout << "\nTesting xbitmap staging layouts\n";
+            for (auto Format : { xbitmap::format::R8G8B8A8, xbitmap::format::BC3_8RGBA })
+            {
+                xbitmap Bitmap;
+                Bitmap.CreateBitmap(40, 20, Format, 4, 2, true);
+                const auto Bytes = Bitmap.getDataSize() - 4 * sizeof(std::int32_t);
+                for (std::size_t i = 0; i < Bytes; ++i) Bitmap.getMip<std::byte>(0).data()[i] = std::byte(i * 7 + i / 251);
+
+                const auto Layout = Bitmap.getStagingLayout(256, 512);
+                assert(Layout.m_Subresources.size() == 2 * 6 * 4);
+
+                std::vector<std::byte> Staging(Layout.m_TotalSize, std::byte{ 0xCD });
+                Bitmap.WriteStaging(Staging, Layout);
+
+                const bool bBC = Format == xbitmap::format::BC3_8RGBA;
+                for (std::size_t i = 0; i < Layout.m_Subresources.size(); ++i)
+                {
+                    const auto& Sub   = Layout.m_Subresources[i];
+                    const int   iMip  = int(i % 4), iFace = int(i / 4 % 6), iFrame = int(i / 24);
+                    const auto  W     = std::max(1u, 40u >> iMip), H = std::max(1u, 20u >> iMip);
+                    assert(Sub.m_Offset % 512 == 0 && Sub.m_RowPitch % 256 == 0);
+                    assert(Sub.m_Width == W && Sub.m_Height == H);
+                    assert(Sub.m_RowSize == (bBC ? (W + 3) / 4 * 16 : W * 4) && Sub.m_nRows == (bBC ? (H + 3) / 4 : H));
+                    assert(i == 0 || Sub.m_Offset >= Layout.m_Subresources[i - 1].m_Offset + Layout.m_Subresources[i - 1].m_RowPitch * (Layout.m_Subresources[i - 1].m_nRows - 1) + Layout.m_Subresources[i - 1].m_RowSize);
+
+                    const auto Src = Bitmap.getMip<std::byte>(iMip, iFace, iFrame);
+                    for (std::uint32_t r = 0; r < Sub.m_nRows; ++r)
+                    {
+                        assert(0 == std::memcmp(&Staging[Sub.m_Offset + r * Sub.m_RowPitch], &Src[r * Sub.m_RowSize], Sub.m_RowSize));
+                        if (r + 1 < Sub.m_nRows) assert(Staging[Sub.m_Offset + r * Sub.m_RowPitch + Sub.m_RowSize] == std::byte{ 0xCD });
+                    }
+                }
+
+                // Staging files load back as the exact same buffer
+                assert(!Bitmap.SaveStaging(L"xbitmap_staging_test.xbst", 256, 512));
+                xbitmap::staging_layout Loaded;
+                std::vector<std::byte>  Data;
+                assert(!xbitmap::LoadStaging(L"xbitmap_staging_test.xbst", Loaded, Data));
+                assert(Loaded.m_TotalSize == Layout.m_TotalSize && Loaded.m_Format == Format && Loaded.m_nFrames == 2 && Loaded.m_nFaces == 6);
+                for (std::size_t i = 0; i < Layout.m_Subresources.size(); ++i)
+                {
+                    const auto& Sub = Loaded.m_Subresources[i];
+                    assert(Sub.m_Offset == Layout.m_Subresources[i].m_Offset);
+                    for (std::uint32_t r = 0; r < Sub.m_nRows; ++r)
+                        assert(0 == std::memcmp(&Data[Sub.m_Offset + r * Sub.m_RowPitch], &Staging[Sub.m_Offset + r * Sub.m_RowPitch], Sub.m_RowSize));
+                }
+                std::remove("xbitmap_staging_test.xbst");
+            }
+
+            // Other layouts are written row major
+            xbitmap A, B;
+            A.CreateBitmap(16, 16);
+            B.CreateBitmap(16, 16);
+            for (std::uint32_t i = 0; i < 256; ++i) A.getMip<xcolori>(0)[i] = B.getMip<xcolori>(0)[i] = xcolori(std::uint8_t(i), 1, 2, 3);
+            B.setLayout(xbitmap::texel_layout::TILED_4X4);
+            const auto Layout = A.getStagingLayout(4, 4);
+            std::vector<std::byte> SA(Layout.m_TotalSize), SB(Layout.m_TotalSize);
+            A.WriteStaging(SA, Layout);
+            B.WriteStaging(SB, Layout);
+            assert(SA == SB && 0 == std::memcmp(SA.data(), A.getMip<std::byte>(0).data(), SA.size()));
+        }
+        // Tiled bitmaps
+        {
+            std::cout << "\nTesting xbitmap tiled bitmaps\n";
+            xbitmap Whole;
+            Whole.CreateBitmap(100, 70);
+            for (std::uint32_t i = 0; i < 100 * 70; ++i) Whole.getMip<xcolori>(0)[i] = xcolori(std::uint8_t(i * 7), std::uint8_t(i / 100 * 3), std::uint8_t(i % 100 * 2), std::uint8_t(128 + i % 127));
+
+            xbitmap_tiled Tiled;
+            Tiled.Create(100, 70, xbitmap::format::XCOLOR, 16);
+            assert(Tiled.getTileCountX() == 7 && Tiled.getTileCountY() == 5 && Tiled.isResident(0, 0) == false);
+            Tiled.WriteRegion({ 0, 0, 100, 70 }, Whole.getView());
+            assert(Tiled.getTile(6, 4).getWidth() == 4 && Tiled.getTile(6, 4).getHeight() == 6);
+
+            xbitmap Part;
+            Part.CreateBitmap(30, 20);
+            Tiled.ReadRegion({ 13, 29, 43, 49 }, Part.getView());
+            for (std::uint32_t y = 0; y < 20; ++y)
+            for (std::uint32_t x = 0; x < 30; ++x)
+                assert(Part.getMip<xcolori>(0)[x + y * 30].m_Value == Whole.getMip<xcolori>(0)[13 + x + (29 + y) * 100].m_Value);
+
+            // Filtering across tiles matches filtering the whole image
+            const auto Compare = [](const xbitmap_tiled& T, int iLevel, const xbitmap& B)
+            {
+                xbitmap Out;
+                Out.CreateBitmap(T.getWidth(iLevel), T.getHeight(iLevel), B.getFormat());
+                T.ReadRegion({ 0, 0, T.getWidth(iLevel), T.getHeight(iLevel) }, Out.getView(), iLevel);
+                assert(0 == std::memcmp(Out.getMip<std::byte>(0).data(), B.getMip<std::byte>(0).data(), B.getMip<std::byte>(0).size()));
+            };
+
+            xbitmap Expected;
+            xbitmap_tiled Resized;
+            assert(!Tiled.CreateResized(Resized, 37, 23, xbitmap::mip_filter::MITCHELL));
+            Expected.CreateBitmap(37, 23);
+            xbitmap::Resize(Expected.getView(), Whole.getView(), xbitmap::mip_filter::MITCHELL, xbitmap::color_space::SRGB);
+            Compare(Resized, 0, Expected);
+
+            // Large reductions read the source in chunks
+            {
+                xbitmap Wide;
+                Wide.CreateBitmap(5000, 3, xbitmap::format::R32_FLOAT);
+                for (std::uint32_t i = 0; i < 5000 * 3; ++i) Wide.getMip<float>(0)[i] = float(i % 5000) * 0.001f + float(i / 5000);
+
+                xbitmap_tiled WideTiled, Small;
+                WideTiled.Create(5000, 3, xbitmap::format::R32_FLOAT, 1024, xbitmap::color_space::LINEAR);
+                WideTiled.WriteRegion({ 0, 0, 5000, 3 }, Wide.getView());
+                assert(!WideTiled.CreateResized(Small, 3, 1, xbitmap::mip_filter::BOX));
+                Expected.CreateBitmap(3, 1, xbitmap::format::R32_FLOAT);
+                xbitmap::Resize(Expected.getView(), Wide.getView(), xbitmap::mip_filter::BOX, xbitmap::color_space::LINEAR);
+                Compare(Small, 0, Expected);
+            }
+
+            // Made levels live in their spill files, not in memory
+            std::filesystem::create_directory("xbitmap_spill_test");
+            Tiled.setSpillPath(L"xbitmap_spill_test");
+            assert(!Tiled.GenerateMips());
+            assert(Tiled.getLevelCount() == 7 && Tiled.getWidth(6) == 1 && Tiled.getHeight(6) == 1);
+            assert(Tiled.isResident(0, 0, 1) == false && Tiled.isResident(0, 0, 6) == false);
+            assert(std::distance(std::filesystem::directory_iterator("xbitmap_spill_test"), std::filesystem::directory_iterator{}) == 6);
+            Expected.CreateBitmap(50, 35);
+            xbitmap::Resize(Expected.getView(), Whole.getView(), xbitmap::mip_filter::BOX, xbitmap::color_space::SRGB);
+            Compare(Tiled, 1, Expected);
+
+            // Files are read one tile at a time
+            assert(!Tiled.Save(L"xbitmap_tiled_test.xbtl"));
+            xbitmap_tiled Streamed;
+            assert(!Streamed.Open(L"xbitmap_tiled_test.xbtl"));
+            assert(Streamed.getLevelCount() == 7 && Streamed.getTileSize() == 16 && Streamed.isResident(3, 2) == false);
+            Compare(Streamed, 0, Whole);
+            assert(Streamed.isResident(3, 2));
+            Streamed.Evict(3, 2);
+            assert(Streamed.isResident(3, 2) == false);
+            Compare(Streamed, 1, Expected);
+
+            xbitmap_tiled Streamed2;
+            assert(!Streamed2.Open(L"xbitmap_tiled_test.xbtl"));
+            assert(!Streamed2.CreateResized(Resized, 37, 23, xbitmap::mip_filter::MITCHELL));
+            Expected.CreateBitmap(37, 23);
+            xbitmap::Resize(Expected.getView(), Whole.getView(), xbitmap::mip_filter::MITCHELL, xbitmap::color_space::SRGB);
+            Compare(Resized, 0, Expected);
+            for (std::uint32_t y = 0; y < 5; ++y)
+            for (std::uint32_t x = 0; x < 7; ++x) assert(Streamed2.isResident(x, y) == false);
+
+            // Converting a streamed bitmap keeps it streamed
+            assert(!Streamed.Convert(xbitmap::format::R32G32B32A32_FLOAT));
+            assert(Streamed.isResident(0, 0) == false && Streamed.isResident(6, 4) == false);
+            Expected.CreateBitmap(100, 70, xbitmap::format::R32G32B32A32_FLOAT);
+            xbitmap::Blit(Expected.getView(), Whole.getView(), {});
+            Compare(Streamed, 0, Expected);
+            Streamed.Kill();
+            Streamed2.Kill();
+
+            // Tiles whose bytes do not fit in 32 bits are rejected
+            {
+                xbitmap_tiled Float;
+                Float.Create(4, 4, xbitmap::format::R32G32B32A32_FLOAT, 4, xbitmap::color_space::LINEAR);
+                assert(!Float.Save(L"xbitmap_tiled_test.xbtl"));
+
+                std::FILE*          fp       = std::fopen("xbitmap_tiled_test.xbtl", "r+b");
+                const std::uint32_t TileSize = 0xffff;
+                assert(fp && 0 == std::fseek(fp, 12, SEEK_SET) && 1 == std::fwrite(&TileSize, sizeof(TileSize), 1, fp));
+                std::fclose(fp);
+                assert(Float.Open(L"xbitmap_tiled_test.xbtl"));
+            }
+            std::remove("xbitmap_tiled_test.xbtl");
+
+            Tiled.Kill();
+            assert(std::filesystem::is_empty("xbitmap_spill_test"));
+            std::filesystem::remove("xbitmap_spill_test");
+        }
+        // Bilinear sampler
+        {
+            std::cout << "\nTesting xbitmap bilinear sampler\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(4, 4);
+            Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+            Bitmap.m_ClampColor = xcolori(200, 100, 40, 255);
+            for (std::uint32_t i = 0; i < 16; ++i) Bitmap.getMip<xcolori>(0)[i] = xcolori(std::uint8_t(i * 16), std::uint8_t(255 - i * 8), std::uint8_t(i * i), std::uint8_t(100 + i));
+            const auto Texel = [&](int x, int y) { return Bitmap.getMip<xcolori>(0)[x + y * 4]; };
+
+            const auto Check = [&](const xbitmap_sampler::uv& UV, const std::array<std::pair<xcolori, float>, 4>& Expected)
+            {
+                xcolori I;
+                xcolorf F;
+                xbitmap_sampler Sampler(Bitmap);
+                Sampler.SampleBilinear({ &UV, 1 }, { &I, 1 });
+                Sampler.SampleBilinear({ &UV, 1 }, { &F, 1 });
+                for (int c = 0; c < 4; ++c)
+                {
+                    float E = 0;
+                    for (auto& [C, W] : Expected) E += C[c] * W;
+                    assert(std::abs(I[c] - E) <= 0.51f);
+                    assert(std::abs(F[c] * 255 - E) < 0.01f);
+                }
+            };
+
+            // Texel centers and the half way point
+            Check({ 2.5f / 4, 1.5f / 4 }, { { { Texel(2, 1), 1 }, { Texel(2, 1), 0 }, { Texel(2, 1), 0 }, { Texel(2, 1), 0 } } });
+            Check({ 1.0f / 4, 0.5f / 4 }, { { { Texel(0, 0), 0.5f }, { Texel(1, 0), 0.5f }, { Texel(1, 0), 0 }, { Texel(1, 0), 0 } } });
+
+            // The corner reads outside following the wrap modes
+            const xbitmap_sampler::uv Corner{ 0, 0 };
+            Bitmap.setUWrapMode(xbitmap::wrap_mode::WRAP);
+            Bitmap.setVWrapMode(xbitmap::wrap_mode::CLAMP_TO_EDGE);
+            Check(Corner, { { { Texel(3, 0), 0.5f }, { Texel(0, 0), 0.5f }, { Texel(0, 0), 0 }, { Texel(0, 0), 0 } } });
+            Bitmap.setUWrapMode(xbitmap::wrap_mode::MIRROR);
+            Bitmap.setVWrapMode(xbitmap::wrap_mode::WRAP);
+            Check(Corner, { { { Texel(0, 3), 0.5f }, { Texel(0, 0), 0.5f }, { Texel(0, 0), 0 }, { Texel(0, 0), 0 } } });
+            Bitmap.setUWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR);
+            Bitmap.setVWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR);
+            Check(Corner, { { { Bitmap.m_ClampColor, 0.75f }, { Texel(0, 0), 0.25f }, { Texel(0, 0), 0 }, { Texel(0, 0), 0 } } });
+
+            // Batches (with a tail), other byte orders and other formats agree
+            std::vector<xbitmap_sampler::uv> UVs;
+            for (int i = 0; i < 37; ++i) UVs.push_back({ -1.3f + i * 0.097f, 2.1f - i * 0.113f });
+
+            xbitmap Swapped, Float;
+            Swapped.CreateBitmap(4, 4, xbitmap::format::B8G8R8A8);
+            Float.CreateBitmap(4, 4, xbitmap::format::R32G32B32A32_FLOAT);
+            for (auto* p : { &Swapped, &Float })
+            {
+                p->setColorSpace(xbitmap::color_space::LINEAR);
+                p->setUWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR);
+                p->setVWrapMode(xbitmap::wrap_mode::CLAMP_TO_COLOR);
+                p->m_ClampColor = Bitmap.m_ClampColor;
+                xbitmap::Blit(p->getView(), Bitmap.getView(), {});
+            }
+
+            std::vector<xcolori> A(37), B(37);
+            std::vector<xcolorf> C(37), D(37);
+            xbitmap_sampler(Bitmap).SampleBilinear(UVs, A);
+            xbitmap_sampler(Swapped).SampleBilinear(UVs, B);
+            xbitmap_sampler(Bitmap).SampleBilinear(UVs, C);
+            xbitmap_sampler(Float).SampleBilinear(UVs, D);
+            for (int i = 0; i < 37; ++i)
+            {
+                const auto E = Bitmap.getBilinearColor(UVs[i][0], UVs[i][1]);
+                assert(A[i].m_Value == B[i].m_Value);
+                for (int c = 0; c < 4; ++c)
+                {
+                    assert(std::abs(A[i][c] - C[i][c] * 255) <= 1.5f);
+                    assert(std::abs(C[i][c] - D[i][c]) < 1e-5f && C[i][c] == E[c]);
+                }
+            }
+
+            const auto P = Bitmap.getPixelColor(3, 2);
+            assert(std::abs(P.m_G * 255 - Texel(3, 2).m_G) < 1e-3f && P.m_A * 255 - Texel(3, 2).m_A < 1e-3f);
+        }
+        // Trilinear and anisotropic sampling
+        {
+            std::cout << "\nTesting xbitmap trilinear and anisotropic sampling\n";
+            xbitmap Bitmap;
+            Bitmap.CreateBitmap(16, 16, xbitmap::format::R32G32B32A32_FLOAT);
+            Bitmap.setColorSpace(xbitmap::color_space::LINEAR);
+            Bitmap.setUWrapMode(xbitmap::wrap_mode::WRAP);
+            Bitmap.setVWrapMode(xbitmap::wrap_mode::WRAP);
+            auto Texels = Bitmap.getMip<std::array<float, 4>>(0);
+            for (std::uint32_t i = 0; i < 256; ++i) Texels[i] = { float(i % 16) / 15, float(i / 16) / 15, float((i * 7) % 13) / 12, 1 };
+            Bitmap.GenerateMips();
+
+            std::vector<xbitmap_sampler::uv> UVs;
+            for (int i = 0; i < 21; ++i) UVs.push_back({ 0.05f + i * 0.043f, 0.9f - i * 0.037f });
+
+            const auto Bilinear = [&](int iMip, std::span<const xbitmap_sampler::uv> P)
+            {
+                std::vector<xcolorf> R(P.size());
+                xbitmap_sampler(Bitmap, iMip).SampleBilinear(P, R);
+                return R;
+            };
+            const auto Near = [](const xcolorf& A, const xcolorf& B) { for (int c = 0; c < 4; ++c) if (std::abs(A[c] - B[c]) > 1e-4f) return false; return true; };
+
+            xbitmap_sampler        Sampler(Bitmap);
+            std::vector<xcolorf>   Out(UVs.size());
+            const auto Isotropic = [&](float TexelsPerPixel)
+            {
+                return std::vector<xbitmap_sampler::uv_derivatives>(UVs.size(), { { TexelsPerPixel / 16, 0 }, { 0, TexelsPerPixel / 16 } });
+            };
+
+            // Magnification, whole levels and half way between two levels
+            Sampler.SampleTrilinear(UVs, Isotropic(0.25f), Out);
+            for (std::size_t i = 0; auto& C : Bilinear(0, UVs)) assert(Near(Out[i++], C));
+            Sampler.SampleTrilinear(UVs, Isotropic(2), Out);
+            for (std::size_t i = 0; auto& C : Bilinear(1, UVs)) assert(Near(Out[i++], C));
+
+            Sampler.SampleTrilinear(UVs, Isotropic(std::sqrt(8.0f)), Out);
+            const auto M1 = Bilinear(1, UVs), M2 = Bilinear(2, UVs);
+            for (std::size_t i = 0; i < UVs.size(); ++i)
+            for (int c = 0; c < 4; ++c) assert(std::abs(Out[i][c] - (M1[i][c] + M2[i][c]) * 0.5f) < 1e-4f);
+
+            // Past the last mip it stays there
+            Sampler.SampleTrilinear(UVs, Isotropic(1000), Out);
+            for (std::size_t i = 0; auto& C : Bilinear(4, UVs)) assert(Near(Out[i++], C));
+
+            // A footprint 8 texels long and 1 wide takes 8 taps along U on mip 0
+            const std::vector<xbitmap_sampler::uv_derivatives> Long(UVs.size(), { { 8.0f / 16, 0 }, { 0, 1.0f / 16 } });
+            Sampler.SampleAnisotropic(UVs, Long, Out);
+            for (std::size_t i = 0; i < UVs.size(); ++i)
+            {
+                std::vector<xbitmap_sampler::uv> Taps;
+                for (int t = 0; t < 8; ++t) Taps.push_back({ UVs[i][0] + 0.5f * ((t + 0.5f) / 8 - 0.5f), UVs[i][1] });
+
+                xcolorf Expected(0, 0, 0, 0);
+                for (auto& C : Bilinear(0, Taps)) for (int c = 0; c < 4; ++c) Expected[c] += C[c] / 8;
+                assert(Near(Out[i], Expected));
+            }
+
+            // Limited to 2x it moves down two levels, and without anisotropy it is trilinear
+            Sampler.SampleAnisotropic(UVs, Long, Out, 2);
+            for (std::size_t i = 0; i < UVs.size(); ++i)
+            {
+                const std::array<xbitmap_sampler::uv, 2> Taps{ { { UVs[i][0] - 0.125f, UVs[i][1] }, { UVs[i][0] + 0.125f, UVs[i][1] } } };
+                const auto R = Bilinear(2, Taps);
+                for (int c = 0; c < 4; ++c) assert(std::abs(Out[i][c] - (R[0][c] + R[1][c]) * 0.5f) < 1e-4f);
+            }
+
+            std::vector<xcolorf> Tri(UVs.size());
+            Sampler.SampleAnisotropic(UVs, Long, Out, 1);
+            Sampler.SampleTrilinear(UVs, Long, Tri);
+            for (std::size_t i = 0; i < UVs.size(); ++i) assert(Near(Out[i], Tri[i]));
+        }
+    }
+}
@@ -164,10 +164,10 @@ namespace xcolor::unit_test
                 assert(color1.m_G == 100);
                 assert(color1.m_B == 100);
                 color1 *= color2;
-                assert(color1.m_R == 19);
-                assert(color1.m_G == 19);
-                assert(color1.m_B == 19);
-                assert(color1 == xcolori(19, 19, 19, 255));
+                assert(color1.m_R == 20);
+                assert(color1.m_G == 20);
+                assert(color1.m_B == 20);
+                assert(color1 == xcolori(20, 20, 20, 255));
                 assert(color1 != color2);
             }
             // Utility methods
@@ -3,6 +3,20 @@
 #include <stdio.h>
 #include <wchar.h>
 #include <format>
+#include <bit>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+    #include <emmintrin.h>
+    #define XBITMAP_SSE2 1
+#else
+    #define XBITMAP_SSE2 0
+#endif
 
 namespace xbitmap_details
 {
@@ -122,6 +136,584 @@ namespace xbitmap_details
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////
+// PROCESSING HELPERS
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    inline thread_local bool s_bInsideParallelFor = false;
+
+    //-------------------------------------------------------------------------------
+    // Threads shared by every ParallelFor, started the first time a range is split.
+    // A job hands out its bands through an atomic counter and the thread that posts
+    // it takes bands too, so a job always finishes, even when no worker is free or
+    // none could be started.
+    //-------------------------------------------------------------------------------
+    class worker_pool
+    {
+    public:
+
+        struct job
+        {
+            void                      (*m_pRun)( void* pFunction, std::uint32_t Begin, std::uint32_t End ) noexcept;
+            void*                       m_pFunction;
+            std::uint32_t               m_Count;
+            std::uint32_t               m_BandSize;
+            std::uint32_t               m_nBands;
+            std::atomic<std::uint32_t>  m_NextBand  { 0 };
+            std::uint32_t               m_nUsers    { 0 };          // Workers inside the job, guarded by the pool mutex
+        };
+
+        static worker_pool& get( void ) noexcept
+        {
+            static worker_pool Pool;
+            return Pool;
+        }
+
+        std::uint32_t getWorkerCount( void ) const noexcept
+        {
+            return static_cast<std::uint32_t>( m_Workers.size() );
+        }
+
+        void Run( job& Job ) noexcept
+        {
+            {
+                std::lock_guard Lock( m_Mutex );
+                m_Jobs.push_back( &Job );
+            }
+            m_Wake.notify_all();
+
+            const bool bInside = s_bInsideParallelFor;
+            s_bInsideParallelFor = true;
+            RunBands( Job );
+            s_bInsideParallelFor = bInside;
+
+            // Every band is taken, wait for the workers still running one
+            std::unique_lock Lock( m_Mutex );
+            std::erase( m_Jobs, &Job );
+            m_Idle.wait( Lock, [&]{ return Job.m_nUsers == 0; } );
+        }
+
+    private:
+
+        worker_pool( void ) noexcept
+        {
+            const auto nWorkers = std::max( 1u, std::thread::hardware_concurrency() ) - 1;
+            try
+            {
+                m_Workers.reserve( nWorkers );
+                for( auto i = 0u; i < nWorkers; ++i ) m_Workers.emplace_back( [this]{ WorkerLoop(); } );
+            }
+            catch( ... )
+            {
+                // Fewer workers (maybe none), the posting threads run the rest of the bands
+            }
+        }
+
+        ~worker_pool( void ) noexcept
+        {
+            {
+                std::lock_guard Lock( m_Mutex );
+                m_bQuit = true;
+            }
+            m_Wake.notify_all();
+            for( auto& Worker : m_Workers ) Worker.join();
+        }
+
+        static void RunBands( job& Job ) noexcept
+        {
+            for( auto iBand = Job.m_NextBand.fetch_add( 1 ); iBand < Job.m_nBands; iBand = Job.m_NextBand.fetch_add( 1 ) )
+            {
+                const auto Begin = iBand * Job.m_BandSize;
+                Job.m_pRun( Job.m_pFunction, Begin, std::min( Job.m_Count, Begin + Job.m_BandSize ) );
+            }
+        }
+
+        void WorkerLoop( void ) noexcept
+        {
+            s_bInsideParallelFor = true;
+
+            std::unique_lock Lock( m_Mutex );
+            for(;;)
+            {
+                m_Wake.wait( Lock, [&]{ return m_bQuit || m_Jobs.empty() == false; } );
+                if( m_bQuit ) return;
+
+                auto& Job = *m_Jobs.front();
+                ++Job.m_nUsers;
+                Lock.unlock();
+
+                RunBands( Job );
+
+                // The job has no bands left, nobody else needs to pick it up
+                Lock.lock();
+                std::erase( m_Jobs, &Job );
+                if( --Job.m_nUsers == 0 ) m_Idle.notify_all();
+            }
+        }
+
+        std::mutex                  m_Mutex         {};
+        std::condition_variable     m_Wake          {};
+        std::condition_variable     m_Idle          {};
+        std::vector<job*>           m_Jobs          {};
+        std::vector<std::thread>    m_Workers       {};
+        bool                        m_bQuit         { false };
+    };
+
+    //-------------------------------------------------------------------------------
+    // Splits [0, Count) into contiguous bands that the worker pool and the calling
+    // thread run. Small ranges are not split at all, neither are the ranges of a
+    // ParallelFor nested in the band of another one.
+    //-------------------------------------------------------------------------------
+    template< typename T_FUNCTION >
+    void ParallelFor( const std::uint32_t Count, const std::uint32_t MinBandSize, T_FUNCTION&& Function ) noexcept
+    {
+        const auto nThreads = s_bInsideParallelFor ? 1u : worker_pool::get().getWorkerCount() + 1;
+        const auto nBands   = std::max( 1u, std::min( nThreads, Count / std::max( 1u, MinBandSize ) ) );
+
+        if( nBands <= 1 )
+        {
+            if( Count ) Function( 0u, Count );
+            return;
+        }
+
+        using function_t = std::remove_reference_t<T_FUNCTION>;
+
+        worker_pool::job Job;
+        Job.m_pRun      = []( void* pFunction, const std::uint32_t Begin, const std::uint32_t End ) noexcept { ( *static_cast<function_t*>( pFunction ) )( Begin, End ); };
+        Job.m_pFunction = const_cast<void*>( static_cast<const void*>( std::addressof( Function ) ) );
+        Job.m_Count     = Count;
+        Job.m_BandSize  = ( Count + nBands - 1 ) / nBands;
+        Job.m_nBands    = ( Count + Job.m_BandSize - 1 ) / Job.m_BandSize;
+        worker_pool::get().Run( Job );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Keeps a bitmap row major while a kernel that walks rows works on it, the
+    // original layout comes back when the scope ends
+    //-------------------------------------------------------------------------------
+    class linear_scope
+    {
+    public:
+
+        explicit linear_scope( xbitmap& Bitmap ) noexcept
+            : m_Bitmap{ Bitmap }
+            , m_Layout{ Bitmap.getLayout() }
+        {
+            if( m_Layout != xbitmap::texel_layout::LINEAR ) m_Bitmap.setLayout( xbitmap::texel_layout::LINEAR );
+        }
+
+        ~linear_scope( void ) noexcept
+        {
+            if( m_Layout != xbitmap::texel_layout::LINEAR && m_Bitmap.isValid() ) m_Bitmap.setLayout( m_Layout );
+        }
+
+    private:
+
+        xbitmap&                    m_Bitmap;
+        xbitmap::texel_layout       m_Layout;
+    };
+
+    //-------------------------------------------------------------------------------
+    // The bitmap itself when it is row major, otherwise a row major copy in Temp
+    //-------------------------------------------------------------------------------
+    inline const xbitmap& AsLinear( const xbitmap& Bitmap, xbitmap& Temp ) noexcept
+    {
+        if( Bitmap.getLayout() == xbitmap::texel_layout::LINEAR ) return Bitmap;
+
+        Temp.CreateBitmap( Bitmap.getWidth(), Bitmap.getHeight(), Bitmap.getFormat(), Bitmap.getMipCount(), Bitmap.getFrameCount(), Bitmap.isCubemap() );
+        std::memcpy( Temp.m_pData, Bitmap.m_pData, Bitmap.getDataSize() );
+        Temp.m_Flags               = Bitmap.m_Flags;
+        Temp.m_Flags.m_bOwnsMemory = true;
+        Temp.m_ClampColor          = Bitmap.m_ClampColor;
+        Temp.m_Layout              = Bitmap.getLayout();
+        Temp.setLayout( xbitmap::texel_layout::LINEAR );
+        return Temp;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Maps a texel coordinate into [0, Size) following the wrap mode.
+    // For CLAMP_TO_COLOR it returns -1 when the coordinate falls outside, the
+    // caller is then expected to use xbitmap::m_ClampColor.
+    //-------------------------------------------------------------------------------
+    inline int WrapCoordinate( int i, const int Size, const xbitmap::wrap_mode Mode ) noexcept
+    {
+        if( i >= 0 && i < Size ) return i;
+
+        switch( Mode )
+        {
+        case xbitmap::wrap_mode::WRAP:
+            i %= Size;
+            return i < 0 ? i + Size : i;
+        case xbitmap::wrap_mode::MIRROR:
+        {
+            const int Period = 2 * Size;
+            i %= Period;
+            if( i < 0 ) i += Period;
+            return i < Size ? i : Period - 1 - i;
+        }
+        case xbitmap::wrap_mode::CLAMP_TO_COLOR:
+            return -1;
+        default:
+            return std::clamp( i, 0, Size - 1 );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // How the texels of a format are stored, used to pick the processing kernels
+    //-------------------------------------------------------------------------------
+    enum class texel_kind : std::uint8_t
+    { UNSUPPORTED                                                   // Palettes and exotic packings
+    , BLOCK                                                         // Block compressed, can be copied but not filtered
+    , UNORM8                                                        // One byte per channel
+    , UNORM16                                                       // Two bytes per channel
+    , PACKED16                                                      // 16 bit xcolor formats (565, 4444, 5551)
+    , FLOAT16                                                       // Half floats
+    , FLOAT32                                                       // Floats
+    };
+
+    struct format_info
+    {
+        std::uint8_t            m_BlockWidth    { 1 };              // Texels per block in X, 1 for uncompressed formats
+        std::uint8_t            m_BlockHeight   { 1 };              // Texels per block in Y, 1 for uncompressed formats
+        std::uint8_t            m_BlockBytes    { 0 };              // Bytes per block, for uncompressed formats a block is a texel
+        texel_kind              m_Kind          { texel_kind::UNSUPPORTED };
+    };
+
+    static constexpr auto s_FormatInfo = []() constexpr noexcept
+    {
+        using fmt  = xbitmap::format;
+        using kind = texel_kind;
+        std::array< format_info, static_cast<std::size_t>(fmt::ENUM_COUNT) > Table = {};
+
+        Table[ static_cast<int>(fmt::B8G8R8A8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::B8G8R8U8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::A8R8G8B8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::U8R8G8B8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R8G8B8U8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R8G8B8A8)              ] = format_info{  1, 1,  4, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R8)                    ] = format_info{  1, 1,  1, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R8G8B8)                ] = format_info{  1, 1,  3, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R4G4B4A4)              ] = format_info{  1, 1,  2, kind::PACKED16 };
+        Table[ static_cast<int>(fmt::R5G6B5)                ] = format_info{  1, 1,  2, kind::PACKED16 };
+        Table[ static_cast<int>(fmt::B5G5R5A1)              ] = format_info{  1, 1,  2, kind::PACKED16 };
+
+        Table[ static_cast<int>(fmt::R32G32B32A32_FLOAT)    ] = format_info{  1, 1, 16, kind::FLOAT32  };
+        Table[ static_cast<int>(fmt::R32G32B32_FLOAT)       ] = format_info{  1, 1, 12, kind::FLOAT32  };
+        Table[ static_cast<int>(fmt::R32G32_FLOAT)          ] = format_info{  1, 1,  8, kind::FLOAT32  };
+        Table[ static_cast<int>(fmt::R32_FLOAT)             ] = format_info{  1, 1,  4, kind::FLOAT32  };
+        Table[ static_cast<int>(fmt::R16G16B16A16_SFLOAT)   ] = format_info{  1, 1,  8, kind::FLOAT16  };
+        Table[ static_cast<int>(fmt::R16G16_SFLOAT)         ] = format_info{  1, 1,  4, kind::FLOAT16  };
+        Table[ static_cast<int>(fmt::R16_SFLOAT)            ] = format_info{  1, 1,  2, kind::FLOAT16  };
+
+        Table[ static_cast<int>(fmt::BC1_4RGB)              ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC1_4RGBA1)            ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC2_8RGBA)             ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC3_8RGBA)             ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC3_81Y0X_NORMAL)      ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC4_4R)                ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC5_8RG)               ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC5_8YX_NORMAL)        ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC6H_8RGB_SFLOAT)      ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC6H_8RGB_UFLOAT)      ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::BC7_8RGBA)             ] = format_info{  4, 4, 16, kind::BLOCK    };
+
+        Table[ static_cast<int>(fmt::ETC2_4RGB)             ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ETC2_4RGBA1)           ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ETC2_8RGBA)            ] = format_info{  4, 4, 16, kind::BLOCK    };
+
+        Table[ static_cast<int>(fmt::ASTC_4x4_8RGB)         ] = format_info{  4, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_5x4_6RGB)         ] = format_info{  5, 4, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_5x5_5RGB)         ] = format_info{  5, 5, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_6x5_4RGB)         ] = format_info{  6, 5, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_6x6_4RGB)         ] = format_info{  6, 6, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_8x5_3RGB)         ] = format_info{  8, 5, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_8x6_3RGB)         ] = format_info{  8, 6, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_8x8_2RGB)         ] = format_info{  8, 8, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_10x5_3RGB)        ] = format_info{ 10, 5, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_10x6_2RGB)        ] = format_info{ 10, 6, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_10x8_2RGB)        ] = format_info{ 10, 8, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_10x10_1RGB)       ] = format_info{ 10,10, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_12x10_1RGB)       ] = format_info{ 12,10, 16, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::ASTC_12x12_1RGB)       ] = format_info{ 12,12, 16, kind::BLOCK    };
+
+        Table[ static_cast<int>(fmt::PVR1_2RGB)             ] = format_info{  8, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::PVR1_2RGBA)            ] = format_info{  8, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::PVR1_4RGB)             ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::PVR1_4RGBA)            ] = format_info{  4, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::PVR2_2RGBA)            ] = format_info{  8, 4,  8, kind::BLOCK    };
+        Table[ static_cast<int>(fmt::PVR2_4RGBA)            ] = format_info{  4, 4,  8, kind::BLOCK    };
+
+        Table[ static_cast<int>(fmt::D24S8_FLOAT)           ] = format_info{  1, 1,  4, kind::UNSUPPORTED };
+        Table[ static_cast<int>(fmt::D24S8)                 ] = format_info{  1, 1,  4, kind::UNSUPPORTED };
+        Table[ static_cast<int>(fmt::R32)                   ] = format_info{  1, 1,  4, kind::UNSUPPORTED };
+        Table[ static_cast<int>(fmt::R8G8)                  ] = format_info{  1, 1,  2, kind::UNORM8   };
+        Table[ static_cast<int>(fmt::R16G16B16A16)          ] = format_info{  1, 1,  8, kind::UNORM16  };
+        Table[ static_cast<int>(fmt::A2R10G10B10)           ] = format_info{  1, 1,  4, kind::UNSUPPORTED };
+        Table[ static_cast<int>(fmt::B11G11R11_FLOAT)       ] = format_info{  1, 1,  4, kind::UNSUPPORTED };
+
+        return Table;
+    }();
+
+    //-------------------------------------------------------------------------------
+
+    inline const format_info& getFormatInfo( const xbitmap::format Format ) noexcept
+    {
+        return s_FormatInfo[ static_cast<int>(Format) ];
+    }
+
+    //-------------------------------------------------------------------------------
+    // Number of channels of an uncompressed (not packed) format
+    //-------------------------------------------------------------------------------
+    inline int getChannelCount( const format_info& Info ) noexcept
+    {
+        switch( Info.m_Kind )
+        {
+        case texel_kind::UNORM8:    return Info.m_BlockBytes;
+        case texel_kind::UNORM16:
+        case texel_kind::FLOAT16:   return Info.m_BlockBytes / 2;
+        case texel_kind::FLOAT32:   return Info.m_BlockBytes / 4;
+        case texel_kind::PACKED16:  return 4;
+        default:                    return 0;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Size of a side of a mip, never smaller than one texel
+    //-------------------------------------------------------------------------------
+    constexpr std::uint32_t getMipDimension( const std::uint32_t Size, const int iMip ) noexcept
+    {
+        return std::max( 1u, Size >> iMip );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Bytes used by one mip of a face, block formats round up to whole blocks
+    //-------------------------------------------------------------------------------
+    inline std::uint64_t getMipByteSize( const format_info& Info, const std::uint32_t Width, const std::uint32_t Height ) noexcept
+    {
+        const std::uint64_t nBlocksX = ( Width  + Info.m_BlockWidth  - 1 ) / Info.m_BlockWidth;
+        const std::uint64_t nBlocksY = ( Height + Info.m_BlockHeight - 1 ) / Info.m_BlockHeight;
+        return nBlocksX * nBlocksY * Info.m_BlockBytes;
+    }
+
+    //-------------------------------------------------------------------------------
+    // A whole mip with its texels in the layout of the bitmap. Only row major mips
+    // can be walked as a regular view, the others go through LoadLayoutRow and
+    // StoreLayoutRow.
+    //-------------------------------------------------------------------------------
+    inline xbitmap::view getLayoutView( xbitmap& Bitmap, const int iMip, const int iFace, const int iFrame ) noexcept
+    {
+        const auto TexelSize = getFormatInfo( Bitmap.getFormat() ).m_BlockBytes;
+        const auto W         = getMipDimension( Bitmap.getWidth(),  iMip );
+        const auto H         = getMipDimension( Bitmap.getHeight(), iMip );
+        return { Bitmap.getMip<std::byte>( iMip, iFace, iFrame ).data(), W, H, W * TexelSize, TexelSize, Bitmap.getFormat() };
+    }
+
+    inline xbitmap::const_view getLayoutView( const xbitmap& Bitmap, const int iMip, const int iFace, const int iFrame ) noexcept
+    {
+        return getLayoutView( const_cast<xbitmap&>( Bitmap ), iMip, iFace, iFrame );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Row y of a mip stored in any layout. Row major mips are read in place, the
+    // others are gathered into Scratch through getTexelIndex so the row kernels
+    // work on them without reordering the whole bitmap.
+    //-------------------------------------------------------------------------------
+    inline const std::byte* LoadLayoutRow( const xbitmap::const_view& Mip, const xbitmap::texel_layout Layout, const std::uint32_t y, std::vector<std::byte>& Scratch ) noexcept
+    {
+        if( Layout == xbitmap::texel_layout::LINEAR ) return Mip.getRow( y ).data();
+
+        const std::size_t TexelSize = Mip.m_TexelSize;
+        Scratch.resize( Mip.m_Width * TexelSize );
+        for( std::uint32_t x = 0; x < Mip.m_Width; ++x )
+        {
+            std::memcpy( &Scratch[ x * TexelSize ], &Mip.m_pData[ getTexelIndex( Layout, x, y, Mip.m_Width, Mip.m_Height ) * TexelSize ], TexelSize );
+        }
+        return Scratch.data();
+    }
+
+    //-------------------------------------------------------------------------------
+    // Scatters the texels [X0, X1) of row y of a mip that is not row major, pRow
+    // starts with texel X0
+    //-------------------------------------------------------------------------------
+    inline void StoreLayoutRow( const xbitmap::view& Mip, const xbitmap::texel_layout Layout, const std::uint32_t y, const std::uint32_t X0, const std::uint32_t X1, const std::byte* pRow ) noexcept
+    {
+        assert( Layout != xbitmap::texel_layout::LINEAR );
+
+        const std::size_t TexelSize = Mip.m_TexelSize;
+        for( std::uint32_t x = X0; x < X1; ++x )
+        {
+            std::memcpy( &Mip.m_pData[ getTexelIndex( Layout, x, y, Mip.m_Width, Mip.m_Height ) * TexelSize ], &pRow[ ( x - X0 ) * TexelSize ], TexelSize );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // IEEE half float conversions (round to nearest even, denormals supported)
+    //-------------------------------------------------------------------------------
+    inline float HalfToFloat( const std::uint16_t H ) noexcept
+    {
+        const std::uint32_t Sign = std::uint32_t( H & 0x8000u ) << 16;
+        std::uint32_t       Exp  = ( H >> 10 ) & 0x1f;
+        std::uint32_t       Mant = H & 0x3ffu;
+
+        if( Exp == 0x1f ) return std::bit_cast<float>( Sign | 0x7f800000u | ( Mant << 13 ) );
+        if( Exp == 0 )
+        {
+            if( Mant == 0 ) return std::bit_cast<float>( Sign );
+
+            // Denormal, normalize it
+            Exp = 127 - 15 + 1;
+            while( ( Mant & 0x400u ) == 0 ) { Mant <<= 1; --Exp; }
+            return std::bit_cast<float>( Sign | ( Exp << 23 ) | ( ( Mant & 0x3ffu ) << 13 ) );
+        }
+
+        return std::bit_cast<float>( Sign | ( ( Exp + 127 - 15 ) << 23 ) | ( Mant << 13 ) );
+    }
+
+    //-------------------------------------------------------------------------------
+
+    inline std::uint16_t FloatToHalf( const float F ) noexcept
+    {
+        const std::uint32_t Bits = std::bit_cast<std::uint32_t>( F );
+        const std::uint32_t Sign = ( Bits >> 16 ) & 0x8000u;
+        const std::uint32_t Abs  = Bits & 0x7fffffffu;
+
+        if( Abs >= 0x7f800000u ) return static_cast<std::uint16_t>( Sign | 0x7c00u | ( Abs > 0x7f800000u ? 0x200u : 0u ) );
+        if( Abs >= 0x477ff000u ) return static_cast<std::uint16_t>( Sign | 0x7c00u );
+        if( Abs <  0x38800000u )
+        {
+            // Denormal half
+            if( Abs < 0x33000000u ) return static_cast<std::uint16_t>( Sign );
+            const std::uint32_t Shift = 126u - ( Abs >> 23 );
+            const std::uint32_t Mant  = ( Abs & 0x7fffffu ) | 0x800000u;
+            const std::uint32_t Rem   = Mant & ( ( 1u << Shift ) - 1 );
+            const std::uint32_t Half  = 1u << ( Shift - 1 );
+            std::uint32_t       H     = Mant >> Shift;
+            if( Rem > Half || ( Rem == Half && ( H & 1 ) ) ) ++H;
+            return static_cast<std::uint16_t>( Sign | H );
+        }
+
+        std::uint32_t       H   = ( Abs - 0x38000000u ) >> 13;
+        const std::uint32_t Rem = Abs & 0x1fffu;
+        if( Rem > 0x1000u || ( Rem == 0x1000u && ( H & 1 ) ) ) ++H;
+        return static_cast<std::uint16_t>( Sign | H );
+    }
+
+    constexpr float pi_v = 3.14159265358979f;
+
+    //-------------------------------------------------------------------------------
+    // Cube map topology. Faces are in the usual +X, -X, +Y, -Y, +Z, -Z order with the
+    // D3D/GL orientation; U goes right and V goes down in [0, 1].
+    //-------------------------------------------------------------------------------
+    inline std::array<float, 3> getCubeDirection( const int iFace, const float U, const float V ) noexcept
+    {
+        const float S = 2.0f * U - 1.0f;
+        const float T = 2.0f * V - 1.0f;
+        switch( iFace )
+        {
+        case 0:  return {  1.0f, -T,    -S    };
+        case 1:  return { -1.0f, -T,     S    };
+        case 2:  return {  S,     1.0f,  T    };
+        case 3:  return {  S,    -1.0f, -T    };
+        case 4:  return {  S,    -T,     1.0f };
+        default: return { -S,    -T,    -1.0f };
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // The face a direction (does not need to be normalized) lands on and where
+    //-------------------------------------------------------------------------------
+    inline int getCubeFace( const std::array<float, 3>& Dir, float& U, float& V ) noexcept
+    {
+        const float Ax = std::abs( Dir[0] );
+        const float Ay = std::abs( Dir[1] );
+        const float Az = std::abs( Dir[2] );
+
+        int   iFace;
+        float S, T, Major;
+        if( Ax >= Ay && Ax >= Az )
+        {
+            iFace = Dir[0] >= 0 ? 0 : 1;
+            S     = Dir[0] >= 0 ? -Dir[2] : Dir[2];
+            T     = -Dir[1];
+            Major = Ax;
+        }
+        else if( Ay >= Az )
+        {
+            iFace = Dir[1] >= 0 ? 2 : 3;
+            S     = Dir[0];
+            T     = Dir[1] >= 0 ? Dir[2] : -Dir[2];
+            Major = Ay;
+        }
+        else
+        {
+            iFace = Dir[2] >= 0 ? 4 : 5;
+            S     = Dir[2] >= 0 ? Dir[0] : -Dir[0];
+            T     = -Dir[1];
+            Major = Az;
+        }
+
+        U = ( S / Major + 1.0f ) * 0.5f;
+        V = ( T / Major + 1.0f ) * 0.5f;
+        return iFace;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Resolves a texel coordinate that may fall off the face (by a few texels) into
+    // the texel of the neighbor face that covers that spot
+    //-------------------------------------------------------------------------------
+    struct cube_texel
+    {
+        int             m_iFace;
+        std::uint32_t   m_X;
+        std::uint32_t   m_Y;
+    };
+
+    inline cube_texel getCubeTexel( const int iFace, const int X, const int Y, const std::uint32_t Size ) noexcept
+    {
+        const int iSize = static_cast<int>( Size );
+        if( X >= 0 && Y >= 0 && X < iSize && Y < iSize ) return { iFace, std::uint32_t(X), std::uint32_t(Y) };
+
+        float U, V;
+        const int  iNewFace = getCubeFace( getCubeDirection( iFace, ( X + 0.5f ) / Size, ( Y + 0.5f ) / Size ), U, V );
+        const auto ToTexel  = [&]( const float T ) noexcept { return static_cast<std::uint32_t>( std::clamp( static_cast<int>( T * Size ), 0, iSize - 1 ) ); };
+        return { iNewFace, ToTexel( U ), ToTexel( V ) };
+    }
+
+    //-------------------------------------------------------------------------------
+    // Solid angle of a cube face texel, from the area of its projection on the sphere
+    //-------------------------------------------------------------------------------
+    inline float getCubeTexelSolidAngle( const std::uint32_t X, const std::uint32_t Y, const std::uint32_t Size ) noexcept
+    {
+        const auto Area = []( const float x, const float y ) noexcept { return std::atan2( x * y, std::sqrt( x * x + y * y + 1.0f ) ); };
+        const float X0  = 2.0f * X / Size - 1.0f;
+        const float X1  = 2.0f * ( X + 1 ) / Size - 1.0f;
+        const float Y0  = 2.0f * Y / Size - 1.0f;
+        const float Y1  = 2.0f * ( Y + 1 ) / Size - 1.0f;
+        return Area( X0, Y0 ) - Area( X0, Y1 ) - Area( X1, Y0 ) + Area( X1, Y1 );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Equirectangular (latitude-longitude) maps. V goes from +Y at the top to -Y at
+    // the bottom and the center of the image looks down +Z, with +X a quarter to
+    // the right.
+    //-------------------------------------------------------------------------------
+    inline std::array<float, 3> getEquirectDirection( const float U, const float V ) noexcept
+    {
+        const float Phi   = ( U - 0.5f ) * 2.0f * pi_v;
+        const float Theta = V * pi_v;
+        return { std::sin( Theta ) * std::sin( Phi ), std::cos( Theta ), std::sin( Theta ) * std::cos( Phi ) };
+    }
+
+    inline void getEquirectUV( const std::array<float, 3>& Dir, float& U, float& V ) noexcept
+    {
+        const float Length = std::sqrt( Dir[0] * Dir[0] + Dir[1] * Dir[1] + Dir[2] * Dir[2] );
+        U = std::atan2( Dir[0], Dir[2] ) * ( 0.5f / pi_v ) + 0.5f;
+        V = std::acos( std::clamp( Dir[1] / Length, -1.0f, 1.0f ) ) * ( 1.0f / pi_v );
+    }
+}
+
 //-------------------------------------------------------------------------------
 
 xerr xbitmap::Load( const std::wstring_view FileName ) noexcept
@@ -192,6 +784,12 @@ xerr xbitmap::Load( const std::wstring_view FileName ) noexcept
 
 xerr xbitmap::Save( const std::wstring_view FileName ) const noexcept
 {
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).Save( FileName );
+    }
+
     FILE* fp;
     
     if (auto Err = _wfopen_s(&fp, std::wstring(FileName).c_str(), L"wb"); Err )
@@ -230,6 +828,12 @@ xerr xbitmap::Save( const std::wstring_view FileName ) const noexcept
 
 xerr xbitmap::SaveTGA(const std::wstring_view FileName) const noexcept
 {
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).SaveTGA( FileName );
+    }
+
     std::array< std::byte, 18> Header;
 
     // The format of this picture must be in color format
@@ -343,7 +947,7 @@ void xbitmap::setup
     m_nMips             = nMips;    
     m_Flags.m_Format    = BitmapFormat;
 
-    assert( getFrameSize() == (m_DataSize / nFrames - nMips * sizeof(int)));
+    assert( getFrameSize() == (m_DataSize - nMips * sizeof(mip)) / nFrames );
     assert( [&]{auto t = getFaceCount() * getFaceSize(); return t == getFrameSize(); }() );
     assert( nFrames == getFrameCount() );
 }
@@ -562,6 +1166,57 @@ void xbitmap::CreateBitmap( const std::uint32_t Width, const std::uint32_t Heigh
     );
 }
 
+//-------------------------------------------------------------------------------
+// Allocates (zero filled) the full layout for any format, including the mip offset
+// table. Faces and frames share the same offsets.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateBitmap
+( const std::uint32_t   Width
+, const std::uint32_t   Height
+, const format          Format
+, const int             nMips
+, const int             nFrames
+, const bool            isCubeMap
+) noexcept
+{
+    assert( Width   >= 1 );
+    assert( Height  >= 1 );
+    assert( nMips   >= 1 );
+    assert( nFrames >= 1 );
+
+    const auto& Info = xbitmap_details::getFormatInfo( Format );
+    assert( Info.m_BlockBytes > 0 );
+
+    std::uint64_t FaceSize = 0;
+    for( int iMip = 0; iMip < nMips; ++iMip )
+    {
+        FaceSize += xbitmap_details::getMipByteSize( Info, xbitmap_details::getMipDimension( Width, iMip ), xbitmap_details::getMipDimension( Height, iMip ) );
+    }
+
+    const auto  TotalSize    = nMips * sizeof(mip) + FaceSize * ( isCubeMap ? 6 : 1 ) * nFrames;
+    auto        Data         = std::make_unique<std::byte[]>( TotalSize );
+    auto        pOffsetTable = reinterpret_cast<mip*>( Data.get() );
+
+    std::uint64_t Offset = 0;
+    for( int iMip = 0; iMip < nMips; ++iMip )
+    {
+        pOffsetTable[iMip].m_Offset = static_cast<std::int32_t>( Offset );
+        Offset += xbitmap_details::getMipByteSize( Info, xbitmap_details::getMipDimension( Width, iMip ), xbitmap_details::getMipDimension( Height, iMip ) );
+    }
+
+    setup
+    ( Width
+    , Height
+    , Format
+    , FaceSize
+    , { Data.release(), TotalSize }
+    , true
+    , nMips
+    , nFrames
+    , isCubeMap
+    );
+}
+
 //-------------------------------------------------------------------------------
 /*
 bool xbitmap::SaveTGA( const xstring FileName ) const noexcept
@@ -624,6 +1279,7 @@ void xbitmap::CreateFromMips( std::span<const xbitmap> MipList ) noexcept
         TotalSize += Mip.m_DataSize;
         
         assert( Mip.m_nMips   == 1 );
+        assert( Mip.m_Layout  == texel_layout::LINEAR );
     }
     
     //
@@ -693,17 +1349,5561 @@ void xbitmap::ComputePremultiplyAlpha( void ) noexcept
 
 //-------------------------------------------------------------------------------
 
-void xbitmap::FlipImageInY( void ) noexcept
+xbitmap::view xbitmap::getView( const int iMip, const int iFace, const int iFrame ) noexcept
 {
-    assert( isValid() );
-    assert( getFormat() == format::XCOLOR );
-    assert( getMipCount() == 1 );
+    assert( m_Layout == texel_layout::LINEAR );
 
-    auto pData = getMip<xcolori>(0);
-    for( std::uint32_t y = 0u, endy = m_Height / 2u; y < endy;    ++y )
-    for( std::uint32_t x = 0u;                       x < m_Width; ++x )
-    {
-        std::swap( pData[ x + y * m_Width], pData[ x + (m_Height-y-1) * m_Width] );
-    }
+    const auto& Info = xbitmap_details::getFormatInfo( getFormat() );
+    assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+
+    const auto W = xbitmap_details::getMipDimension( m_Width,  iMip );
+    const auto H = xbitmap_details::getMipDimension( m_Height, iMip );
+    return { getMip<std::byte>( iMip, iFace, iFrame ).data(), W, H, W * Info.m_BlockBytes, Info.m_BlockBytes, getFormat() };
+}
+
+//-------------------------------------------------------------------------------
+
+xbitmap::const_view xbitmap::getView( const int iMip, const int iFace, const int iFrame ) const noexcept
+{
+    return const_cast<xbitmap&>( *this ).getView( iMip, iFace, iFrame );
 }
 
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Swaps two non overlapping byte ranges, 16 bytes at a time when possible
+    //-------------------------------------------------------------------------------
+    inline void SwapBytes( std::byte* pA, std::byte* pB, const std::size_t Count ) noexcept
+    {
+        std::size_t i = 0;
+#if XBITMAP_SSE2
+        for( ; i + 16 <= Count; i += 16 )
+        {
+            const __m128i A = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pA[i] ) );
+            const __m128i B = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pB[i] ) );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &pA[i] ), B );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &pB[i] ), A );
+        }
+#endif
+        for( ; i < Count; ++i ) std::swap( pA[i], pB[i] );
+    }
+
+    //-------------------------------------------------------------------------------
+    // BC1 color block: two 565 end points then one byte of 2 bit indices per row
+    //-------------------------------------------------------------------------------
+    inline void FlipBC1Block( std::byte* pBlock, const int nRows ) noexcept
+    {
+        std::reverse( &pBlock[4], &pBlock[4 + nRows] );
+    }
+
+    //-------------------------------------------------------------------------------
+    // BC4 block: two end points then 48 bits of 3 bit indices, 12 bits per row
+    //-------------------------------------------------------------------------------
+    inline void FlipBC4Block( std::byte* pBlock, const int nRows ) noexcept
+    {
+        std::uint64_t Bits = 0;
+        for( int i = 0; i < 6; ++i ) Bits |= std::uint64_t( pBlock[2 + i] ) << ( 8 * i );
+
+        std::array<std::uint64_t, 4> Rows;
+        for( int r = 0; r < 4; ++r ) Rows[r] = ( Bits >> ( 12 * r ) ) & 0xfff;
+        std::reverse( Rows.begin(), Rows.begin() + nRows );
+
+        Bits = 0;
+        for( int r = 0; r < 4; ++r ) Bits |= Rows[r] << ( 12 * r );
+        for( int i = 0; i < 6; ++i ) pBlock[2 + i] = std::byte( Bits >> ( 8 * i ) );
+    }
+
+    //-------------------------------------------------------------------------------
+    // BC2 explicit alpha: 4 bits per texel, 2 bytes per row
+    //-------------------------------------------------------------------------------
+    inline void FlipBC2AlphaBlock( std::byte* pBlock, const int nRows ) noexcept
+    {
+        for( int r = 0, End = nRows / 2; r < End; ++r )
+        {
+            std::swap( pBlock[ 2 * r     ], pBlock[ 2 * ( nRows - 1 - r )     ] );
+            std::swap( pBlock[ 2 * r + 1 ], pBlock[ 2 * ( nRows - 1 - r ) + 1 ] );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Reverses the first nRows texel rows inside a block, nullptr for formats
+    // whose blocks can not be flipped without decoding them
+    //-------------------------------------------------------------------------------
+    using block_flip_fn = void( std::byte* pBlock, int nRows ) noexcept;
+
+    inline block_flip_fn* getBlockFlip( const xbitmap::format Format ) noexcept
+    {
+        switch( Format )
+        {
+        case xbitmap::format::BC1_4RGB:
+        case xbitmap::format::BC1_4RGBA1:       return &FlipBC1Block;
+        case xbitmap::format::BC2_8RGBA:        return []( std::byte* p, int n ) noexcept { FlipBC2AlphaBlock( p, n ); FlipBC1Block( p + 8, n ); };
+        case xbitmap::format::BC3_8RGBA:
+        case xbitmap::format::BC3_81Y0X_NORMAL: return []( std::byte* p, int n ) noexcept { FlipBC4Block( p, n );      FlipBC1Block( p + 8, n ); };
+        case xbitmap::format::BC4_4R:           return &FlipBC4Block;
+        case xbitmap::format::BC5_8RG:
+        case xbitmap::format::BC5_8YX_NORMAL:   return []( std::byte* p, int n ) noexcept { FlipBC4Block( p, n );      FlipBC4Block( p + 8, n ); };
+        default:                                return nullptr;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // 8 byte parts a BC1-BC5 block is made of, texels decoded as RGBA8 (one channel
+    // parts use R). Only used for the blocks that must be encoded again.
+    //-------------------------------------------------------------------------------
+    enum class block_part : std::uint8_t
+    { COLOR                                                         // BC1 color, 3 colors and black when c0 <= c1
+    , COLOR_A1                                                      // BC1 color, 3 colors and transparent when c0 <= c1
+    , COLOR4                                                        // BC2 and BC3 color, always 4 colors
+    , ALPHA4                                                        // BC2 explicit 4 bit alpha
+    , BC4                                                           // BC3 alpha, BC4, BC5 channels
+    };
+
+    using block_texels = std::array<std::array<std::uint8_t, 4>, 16>;
+
+    inline int getBlockParts( const xbitmap::format Format, std::array<block_part, 2>& Parts ) noexcept
+    {
+        switch( Format )
+        {
+        case xbitmap::format::BC1_4RGB:         Parts = { block_part::COLOR    };                    return 1;
+        case xbitmap::format::BC1_4RGBA1:       Parts = { block_part::COLOR_A1 };                    return 1;
+        case xbitmap::format::BC2_8RGBA:        Parts = { block_part::ALPHA4, block_part::COLOR4 };  return 2;
+        case xbitmap::format::BC3_8RGBA:
+        case xbitmap::format::BC3_81Y0X_NORMAL: Parts = { block_part::BC4,    block_part::COLOR4 };  return 2;
+        case xbitmap::format::BC4_4R:           Parts = { block_part::BC4    };                      return 1;
+        case xbitmap::format::BC5_8RG:
+        case xbitmap::format::BC5_8YX_NORMAL:   Parts = { block_part::BC4,    block_part::BC4    };  return 2;
+        default:                                return 0;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+
+    inline std::array<std::array<std::uint8_t, 4>, 4> getColorPalette( const std::uint16_t C0, const std::uint16_t C1, const bool bFourColors ) noexcept
+    {
+        const auto Expand = []( const std::uint16_t C ) noexcept
+        {
+            const int R = ( C >> 11 ) & 31, G = ( C >> 5 ) & 63, B = C & 31;
+            return std::array<std::uint8_t, 4>{ std::uint8_t( ( R << 3 ) | ( R >> 2 ) ), std::uint8_t( ( G << 2 ) | ( G >> 4 ) ), std::uint8_t( ( B << 3 ) | ( B >> 2 ) ), 255 };
+        };
+
+        std::array<std::array<std::uint8_t, 4>, 4> Palette{ Expand( C0 ), Expand( C1 ) };
+        for( int c = 0; c < 3; ++c )
+        {
+            const int A = Palette[0][c], B = Palette[1][c];
+            if( bFourColors || C0 > C1 )
+            {
+                Palette[2][c] = std::uint8_t( ( 2 * A + B + 1 ) / 3 );
+                Palette[3][c] = std::uint8_t( ( A + 2 * B + 1 ) / 3 );
+            }
+            else
+            {
+                Palette[2][c] = std::uint8_t( ( A + B + 1 ) / 2 );
+                Palette[3][c] = 0;
+            }
+        }
+        Palette[2][3] = 255;
+        Palette[3][3] = ( bFourColors || C0 > C1 ) ? 255 : 0;
+        return Palette;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    inline std::array<std::uint8_t, 8> getBC4Palette( const std::uint8_t A0, const std::uint8_t A1 ) noexcept
+    {
+        std::array<std::uint8_t, 8> Palette{ A0, A1 };
+        if( A0 > A1 ) for( int i = 1; i < 7; ++i ) Palette[ i + 1 ] = std::uint8_t( ( ( 7 - i ) * A0 + i * A1 + 3 ) / 7 );
+        else
+        {
+            for( int i = 1; i < 5; ++i ) Palette[ i + 1 ] = std::uint8_t( ( ( 5 - i ) * A0 + i * A1 + 2 ) / 5 );
+            Palette[6] = 0;
+            Palette[7] = 255;
+        }
+        return Palette;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    inline void DecodeBlockPart( const block_part Part, const std::byte* pPart, block_texels& Texels ) noexcept
+    {
+        const auto Byte = [&]( const int i ) noexcept { return std::to_integer<std::uint32_t>( pPart[i] ); };
+
+        switch( Part )
+        {
+        case block_part::COLOR:
+        case block_part::COLOR_A1:
+        case block_part::COLOR4:
+        {
+            const auto Palette = getColorPalette( std::uint16_t( Byte(0) | Byte(1) << 8 ), std::uint16_t( Byte(2) | Byte(3) << 8 ), Part == block_part::COLOR4 );
+            for( int i = 0; i < 16; ++i ) Texels[i] = Palette[ ( Byte( 4 + i / 4 ) >> ( 2 * ( i % 4 ) ) ) & 3 ];
+
+            // Without alpha the last entry of a 3 color block is opaque black
+            if( Part == block_part::COLOR ) for( auto& T : Texels ) T[3] = 255;
+            break;
+        }
+        case block_part::ALPHA4:
+            for( int i = 0; i < 16; ++i ) Texels[i][0] = std::uint8_t( ( ( Byte( i / 2 ) >> ( 4 * ( i % 2 ) ) ) & 15 ) * 17 );
+            break;
+        case block_part::BC4:
+        {
+            const auto    Palette = getBC4Palette( std::uint8_t( Byte(0) ), std::uint8_t( Byte(1) ) );
+            std::uint64_t Bits    = 0;
+            for( int i = 0; i < 6; ++i ) Bits |= std::uint64_t( Byte( 2 + i ) ) << ( 8 * i );
+            for( int i = 0; i < 16; ++i ) Texels[i][0] = Palette[ ( Bits >> ( 3 * i ) ) & 7 ];
+            break;
+        }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Plain fit: the end points are the extremes of the texels (the two colors
+    // furthest apart), every texel takes the nearest entry of the palette. BC1
+    // blocks with black (transparent for BC1_4RGBA1) texels use the 3 color mode
+    // so those texels stay exact.
+    //-------------------------------------------------------------------------------
+    inline void EncodeBlockPart( const block_part Part, const block_texels& Texels, std::byte* pPart ) noexcept
+    {
+        const auto Nearest = []( const auto& Palette, const int nEntries, const auto& Distance ) noexcept
+        {
+            int Best = 0;
+            for( int k = 1; k < nEntries; ++k ) if( Distance( Palette[k] ) < Distance( Palette[Best] ) ) Best = k;
+            return Best;
+        };
+
+        switch( Part )
+        {
+        case block_part::COLOR:
+        case block_part::COLOR_A1:
+        case block_part::COLOR4:
+        {
+            // Texels that take the last entry of a 3 color block
+            const auto isPunched = [&]( const int i ) noexcept
+            {
+                if( Part == block_part::COLOR_A1 ) return Texels[i][3] < 128;
+                if( Part == block_part::COLOR    ) return ( Texels[i][0] | Texels[i][1] | Texels[i][2] ) == 0;
+                return false;
+            };
+
+            bool bPunched = false;
+            for( int i = 0; i < 16; ++i ) bPunched = bPunched || isPunched( i );
+
+            const auto isOpaque = [&]( const int i ) noexcept { return bPunched == false || isPunched( i ) == false; };
+            const auto Distance = []( const auto& A, const auto& B ) noexcept
+            {
+                int D = 0;
+                for( int c = 0; c < 3; ++c ) D += ( int( A[c] ) - B[c] ) * ( int( A[c] ) - B[c] );
+                return D;
+            };
+            const auto To565 = []( const std::array<std::uint8_t, 4>& C ) noexcept
+            {
+                return std::uint16_t( ( ( C[0] * 31 + 127 ) / 255 ) << 11 | ( ( C[1] * 63 + 127 ) / 255 ) << 5 | ( C[2] * 31 + 127 ) / 255 );
+            };
+
+            int iA = -1, iB = -1, Best = -1;
+            for( int i = 0; i < 16; ++i ) if( isOpaque( i ) )
+            for( int j = i; j < 16; ++j ) if( isOpaque( j ) && Distance( Texels[i], Texels[j] ) > Best )
+            {
+                Best = Distance( Texels[i], Texels[j] );
+                iA   = i;
+                iB   = j;
+            }
+
+            // Orders the end points for the mode and picks the indices, returns the squared error
+            const auto Fit = [&]( std::uint16_t& C0, std::uint16_t& C1, std::uint32_t& Indices ) noexcept
+            {
+                if( bPunched ? C0 > C1 : C0 < C1 ) std::swap( C0, C1 );
+
+                const auto Palette  = getColorPalette( C0, C1, Part == block_part::COLOR4 );
+                const int  nEntries = ( Part == block_part::COLOR4 || C0 > C1 ) ? 4 : 3;
+                int        Error    = 0;
+                Indices = 0;
+                for( int i = 0; i < 16; ++i )
+                {
+                    const int Index = isOpaque( i ) ? Nearest( Palette, nEntries, [&]( const auto& P ) noexcept { return Distance( P, Texels[i] ); } ) : 3;
+                    if( isOpaque( i ) ) Error += Distance( Palette[Index], Texels[i] );
+                    Indices |= std::uint32_t( Index ) << ( 2 * i );
+                }
+                return Error;
+            };
+
+            std::uint16_t C0      = iA < 0 ? 0 : To565( Texels[iA] );
+            std::uint16_t C1      = iB < 0 ? 0 : To565( Texels[iB] );
+            std::uint32_t Indices = 0;
+            const int     Error   = Fit( C0, C1, Indices );
+
+            // One least squares pass moves the end points toward the texels that picked them,
+            // kept when it does better. Weight of C0 for each index of the mode.
+            const bool                 bFour  = Part == block_part::COLOR4 || C0 > C1;
+            const std::array<float, 4> Weight { 1.0f, 0.0f, bFour ? 2 / 3.0f : 0.5f, 1 / 3.0f };
+            float                      AA = 0, AB = 0, BB = 0;
+            std::array<float, 3>       AX{}, BX{};
+            for( int i = 0; i < 16; ++i ) if( isOpaque( i ) )
+            {
+                const float A = Weight[ ( Indices >> ( 2 * i ) ) & 3 ], B = 1 - A;
+                AA += A * A;
+                AB += A * B;
+                BB += B * B;
+                for( int c = 0; c < 3; ++c )
+                {
+                    AX[c] += A * Texels[i][c];
+                    BX[c] += B * Texels[i][c];
+                }
+            }
+
+            if( const float Det = AA * BB - AB * AB; std::abs( Det ) > 1e-3f )
+            {
+                std::array<std::uint8_t, 4> E0{}, E1{};
+                for( int c = 0; c < 3; ++c )
+                {
+                    E0[c] = static_cast<std::uint8_t>( std::clamp( ( AX[c] * BB - BX[c] * AB ) / Det, 0.0f, 255.0f ) + 0.5f );
+                    E1[c] = static_cast<std::uint8_t>( std::clamp( ( BX[c] * AA - AX[c] * AB ) / Det, 0.0f, 255.0f ) + 0.5f );
+                }
+
+                std::uint16_t N0 = To565( E0 ), N1 = To565( E1 );
+                std::uint32_t NewIndices;
+                if( Fit( N0, N1, NewIndices ) < Error )
+                {
+                    C0      = N0;
+                    C1      = N1;
+                    Indices = NewIndices;
+                }
+            }
+
+            pPart[0] = std::byte( C0 );
+            pPart[1] = std::byte( C0 >> 8 );
+            pPart[2] = std::byte( C1 );
+            pPart[3] = std::byte( C1 >> 8 );
+            for( int i = 0; i < 4; ++i ) pPart[ 4 + i ] = std::byte( Indices >> ( 8 * i ) );
+            break;
+        }
+        case block_part::ALPHA4:
+            for( int i = 0; i < 8; ++i ) pPart[i] = std::byte( ( Texels[ 2 * i ][0] + 8 ) / 17 | ( ( Texels[ 2 * i + 1 ][0] + 8 ) / 17 ) << 4 );
+            break;
+        case block_part::BC4:
+        {
+            const auto [Lo, Hi] = std::minmax_element( Texels.begin(), Texels.end(), []( const auto& A, const auto& B ) noexcept { return A[0] < B[0]; } );
+            const auto Palette  = getBC4Palette( ( *Hi )[0], ( *Lo )[0] );
+
+            std::uint64_t Bits = 0;
+            for( int i = 0; i < 16; ++i )
+            {
+                const int Index = Nearest( Palette, 8, [&]( const std::uint8_t P ) noexcept { return std::abs( int( P ) - Texels[i][0] ); } );
+                Bits |= std::uint64_t( Index ) << ( 3 * i );
+            }
+
+            pPart[0] = std::byte( ( *Hi )[0] );
+            pPart[1] = std::byte( ( *Lo )[0] );
+            for( int i = 0; i < 6; ++i ) pPart[ 2 + i ] = std::byte( Bits >> ( 8 * i ) );
+            break;
+        }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Flips a mip whose height is not a multiple of the block height. Every block
+    // row of the result takes texel rows of two source blocks, so each column of
+    // blocks is decoded, flipped by texel rows and encoded again. That is exact for
+    // BC2 alpha but the color and BC4 parts get a fresh fit, which is lossy unless
+    // the texels of a block sit on the palette of its new end points. The rows below
+    // the mip in the last block row repeat its last row.
+    //-------------------------------------------------------------------------------
+    inline void FlipPartialBlockRows( const xbitmap::format Format, std::byte* pData, const std::uint32_t nColumns, const std::uint32_t nRows, const std::uint32_t Height ) noexcept
+    {
+        std::array<block_part, 2> Parts;
+        const int                 nParts    = getBlockParts( Format, Parts );
+        const auto                BlockSize = static_cast<std::size_t>( 8 * nParts );
+        assert( nParts > 0 );
+
+        ParallelFor( nColumns, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<std::array<std::uint8_t, 4>> Column( std::size_t(nRows) * 16 );        // 4 texels per row, row major
+            block_texels                             Texels;
+
+            for( auto x = Begin; x < End; ++x )
+            for( int  p = 0; p < nParts; ++p )
+            {
+                const auto getPart = [&]( const std::uint32_t y ) noexcept { return &pData[ ( std::size_t(y) * nColumns + x ) * BlockSize + 8 * p ]; };
+
+                for( std::uint32_t y = 0; y < nRows; ++y )
+                {
+                    DecodeBlockPart( Parts[p], getPart( y ), Texels );
+                    std::copy( Texels.begin(), Texels.end(), &Column[ std::size_t(y) * 16 ] );
+                }
+
+                for( std::uint32_t r = 0; r < Height / 2; ++r ) std::swap_ranges( &Column[ r * 4 ], &Column[ r * 4 + 4 ], &Column[ ( Height - 1 - r ) * 4 ] );
+                for( std::uint32_t r = Height; r < nRows * 4; ++r ) std::copy_n( &Column[ ( Height - 1 ) * 4 ], 4, &Column[ r * 4 ] );
+
+                for( std::uint32_t y = 0; y < nRows; ++y )
+                {
+                    std::copy_n( &Column[ std::size_t(y) * 16 ], 16, Texels.begin() );
+                    EncodeBlockPart( Parts[p], Texels, getPart( y ) );
+                }
+            }
+        });
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Swaps whole rows (block rows for BC1-BC5) of every mip, face and frame.
+// Block formats flip the rows inside each block too, which only lines up when
+// the height of the mip is a multiple of 4 or smaller than a block. Other block
+// mips are decoded and encoded again (lossy), see FlipPartialBlockRows.
+//-------------------------------------------------------------------------------
+void xbitmap::FlipImageInY( void ) noexcept
+{
+    assert( isValid() );
+
+    xbitmap_details::linear_scope Linear( *this );
+
+    const auto& Info  = xbitmap_details::getFormatInfo( getFormat() );
+    const auto  pFlip = xbitmap_details::getBlockFlip( getFormat() );
+    assert( ( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes ) || pFlip );
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    for( int iFace  = 0; iFace  < getFaceCount();  ++iFace  )
+    for( int iMip   = 0; iMip   < getMipCount();   ++iMip   )
+    {
+        const auto W        = xbitmap_details::getMipDimension( m_Width,  iMip );
+        const auto H        = xbitmap_details::getMipDimension( m_Height, iMip );
+        const auto nRows    = ( H + Info.m_BlockHeight - 1 ) / Info.m_BlockHeight;
+        const auto nColumns = ( W + Info.m_BlockWidth  - 1 ) / Info.m_BlockWidth;
+        const auto RowBytes = std::size_t( nColumns ) * Info.m_BlockBytes;
+        auto       pData    = getMip<std::byte>( iMip, iFace, iFrame ).data();
+
+        if( pFlip && H > Info.m_BlockHeight && ( H % Info.m_BlockHeight ) )
+        {
+            xbitmap_details::FlipPartialBlockRows( getFormat(), pData, nColumns, nRows, H );
+            continue;
+        }
+
+        xbitmap_details::ParallelFor( ( nRows + 1 ) / 2, 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( std::uint32_t y = Begin; y < End; ++y )
+            {
+                const auto y2 = nRows - 1 - y;
+                if( y != y2 ) xbitmap_details::SwapBytes( &pData[ y * RowBytes ], &pData[ y2 * RowBytes ], RowBytes );
+
+                if( pFlip == nullptr ) continue;
+
+                const int nBlockRows = static_cast<int>( std::min<std::uint32_t>( H, Info.m_BlockHeight ) );
+                for( std::uint32_t x = 0; x < nColumns; ++x )
+                {
+                    pFlip( &pData[ y * RowBytes + x * Info.m_BlockBytes ], nBlockRows );
+                    if( y != y2 ) pFlip( &pData[ y2 * RowBytes + x * Info.m_BlockBytes ], nBlockRows );
+                }
+            }
+        });
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::FlipImageInY( const view& View ) noexcept
+{
+    const auto RowBytes = std::size_t( View.m_Width ) * View.m_TexelSize;
+
+    xbitmap_details::ParallelFor( View.m_Height / 2, 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        for( std::uint32_t y = Begin; y < End; ++y )
+        {
+            xbitmap_details::SwapBytes( View.getRow( y ).data(), View.getRow( View.m_Height - 1 - y ).data(), RowBytes );
+        }
+    });
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+// NORMAL MAPS
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // All the texels of the bitmap (every mip, face and frame) as one contiguous span
+    //-------------------------------------------------------------------------------
+    template< typename T >
+    std::span<T> getAllTexels( xbitmap& Bitmap ) noexcept
+    {
+        const auto Bytes = Bitmap.getDataSize() - Bitmap.getMipCount() * sizeof(xbitmap::mip);
+        return { reinterpret_cast<T*>( &Bitmap.m_pData[ Bitmap.getMipCount() ] ), static_cast<std::size_t>( Bytes / sizeof(T) ) };
+    }
+
+    //-------------------------------------------------------------------------------
+    // Reads the first channel of a row of texels as a float height
+    //-------------------------------------------------------------------------------
+    static void DecodeHeightRow( const xbitmap::format Format, const std::byte* pRow, const std::uint32_t Width, float* pDest ) noexcept
+    {
+        auto ReadFloats = [&]( const std::uint32_t Stride )
+        {
+            for( auto x = 0u; x < Width; ++x ) std::memcpy( &pDest[x], &pRow[ x * Stride ], sizeof(float) );
+        };
+
+        switch( Format )
+        {
+        case xbitmap::format::R8:
+            for( auto x = 0u; x < Width; ++x ) pDest[x] = static_cast<std::uint8_t>(pRow[x]) * (1.0f / 0xff);
+            break;
+        case xbitmap::format::R8G8B8A8:
+        case xbitmap::format::R8G8B8U8:
+            for( auto x = 0u; x < Width; ++x ) pDest[x] = static_cast<std::uint8_t>(pRow[x*4]) * (1.0f / 0xff);
+            break;
+        case xbitmap::format::R32_FLOAT:            ReadFloats(  4 ); break;
+        case xbitmap::format::R32G32_FLOAT:         ReadFloats(  8 ); break;
+        case xbitmap::format::R32G32B32_FLOAT:      ReadFloats( 12 ); break;
+        case xbitmap::format::R32G32B32A32_FLOAT:   ReadFloats( 16 ); break;
+        default:
+        {
+            // Any of the xcolor formats
+            assert( static_cast<int>(Format) < static_cast<int>(xbitmap::format::XCOLOR_END) );
+            const xcolor::format Fmt  { static_cast<xcolor::format::type>(Format) };
+            const auto           Bytes = static_cast<std::uint32_t>( Fmt.getDescriptor().m_TB / 8 );
+            for( auto x = 0u; x < Width; ++x )
+            {
+                std::uint32_t Raw = 0;
+                std::memcpy( &Raw, &pRow[ x * Bytes ], Bytes );
+                pDest[x] = xcolori( Raw, Fmt ).m_R * (1.0f / 0xff);
+            }
+            break;
+        }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Encodes a normal the same way xcolori::setupFromNormal does: (N + 1) * 127 + 0.5
+    //-------------------------------------------------------------------------------
+    inline std::uint32_t EncodeNormal( float X, float Y, float Z ) noexcept
+    {
+        const auto Enc = []( float V ) noexcept { return static_cast<std::uint32_t>( std::clamp( V * 127.0f + 127.5f, 0.0f, 255.0f ) ); };
+        return Enc(X) | (Enc(Y) << 8) | (Enc(Z) << 16) | 0xff000000u;
+    }
+
+#if XBITMAP_SSE2
+    //-------------------------------------------------------------------------------
+    // Same as EncodeNormal but for 4 normals at once, returns 4 packed xcolori
+    //-------------------------------------------------------------------------------
+    inline __m128i EncodeNormal4( __m128 X, __m128 Y, __m128 Z ) noexcept
+    {
+        const auto Scale = _mm_set1_ps( 127.0f );
+        const auto Bias  = _mm_set1_ps( 127.5f );
+        const auto Zero  = _mm_setzero_ps();
+        const auto Max   = _mm_set1_ps( 255.0f );
+        const auto Enc   = [&]( __m128 V ) noexcept
+        {
+            return _mm_cvttps_epi32( _mm_min_ps( Max, _mm_max_ps( Zero, _mm_add_ps( _mm_mul_ps( V, Scale ), Bias ) ) ) );
+        };
+
+        return _mm_or_si128( _mm_or_si128( Enc(X), _mm_slli_epi32( Enc(Y), 8 ) )
+                           , _mm_or_si128( _mm_slli_epi32( Enc(Z), 16 ), _mm_set1_epi32( static_cast<int>(0xff000000u) ) ) );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Decodes the R, G, B channels of 4 packed xcolori as (C - 127) / 127
+    //-------------------------------------------------------------------------------
+    inline void DecodeNormal4( __m128i Pixels, __m128& X, __m128& Y, __m128& Z ) noexcept
+    {
+        const auto Mask  = _mm_set1_epi32( 0xff );
+        const auto Bias  = _mm_set1_ps( 127.0f );
+        const auto Scale = _mm_set1_ps( 1.0f / 127.0f );
+
+        X = _mm_mul_ps( _mm_sub_ps( _mm_cvtepi32_ps( _mm_and_si128( Pixels, Mask ) ),                      Bias ), Scale );
+        Y = _mm_mul_ps( _mm_sub_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( Pixels,  8 ), Mask ) ), Bias ), Scale );
+        Z = _mm_mul_ps( _mm_sub_ps( _mm_cvtepi32_ps( _mm_and_si128( _mm_srli_epi32( Pixels, 16 ), Mask ) ), Bias ), Scale );
+    }
+#endif
+}
+
+//-------------------------------------------------------------------------------
+// Builds a tangent space normal map (R=X, G=Y up, B=Z) from the first channel of
+// mip 0. The derivatives are taken with a 3x3 Sobel or Scharr kernel and the
+// borders follow the U/V wrap modes of this bitmap. Rows are processed in bands
+// across threads, each band keeps a rolling window of 3 decoded rows.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateNormalMapFromHeight( xbitmap& Dest, const float Strength, const normal_kernel Kernel ) const noexcept
+{
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).CreateNormalMapFromHeight( Dest, Strength, Kernel );
+    }
+
+    assert( isValid() );
+    assert( &Dest != this );
+    assert( Kernel < normal_kernel::ENUM_COUNT );
+
+    const auto  Width       = static_cast<int>(getWidth());
+    const auto  Height      = static_cast<int>(getHeight());
+    const auto  Format      = getFormat();
+    const auto  UMode       = getUWrapMode();
+    const auto  VMode       = getVWrapMode();
+    const auto  ClampHeight = m_ClampColor.m_R * (1.0f / 0xff);
+    const auto  pSrc        = static_cast<const std::byte*>( getMipPtr( 0, 0, 0 ) );
+    const auto  RowPitch    = getMipSize(0) / getHeight();
+
+    // Side and center weights of the smoothing part of the kernel, normalized so a
+    // slope of one height unit per texel gives a derivative of one
+    const float Side        = Kernel == normal_kernel::SOBEL ? 1.0f        :  3.0f;
+    const float Center      = Kernel == normal_kernel::SOBEL ? 2.0f        : 10.0f;
+    const float Norm        = Kernel == normal_kernel::SOBEL ? 1.0f / 8.0f :  1.0f / 32.0f;
+
+    Dest.CreateBitmap( getWidth(), getHeight() );
+    Dest.setUWrapMode( UMode );
+    Dest.setVWrapMode( VMode );
+    Dest.setColorSpace( color_space::LINEAR );
+
+    auto pDest = Dest.getMip<std::uint32_t>(0).data();
+
+    xbitmap_details::ParallelFor( getHeight(), 16, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        // Rolling window of rows with one texel of padding at each side
+        std::vector<float> Rows( 3 * (Width + 2) );
+        std::array<float*, 3> pRow{ &Rows[0], &Rows[ Width + 2 ], &Rows[ 2 * (Width + 2) ] };
+
+        auto LoadRow = [&]( float* pRowData, const int y ) noexcept
+        {
+            if( const auto iY = xbitmap_details::WrapCoordinate( y, Height, VMode ); iY < 0 )
+            {
+                std::fill_n( pRowData, Width + 2, ClampHeight );
+            }
+            else
+            {
+                xbitmap_details::DecodeHeightRow( Format, &pSrc[ iY * RowPitch ], Width, &pRowData[1] );
+
+                const auto iL = xbitmap_details::WrapCoordinate( -1,    Width, UMode );
+                const auto iR = xbitmap_details::WrapCoordinate( Width, Width, UMode );
+                pRowData[0]         = iL < 0 ? ClampHeight : pRowData[ 1 + iL ];
+                pRowData[Width + 1] = iR < 0 ? ClampHeight : pRowData[ 1 + iR ];
+            }
+        };
+
+        LoadRow( pRow[0], static_cast<int>(Begin) - 1 );
+        LoadRow( pRow[1], static_cast<int>(Begin)     );
+
+        for( auto y = Begin; y < End; ++y )
+        {
+            LoadRow( pRow[2], static_cast<int>(y) + 1 );
+
+            const float* pT   = pRow[0];
+            const float* pC   = pRow[1];
+            const float* pB   = pRow[2];
+            auto         pOut = &pDest[ y * Width ];
+            int          x    = 0;
+
+#if XBITMAP_SSE2
+            {
+                const auto vSide   = _mm_set1_ps( Side );
+                const auto vCenter = _mm_set1_ps( Center );
+                const auto vScale  = _mm_set1_ps( Norm * Strength );
+                const auto vOne    = _mm_set1_ps( 1.0f );
+
+                for( ; x + 4 <= Width; x += 4 )
+                {
+                    const auto TL = _mm_loadu_ps( &pT[x] ), T = _mm_loadu_ps( &pT[x+1] ), TR = _mm_loadu_ps( &pT[x+2] );
+                    const auto L  = _mm_loadu_ps( &pC[x] ),                               R  = _mm_loadu_ps( &pC[x+2] );
+                    const auto BL = _mm_loadu_ps( &pB[x] ), B = _mm_loadu_ps( &pB[x+1] ), BR = _mm_loadu_ps( &pB[x+2] );
+
+                    const auto Gx = _mm_mul_ps( vScale, _mm_add_ps( _mm_mul_ps( vSide,   _mm_add_ps( _mm_sub_ps( TR, TL ), _mm_sub_ps( BR, BL ) ) )
+                                                                  , _mm_mul_ps( vCenter, _mm_sub_ps( R, L ) ) ) );
+                    const auto Gy = _mm_mul_ps( vScale, _mm_add_ps( _mm_mul_ps( vSide,   _mm_add_ps( _mm_sub_ps( BL, TL ), _mm_sub_ps( BR, TR ) ) )
+                                                                  , _mm_mul_ps( vCenter, _mm_sub_ps( B, T ) ) ) );
+
+                    // N = normalize( -dH/dx, dH/dy, 1 ), Y is flipped since the rows go down
+                    const auto InvLen = _mm_div_ps( vOne, _mm_sqrt_ps( _mm_add_ps( vOne, _mm_add_ps( _mm_mul_ps( Gx, Gx ), _mm_mul_ps( Gy, Gy ) ) ) ) );
+                    const auto Nx     = _mm_sub_ps( _mm_setzero_ps(), _mm_mul_ps( Gx, InvLen ) );
+                    const auto Ny     = _mm_mul_ps( Gy, InvLen );
+
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( &pOut[x] ), xbitmap_details::EncodeNormal4( Nx, Ny, InvLen ) );
+                }
+            }
+#endif
+            for( ; x < Width; ++x )
+            {
+                const float Gx = Norm * Strength * ( Side * ( (pT[x+2] - pT[x]) + (pB[x+2] - pB[x]) ) + Center * ( pC[x+2] - pC[x]   ) );
+                const float Gy = Norm * Strength * ( Side * ( (pB[x]   - pT[x]) + (pB[x+2] - pT[x+2]) ) + Center * ( pB[x+1] - pT[x+1] ) );
+                const float InvLen = 1.0f / std::sqrt( 1.0f + Gx * Gx + Gy * Gy );
+                pOut[x] = xbitmap_details::EncodeNormal( -Gx * InvLen, Gy * InvLen, InvLen );
+            }
+
+            // Slide the window down
+            std::rotate( pRow.begin(), pRow.begin() + 1, pRow.end() );
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+// Two channel normal maps (BC5 style, R=X G=Y) get their Z rebuilt as
+// sqrt(1 - X^2 - Y^2) and stored back in B. Applies to every mip, face and frame.
+//-------------------------------------------------------------------------------
+void xbitmap::ReconstructNormalZ( void ) noexcept
+{
+    assert( isValid() );
+    assert( getFormat() == format::XCOLOR );
+
+    auto Texels = xbitmap_details::getAllTexels<std::uint32_t>( *this );
+
+    xbitmap_details::ParallelFor( static_cast<std::uint32_t>(Texels.size()), 1u << 14, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        auto i = Begin;
+
+#if XBITMAP_SSE2
+        const auto vOne  = _mm_set1_ps( 1.0f );
+        const auto vZero = _mm_setzero_ps();
+        for( ; i + 4 <= End; i += 4 )
+        {
+            auto    pPixels = reinterpret_cast<__m128i*>( &Texels[i] );
+            const auto Pixels = _mm_loadu_si128( pPixels );
+            __m128  X, Y, Z;
+            xbitmap_details::DecodeNormal4( Pixels, X, Y, Z );
+            Z = _mm_sqrt_ps( _mm_max_ps( vZero, _mm_sub_ps( vOne, _mm_add_ps( _mm_mul_ps( X, X ), _mm_mul_ps( Y, Y ) ) ) ) );
+
+            // Keep R, G and A untouched, only B is replaced
+            const auto NewB = _mm_and_si128( xbitmap_details::EncodeNormal4( X, Y, Z ), _mm_set1_epi32( 0x00ff0000 ) );
+            _mm_storeu_si128( pPixels, _mm_or_si128( _mm_and_si128( Pixels, _mm_set1_epi32( static_cast<int>(0xff00ffffu) ) ), NewB ) );
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            const float X = ( static_cast<float>( (Texels[i] >> 0) & 0xff ) - 127.0f ) * (1.0f / 127.0f);
+            const float Y = ( static_cast<float>( (Texels[i] >> 8) & 0xff ) - 127.0f ) * (1.0f / 127.0f);
+            const float Z = std::sqrt( std::max( 0.0f, 1.0f - X * X - Y * Y ) );
+            Texels[i] = ( Texels[i] & 0xff00ffffu ) | ( xbitmap_details::EncodeNormal( X, Y, Z ) & 0x00ff0000u );
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::PackNormals( std::span<xcolori> Dest, std::span<const std::array<float,3>> Normals ) noexcept
+{
+    assert( Dest.size() >= Normals.size() );
+
+    xbitmap_details::ParallelFor( static_cast<std::uint32_t>(Normals.size()), 1u << 14, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        auto i = Begin;
+
+#if XBITMAP_SSE2
+        for( ; i + 4 <= End; i += 4 )
+        {
+            const auto& N = Normals;
+            const auto  X = _mm_setr_ps( N[i][0], N[i+1][0], N[i+2][0], N[i+3][0] );
+            const auto  Y = _mm_setr_ps( N[i][1], N[i+1][1], N[i+2][1], N[i+3][1] );
+            const auto  Z = _mm_setr_ps( N[i][2], N[i+1][2], N[i+2][2], N[i+3][2] );
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( &Dest[i] ), xbitmap_details::EncodeNormal4( X, Y, Z ) );
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            Dest[i].m_Value = xbitmap_details::EncodeNormal( Normals[i][0], Normals[i][1], Normals[i][2] );
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::UnpackNormals( std::span<std::array<float,3>> Dest, std::span<const xcolori> Colors ) noexcept
+{
+    assert( Dest.size() >= Colors.size() );
+
+    xbitmap_details::ParallelFor( static_cast<std::uint32_t>(Colors.size()), 1u << 14, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        auto i = Begin;
+
+#if XBITMAP_SSE2
+        for( ; i + 4 <= End; i += 4 )
+        {
+            alignas(16) std::array<std::array<float,4>,3> V;
+            __m128 X, Y, Z;
+            xbitmap_details::DecodeNormal4( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Colors[i] ) ), X, Y, Z );
+            _mm_store_ps( V[0].data(), X );
+            _mm_store_ps( V[1].data(), Y );
+            _mm_store_ps( V[2].data(), Z );
+            for( int k = 0; k < 4; ++k ) Dest[i + k] = { V[0][k], V[1][k], V[2][k] };
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            Dest[i] = Colors[i].getNormal();
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::UnpackNormalsXY( std::span<std::array<float,3>> Dest, std::span<const xcolori> Colors ) noexcept
+{
+    assert( Dest.size() >= Colors.size() );
+
+    xbitmap_details::ParallelFor( static_cast<std::uint32_t>(Colors.size()), 1u << 14, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        auto i = Begin;
+
+#if XBITMAP_SSE2
+        const auto vOne  = _mm_set1_ps( 1.0f );
+        const auto vZero = _mm_setzero_ps();
+        for( ; i + 4 <= End; i += 4 )
+        {
+            alignas(16) std::array<std::array<float,4>,3> V;
+            __m128 X, Y, Z;
+            xbitmap_details::DecodeNormal4( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Colors[i] ) ), X, Y, Z );
+            Z = _mm_sqrt_ps( _mm_max_ps( vZero, _mm_sub_ps( vOne, _mm_add_ps( _mm_mul_ps( X, X ), _mm_mul_ps( Y, Y ) ) ) ) );
+            _mm_store_ps( V[0].data(), X );
+            _mm_store_ps( V[1].data(), Y );
+            _mm_store_ps( V[2].data(), Z );
+            for( int k = 0; k < 4; ++k ) Dest[i + k] = { V[0][k], V[1][k], V[2][k] };
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            const auto N = Colors[i].getNormal();
+            Dest[i] = { N[0], N[1], std::sqrt( std::max( 0.0f, 1.0f - N[0] * N[0] - N[1] * N[1] ) ) };
+        }
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// SATURATING ARITHMETIC
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    enum class byte_op : std::uint8_t
+    { ADD
+    , SUBTRACT
+    , MULTIPLY
+    };
+
+    //-------------------------------------------------------------------------------
+    // For each byte of a texel tells which channel (0=R, 1=G, 2=B, 3=A) it holds, -1 if
+    // unused. Returns the size of the texel in bytes, 0 if the format is not 8 bits per
+    // channel with a size that divides 16 (R8 and the 32 bit xcolor formats)
+    //-------------------------------------------------------------------------------
+    static int getByteChannels( const xbitmap::format Format, std::array<int, 4>& Channels ) noexcept
+    {
+        Channels = { -1, -1, -1, -1 };
+
+        if( Format == xbitmap::format::R8 )
+        {
+            Channels[0] = 0;
+            return 1;
+        }
+
+        if( static_cast<int>(Format) >= static_cast<int>(xbitmap::format::XCOLOR_END) ) return 0;
+
+        const auto& Desc = xcolor::format{ static_cast<xcolor::format::type>(Format) }.getDescriptor();
+        if( Desc.m_TB != 32 ) return 0;
+
+        const std::array<std::uint32_t, 4> Masks{ Desc.m_RMask, Desc.m_GMask, Desc.m_BMask, Desc.m_AMask };
+        for( int iByte = 0; iByte < 4; ++iByte )
+        for( int iChannel = 0; iChannel < 4; ++iChannel )
+        {
+            if( (Masks[iChannel] >> (8 * iByte)) & 0xff ) Channels[iByte] = iChannel;
+        }
+
+        return 4;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    template< byte_op T_OP >
+    inline std::uint8_t ByteOp( const std::uint8_t A, const std::uint8_t B ) noexcept
+    {
+        if constexpr ( T_OP == byte_op::ADD )           return static_cast<std::uint8_t>( std::min( 0xffu, std::uint32_t(A) + B ) );
+        else if constexpr ( T_OP == byte_op::SUBTRACT ) return static_cast<std::uint8_t>( A > B ? A - B : 0 );
+        else                                            return xcolor::details::MulDiv255( A, B );
+    }
+
+#if XBITMAP_SSE2
+    //-------------------------------------------------------------------------------
+    // 16 channels at a time. The multiply widens to 16 bits and does the exact
+    // round(a*b/255) as (t + (t >> 8)) >> 8 with t = a*b + 128
+    //-------------------------------------------------------------------------------
+    template< byte_op T_OP >
+    inline __m128i ByteOp16( const __m128i A, const __m128i B ) noexcept
+    {
+        if constexpr ( T_OP == byte_op::ADD )           return _mm_adds_epu8( A, B );
+        else if constexpr ( T_OP == byte_op::SUBTRACT ) return _mm_subs_epu8( A, B );
+        else
+        {
+            const auto Zero = _mm_setzero_si128();
+            const auto Half = _mm_set1_epi16( 128 );
+            const auto Mul  = [&]( const __m128i a, const __m128i b ) noexcept
+            {
+                const auto T = _mm_add_epi16( _mm_mullo_epi16( a, b ), Half );
+                return _mm_srli_epi16( _mm_add_epi16( T, _mm_srli_epi16( T, 8 ) ), 8 );
+            };
+
+            return _mm_packus_epi16( Mul( _mm_unpacklo_epi8( A, Zero ), _mm_unpacklo_epi8( B, Zero ) )
+                                   , Mul( _mm_unpackhi_epi8( A, Zero ), _mm_unpackhi_epi8( B, Zero ) ) );
+        }
+    }
+#endif
+
+    //-------------------------------------------------------------------------------
+    // Dest = Dest op Src. When bBroadcast is set pSrc is a 16 byte pattern that repeats
+    //-------------------------------------------------------------------------------
+    template< byte_op T_OP >
+    void ApplyByteOpRange( std::uint8_t* pD, const std::uint8_t* pS, const bool bBroadcast, const std::size_t Begin, const std::size_t End ) noexcept
+    {
+        auto i = Begin;
+#if XBITMAP_SSE2
+        // Only a pattern is known to have 16 bytes, a plain source may be shorter
+        const auto Pattern = bBroadcast ? _mm_loadu_si128( reinterpret_cast<const __m128i*>( pS ) ) : _mm_setzero_si128();
+        for( ; i + 16 <= End; i += 16 )
+        {
+            const auto S = bBroadcast ? Pattern : _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pS[i] ) );
+            auto       D = reinterpret_cast<__m128i*>( &pD[i] );
+            _mm_storeu_si128( D, ByteOp16<T_OP>( _mm_loadu_si128( D ), S ) );
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            pD[i] = ByteOp<T_OP>( pD[i], bBroadcast ? pS[ i & 15 ] : pS[i] );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+
+    template< byte_op T_OP >
+    void ApplyByteOp( std::span<std::byte> Dest, const std::byte* pSrc, const bool bBroadcast ) noexcept
+    {
+        auto pD = reinterpret_cast<std::uint8_t*>( Dest.data() );
+        auto pS = reinterpret_cast<const std::uint8_t*>( pSrc );
+
+        const auto nBlocks = static_cast<std::uint32_t>( Dest.size() / 16 );
+        ParallelFor( nBlocks, 1u << 12, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            ApplyByteOpRange<T_OP>( pD, pS, bBroadcast, std::size_t(Begin) * 16, std::size_t(End) * 16 );
+        });
+        ApplyByteOpRange<T_OP>( pD, pS, bBroadcast, std::size_t(nBlocks) * 16, Dest.size() );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Row by row so the views can be windows of bigger bitmaps
+    //-------------------------------------------------------------------------------
+    template< byte_op T_OP >
+    void ApplyByteOp( const xbitmap::view& Dest, const xbitmap::const_view& Src ) noexcept
+    {
+        std::array<int, 4> Channels;
+        assert( Dest.m_Format == Src.m_Format );
+        assert( Dest.m_Width  == Src.m_Width && Dest.m_Height == Src.m_Height );
+        assert( getByteChannels( Dest.m_Format, Channels ) > 0 );
+
+        const auto RowBytes = std::size_t( Dest.m_Width ) * Dest.m_TexelSize;
+        ParallelFor( Dest.m_Height, std::max( 1u, ( 1u << 16 ) / std::uint32_t( std::max<std::size_t>( 1, RowBytes ) ) ), [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( auto y = Begin; y < End; ++y )
+            {
+                ApplyByteOpRange<T_OP>( Dest.getRow<std::uint8_t>( y ).data(), Src.getRow<const std::uint8_t>( y ).data(), false, 0, RowBytes );
+            }
+        });
+    }
+
+    //-------------------------------------------------------------------------------
+
+    template< byte_op T_OP >
+    void ApplyByteOp( xbitmap& Dest, const xbitmap& Src ) noexcept
+    {
+        std::array<int, 4> Channels;
+        assert( Dest.isValid() && Src.isValid() );
+        assert( Dest.getFormat()   == Src.getFormat() );
+        assert( Dest.getDataSize() == Src.getDataSize() );
+        assert( Dest.getLayout()   == Src.getLayout() );
+        assert( getByteChannels( Dest.getFormat(), Channels ) > 0 );
+
+        const auto& ConstSrc = Src;
+        ApplyByteOp<T_OP>( getAllTexels<std::byte>( Dest ), reinterpret_cast<const std::byte*>( &ConstSrc.m_pData[ ConstSrc.getMipCount() ] ), false );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Unused bytes (such the U in R8G8B8U8) get the identity of the operation
+    //-------------------------------------------------------------------------------
+    template< byte_op T_OP >
+    void ApplyByteOp( xbitmap& Dest, const xcolori Color ) noexcept
+    {
+        std::array<int, 4> Channels;
+        assert( Dest.isValid() );
+        const auto PatternSize = getByteChannels( Dest.getFormat(), Channels );
+        assert( PatternSize > 0 );
+
+        alignas(16) std::array<std::uint8_t, 16> Pattern;
+        for( int i = 0; i < 16; ++i )
+        {
+            const auto iChannel = Channels[ i % PatternSize ];
+            Pattern[i] = iChannel >= 0 ? Color[iChannel] : ( T_OP == byte_op::MULTIPLY ? std::uint8_t{0xff} : std::uint8_t{0} );
+        }
+
+        ApplyByteOp<T_OP>( getAllTexels<std::byte>( Dest ), reinterpret_cast<const std::byte*>( Pattern.data() ), true );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Add( const xbitmap& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::ADD>( *this, Src );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Add( const xcolori Color ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::ADD>( *this, Color );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Subtract( const xbitmap& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::SUBTRACT>( *this, Src );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Subtract( const xcolori Color ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::SUBTRACT>( *this, Color );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Multiply( const xbitmap& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::MULTIPLY>( *this, Src );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Multiply( const xcolori Color ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::MULTIPLY>( *this, Color );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Add( const view& Dest, const const_view& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::ADD>( Dest, Src );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Subtract( const view& Dest, const const_view& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::SUBTRACT>( Dest, Src );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Multiply( const view& Dest, const const_view& Src ) noexcept
+{
+    xbitmap_details::ApplyByteOp<xbitmap_details::byte_op::MULTIPLY>( Dest, Src );
+}
+
+//-------------------------------------------------------------------------------
+// Every channel becomes saturate( round( C * Scale + Bias * 255 ) ). Both Scale and
+// Bias are given in normalized units so a Bias of 1 adds 255.
+//-------------------------------------------------------------------------------
+void xbitmap::ScaleBias( const xcolorf& Scale, const xcolorf& Bias ) noexcept
+{
+    std::array<int, 4> Channels;
+    assert( isValid() );
+    const auto PatternSize = xbitmap_details::getByteChannels( getFormat(), Channels );
+    assert( PatternSize > 0 );
+
+    alignas(16) std::array<float, 4> S;
+    alignas(16) std::array<float, 4> B;
+    for( int i = 0; i < 4; ++i )
+    {
+        const auto iChannel = Channels[ i % PatternSize ];
+        S[i] = iChannel >= 0 ? Scale[iChannel]          : 1.0f;
+        B[i] = iChannel >= 0 ? Bias[iChannel] * 255.0f  : 0.0f;
+    }
+
+    auto       Texels  = xbitmap_details::getAllTexels<std::uint8_t>( *this );
+    const auto nBlocks = static_cast<std::uint32_t>( Texels.size() / 16 );
+
+    auto Process = [&]( const std::size_t Begin, const std::size_t End ) noexcept
+    {
+        auto i = Begin;
+#if XBITMAP_SSE2
+        const auto vScale = _mm_load_ps( S.data() );
+        const auto vBias  = _mm_load_ps( B.data() );
+        const auto Zero   = _mm_setzero_si128();
+        const auto Apply  = [&]( const __m128i V ) noexcept
+        {
+            return _mm_cvtps_epi32( _mm_add_ps( _mm_mul_ps( _mm_cvtepi32_ps( V ), vScale ), vBias ) );
+        };
+
+        for( ; i + 16 <= End; i += 16 )
+        {
+            auto       p  = reinterpret_cast<__m128i*>( &Texels[i] );
+            const auto V  = _mm_loadu_si128( p );
+            const auto Lo = _mm_unpacklo_epi8( V, Zero );
+            const auto Hi = _mm_unpackhi_epi8( V, Zero );
+
+            // Saturation comes for free from the signed and unsigned packs
+            _mm_storeu_si128( p, _mm_packus_epi16( _mm_packs_epi32( Apply( _mm_unpacklo_epi16( Lo, Zero ) ), Apply( _mm_unpackhi_epi16( Lo, Zero ) ) )
+                                                 , _mm_packs_epi32( Apply( _mm_unpacklo_epi16( Hi, Zero ) ), Apply( _mm_unpackhi_epi16( Hi, Zero ) ) ) ) );
+        }
+#endif
+        for( ; i < End; ++i )
+        {
+            Texels[i] = static_cast<std::uint8_t>( std::clamp( std::nearbyint( Texels[i] * S[i & 3] + B[i & 3] ), 0.0f, 255.0f ) );
+        }
+    };
+
+    xbitmap_details::ParallelFor( nBlocks, 1u << 12, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        Process( std::size_t(Begin) * 16, std::size_t(End) * 16 );
+    });
+    Process( std::size_t(nBlocks) * 16, Texels.size() );
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// MIP GENERATION
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // sRGB <-> linear conversion tables. Linear values are 16 bit fixed point, and
+    // the inverse table is indexed with the top 12 bits of it, which is finer than
+    // one sRGB step even at the dark end of the curve.
+    //-------------------------------------------------------------------------------
+    struct srgb_tables
+    {
+        std::array<std::uint16_t, 256>      m_ToLinear;
+        std::array<std::uint8_t,  4096>     m_ToSRGB;
+    };
+
+    static const srgb_tables& getSRGBTables( void ) noexcept
+    {
+        static const srgb_tables Tables = []
+        {
+            srgb_tables T;
+            for( int i = 0; i < 256; ++i )
+            {
+                const double C = i / 255.0;
+                const double L = C <= 0.04045 ? C / 12.92 : std::pow( ( C + 0.055 ) / 1.055, 2.4 );
+                T.m_ToLinear[i] = static_cast<std::uint16_t>( L * 65535.0 + 0.5 );
+            }
+
+            for( int i = 0; i < 4096; ++i )
+            {
+                const double L = ( i * 16 + 8 ) / 65535.0;
+                const double C = L <= 0.0031308 ? L * 12.92 : 1.055 * std::pow( L, 1.0 / 2.4 ) - 0.055;
+                T.m_ToSRGB[i] = static_cast<std::uint8_t>( std::min( 255.0, C * 255.0 + 0.5 ) );
+            }
+            return T;
+        }();
+        return Tables;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    inline std::uint8_t AverageSRGB( const srgb_tables& T, const std::uint8_t A, const std::uint8_t B, const std::uint8_t C, const std::uint8_t D ) noexcept
+    {
+        const std::uint32_t Sum = T.m_ToLinear[A] + T.m_ToLinear[B] + T.m_ToLinear[C] + T.m_ToLinear[D];
+        return T.m_ToSRGB[ ( ( Sum + 2 ) >> 2 ) >> 4 ];
+    }
+
+    //-------------------------------------------------------------------------------
+    // One destination row of a 2x2 box reduction of even sizes. pRow1 is the same as
+    // pRow0 when the source is a single row, and a single column is used twice. With bSRGB
+    // the color channels of 8 bit formats are averaged in linear space; alpha is
+    // always averaged as it is.
+    //-------------------------------------------------------------------------------
+    static void BoxFilterRow
+    ( const xbitmap::format     Format
+    , const std::byte*          pRow0
+    , const std::byte*          pRow1
+    , const std::uint32_t       SrcWidth
+    , std::byte*                pDest
+    , const std::uint32_t       DestWidth
+    , const bool                bSRGB
+    ) noexcept
+    {
+        const auto& Info      = getFormatInfo( Format );
+        const int   nChannels = getChannelCount( Info );
+        const auto  TexelSize = static_cast<std::uint32_t>( Info.m_BlockBytes );
+        const auto  X1        = [&]( const std::uint32_t x ) noexcept { return std::min( 2 * x + 1, SrcWidth - 1 ); };
+        std::uint32_t x       = 0;
+
+        switch( Info.m_Kind )
+        {
+        case texel_kind::UNORM8:
+        {
+            const auto p0 = reinterpret_cast<const std::uint8_t*>( pRow0 );
+            const auto p1 = reinterpret_cast<const std::uint8_t*>( pRow1 );
+            const auto pD = reinterpret_cast<std::uint8_t*>( pDest );
+
+            if( bSRGB )
+            {
+                // Decode, filter and encode in one go, no intermediate image
+                std::array<int, 4> Channels{ 0, 1, 2, -1 };
+                if( TexelSize == 4 ) getByteChannels( Format, Channels );
+
+                const auto& T = getSRGBTables();
+                for( ; x < DestWidth; ++x )
+                {
+                    const auto a = 2 * x * TexelSize;
+                    const auto b = X1(x) * TexelSize;
+                    for( int c = 0; c < nChannels; ++c )
+                    {
+                        const bool bColor = Channels[c] >= 0 && Channels[c] < 3;
+                        pD[ x * TexelSize + c ] = bColor ? AverageSRGB( T, p0[a + c], p0[b + c], p1[a + c], p1[b + c] )
+                                                         : static_cast<std::uint8_t>( ( p0[a + c] + p0[b + c] + p1[a + c] + p1[b + c] + 2 ) >> 2 );
+                    }
+                }
+                break;
+            }
+
+#if XBITMAP_SSE2
+            const auto Zero = _mm_setzero_si128();
+            const auto Two  = _mm_set1_epi16( 2 );
+            if( SrcWidth >= 2 * DestWidth && TexelSize == 4 )
+            {
+                // 4 source texels of each row become 2 texels with 16 bit channels
+                const auto Reduce = [&]( const std::uint8_t* pA, const std::uint8_t* pB ) noexcept
+                {
+                    const auto A   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pA ) );
+                    const auto B   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pB ) );
+                    const auto Lo  = _mm_add_epi16( _mm_unpacklo_epi8( A, Zero ), _mm_unpacklo_epi8( B, Zero ) );
+                    const auto Hi  = _mm_add_epi16( _mm_unpackhi_epi8( A, Zero ), _mm_unpackhi_epi8( B, Zero ) );
+                    const auto Sum = _mm_add_epi16( _mm_unpacklo_epi64( Lo, Hi ), _mm_unpackhi_epi64( Lo, Hi ) );
+                    return _mm_srli_epi16( _mm_add_epi16( Sum, Two ), 2 );
+                };
+
+                for( ; x + 4 <= DestWidth; x += 4 )
+                {
+                    const auto i = x * 8;
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( &pD[ x * 4 ] ), _mm_packus_epi16( Reduce( &p0[i], &p1[i] ), Reduce( &p0[i + 16], &p1[i + 16] ) ) );
+                }
+            }
+            else if( SrcWidth >= 2 * DestWidth && TexelSize == 1 )
+            {
+                // 16 source texels of each row become 8 texels in 16 bits
+                const auto Mask   = _mm_set1_epi16( 0xff );
+                const auto Reduce = [&]( const std::uint8_t* pA, const std::uint8_t* pB ) noexcept
+                {
+                    const auto A   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pA ) );
+                    const auto B   = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pB ) );
+                    const auto Sum = _mm_add_epi16( _mm_add_epi16( _mm_and_si128( A, Mask ), _mm_srli_epi16( A, 8 ) )
+                                                  , _mm_add_epi16( _mm_and_si128( B, Mask ), _mm_srli_epi16( B, 8 ) ) );
+                    return _mm_srli_epi16( _mm_add_epi16( Sum, Two ), 2 );
+                };
+
+                for( ; x + 16 <= DestWidth; x += 16 )
+                {
+                    const auto i = x * 2;
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( &pD[x] ), _mm_packus_epi16( Reduce( &p0[i], &p1[i] ), Reduce( &p0[i + 16], &p1[i + 16] ) ) );
+                }
+            }
+#endif
+            for( ; x < DestWidth; ++x )
+            {
+                const auto a = 2 * x * TexelSize;
+                const auto b = X1(x) * TexelSize;
+                for( int c = 0; c < nChannels; ++c )
+                {
+                    pD[ x * TexelSize + c ] = static_cast<std::uint8_t>( ( p0[a + c] + p0[b + c] + p1[a + c] + p1[b + c] + 2 ) >> 2 );
+                }
+            }
+            break;
+        }
+        case texel_kind::UNORM16:
+        {
+            const auto p0 = reinterpret_cast<const std::uint16_t*>( pRow0 );
+            const auto p1 = reinterpret_cast<const std::uint16_t*>( pRow1 );
+            const auto pD = reinterpret_cast<std::uint16_t*>( pDest );
+            for( ; x < DestWidth; ++x )
+            {
+                const auto a = 2 * x * nChannels;
+                const auto b = X1(x) * nChannels;
+                for( int c = 0; c < nChannels; ++c )
+                {
+                    pD[ x * nChannels + c ] = static_cast<std::uint16_t>( ( std::uint32_t(p0[a + c]) + p0[b + c] + p1[a + c] + p1[b + c] + 2 ) >> 2 );
+                }
+            }
+            break;
+        }
+        case texel_kind::FLOAT32:
+        {
+            const auto p0 = reinterpret_cast<const float*>( pRow0 );
+            const auto p1 = reinterpret_cast<const float*>( pRow1 );
+            const auto pD = reinterpret_cast<float*>( pDest );
+
+#if XBITMAP_SSE2
+            if( nChannels == 4 )
+            {
+                const auto Quarter = _mm_set1_ps( 0.25f );
+                for( ; x < DestWidth; ++x )
+                {
+                    const auto a = 8 * x;
+                    const auto b = 4 * X1(x);
+                    const auto Sum = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( &p0[a] ), _mm_loadu_ps( &p0[b] ) )
+                                               , _mm_add_ps( _mm_loadu_ps( &p1[a] ), _mm_loadu_ps( &p1[b] ) ) );
+                    _mm_storeu_ps( &pD[ 4 * x ], _mm_mul_ps( Sum, Quarter ) );
+                }
+            }
+#endif
+            for( ; x < DestWidth; ++x )
+            {
+                const auto a = 2 * x * nChannels;
+                const auto b = X1(x) * nChannels;
+                for( int c = 0; c < nChannels; ++c )
+                {
+                    pD[ x * nChannels + c ] = ( p0[a + c] + p0[b + c] + p1[a + c] + p1[b + c] ) * 0.25f;
+                }
+            }
+            break;
+        }
+        case texel_kind::FLOAT16:
+        {
+            const auto p0 = reinterpret_cast<const std::uint16_t*>( pRow0 );
+            const auto p1 = reinterpret_cast<const std::uint16_t*>( pRow1 );
+            const auto pD = reinterpret_cast<std::uint16_t*>( pDest );
+            for( ; x < DestWidth; ++x )
+            {
+                const auto a = 2 * x * nChannels;
+                const auto b = X1(x) * nChannels;
+                for( int c = 0; c < nChannels; ++c )
+                {
+                    pD[ x * nChannels + c ] = FloatToHalf( ( HalfToFloat( p0[a + c] ) + HalfToFloat( p0[b + c] ) + HalfToFloat( p1[a + c] ) + HalfToFloat( p1[b + c] ) ) * 0.25f );
+                }
+            }
+            break;
+        }
+        case texel_kind::PACKED16:
+        {
+            const auto p0  = reinterpret_cast<const std::uint16_t*>( pRow0 );
+            const auto p1  = reinterpret_cast<const std::uint16_t*>( pRow1 );
+            const auto pD  = reinterpret_cast<std::uint16_t*>( pDest );
+            const xcolor::format Fmt{ static_cast<xcolor::format::type>( Format ) };
+            for( ; x < DestWidth; ++x )
+            {
+                const xcolori C[] = { xcolori( p0[2 * x], Fmt ), xcolori( p0[X1(x)], Fmt ), xcolori( p1[2 * x], Fmt ), xcolori( p1[X1(x)], Fmt ) };
+                xcolori       Avg;
+                for( int c = 0; c < 4; ++c )
+                {
+                    Avg[c] = ( bSRGB && c < 3 ) ? AverageSRGB( getSRGBTables(), C[0][c], C[1][c], C[2][c], C[3][c] )
+                                                : static_cast<std::uint8_t>( ( C[0][c] + C[1][c] + C[2][c] + C[3][c] + 2 ) >> 2 );
+                }
+                pD[x] = static_cast<std::uint16_t>( Avg.getDataFromColor( Fmt ) );
+            }
+            break;
+        }
+        default:
+            assert( false );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Converts rows of any uncompressed format to and from floats, m_nChannels per
+    // texel in memory order (PACKED16 formats go through RGBA). In sRGB the color
+    // channels of the 8 bit formats are decoded to linear and encoded back.
+    //-------------------------------------------------------------------------------
+    struct texel_codec
+    {
+        texel_codec( const xbitmap::format Format, const bool bSRGB ) noexcept
+            : m_Format   { Format }
+            , m_Info     { getFormatInfo( Format ) }
+            , m_nChannels{ m_Info.m_Kind == texel_kind::PACKED16 ? 4 : getChannelCount( m_Info ) }
+        {
+            assert( m_nChannels > 0 );
+
+            if( m_Info.m_Kind == texel_kind::UNORM8 && m_Info.m_BlockBytes == 4 ) getByteChannels( Format, m_Channels );
+
+            for( int i = 0; i < m_nChannels; ++i )
+            {
+                const bool bHasSRGB = m_Info.m_Kind == texel_kind::UNORM8 || m_Info.m_Kind == texel_kind::PACKED16;
+                m_bSRGB[i] = bSRGB && bHasSRGB && m_Channels[i] >= 0 && m_Channels[i] < 3;
+            }
+        }
+
+        //-------------------------------------------------------------------------------
+
+        float ToFloat( const int iChannel, const std::uint8_t V ) const noexcept
+        {
+            return m_bSRGB[iChannel] ? getSRGBTables().m_ToLinear[V] * ( 1.0f / 65535.0f ) : V * ( 1.0f / 255.0f );
+        }
+
+        //-------------------------------------------------------------------------------
+
+        std::uint8_t ToByte( const int iChannel, const float V ) const noexcept
+        {
+            if( m_bSRGB[iChannel] )
+            {
+                const auto L = static_cast<std::uint32_t>( std::clamp( V, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+                return getSRGBTables().m_ToSRGB[ L >> 4 ];
+            }
+            return static_cast<std::uint8_t>( std::clamp( V, 0.0f, 1.0f ) * 255.0f + 0.5f );
+        }
+
+        //-------------------------------------------------------------------------------
+
+        void Decode( const std::byte* pSrc, const std::uint32_t Count, float* pDest ) const noexcept
+        {
+            const auto n = static_cast<std::uint32_t>( m_nChannels );
+            switch( m_Info.m_Kind )
+            {
+            case texel_kind::UNORM8:
+            {
+                const auto p = reinterpret_cast<const std::uint8_t*>( pSrc );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) pDest[i] = ToFloat( i % n, p[i] );
+                break;
+            }
+            case texel_kind::UNORM16:
+            {
+                const auto p = reinterpret_cast<const std::uint16_t*>( pSrc );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) pDest[i] = p[i] * ( 1.0f / 65535.0f );
+                break;
+            }
+            case texel_kind::FLOAT16:
+            {
+                const auto p = reinterpret_cast<const std::uint16_t*>( pSrc );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) pDest[i] = HalfToFloat( p[i] );
+                break;
+            }
+            case texel_kind::FLOAT32:
+                std::memcpy( pDest, pSrc, Count * n * sizeof(float) );
+                break;
+            case texel_kind::PACKED16:
+            {
+                const auto p = reinterpret_cast<const std::uint16_t*>( pSrc );
+                const xcolor::format Fmt{ static_cast<xcolor::format::type>( m_Format ) };
+                for( std::uint32_t i = 0; i < Count; ++i )
+                {
+                    const xcolori C( p[i], Fmt );
+                    for( int c = 0; c < 4; ++c ) pDest[ i * 4 + c ] = ToFloat( c, C[c] );
+                }
+                break;
+            }
+            default:
+                assert( false );
+            }
+        }
+
+        //-------------------------------------------------------------------------------
+
+        void Encode( const float* pSrc, const std::uint32_t Count, std::byte* pDest ) const noexcept
+        {
+            const auto n = static_cast<std::uint32_t>( m_nChannels );
+            switch( m_Info.m_Kind )
+            {
+            case texel_kind::UNORM8:
+            {
+                const auto p = reinterpret_cast<std::uint8_t*>( pDest );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) p[i] = ToByte( i % n, pSrc[i] );
+                break;
+            }
+            case texel_kind::UNORM16:
+            {
+                const auto p = reinterpret_cast<std::uint16_t*>( pDest );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) p[i] = static_cast<std::uint16_t>( std::clamp( pSrc[i], 0.0f, 1.0f ) * 65535.0f + 0.5f );
+                break;
+            }
+            case texel_kind::FLOAT16:
+            {
+                const auto p = reinterpret_cast<std::uint16_t*>( pDest );
+                for( std::uint32_t i = 0; i < Count * n; ++i ) p[i] = FloatToHalf( pSrc[i] );
+                break;
+            }
+            case texel_kind::FLOAT32:
+                std::memcpy( pDest, pSrc, Count * n * sizeof(float) );
+                break;
+            case texel_kind::PACKED16:
+            {
+                const auto p = reinterpret_cast<std::uint16_t*>( pDest );
+                const xcolor::format Fmt{ static_cast<xcolor::format::type>( m_Format ) };
+                for( std::uint32_t i = 0; i < Count; ++i )
+                {
+                    xcolori C;
+                    for( int c = 0; c < 4; ++c ) C[c] = ToByte( c, pSrc[ i * 4 + c ] );
+                    p[i] = static_cast<std::uint16_t>( C.getDataFromColor( Fmt ) );
+                }
+                break;
+            }
+            default:
+                assert( false );
+            }
+        }
+
+        //-------------------------------------------------------------------------------
+        // A color (such the clamp color) as one decoded texel
+        //-------------------------------------------------------------------------------
+        void DecodeColor( const xcolori Color, float* pDest ) const noexcept
+        {
+            for( int i = 0; i < m_nChannels; ++i )
+            {
+                if( m_Info.m_Kind == texel_kind::UNORM8 || m_Info.m_Kind == texel_kind::PACKED16 )
+                {
+                    pDest[i] = m_Channels[i] < 0 ? 1.0f : ToFloat( i, Color[ m_Channels[i] ] );
+                }
+                else
+                {
+                    pDest[i] = Color[i] * ( 1.0f / 255.0f );
+                }
+            }
+        }
+
+        xbitmap::format         m_Format;
+        const format_info&      m_Info;
+        int                     m_nChannels;
+        std::array<int, 4>      m_Channels  { 0, 1, 2, 3 };         // xcolori channel of each texel channel, -1 when unused
+        std::array<bool, 4>     m_bSRGB     {};
+    };
+
+    //-------------------------------------------------------------------------------
+    // Box filter taps along one axis. Even sizes average pairs. An odd size N = 2M+1
+    // shrinks to M with the polyphase weights ((M-i)/N, M/N, (i+1)/N) so every source
+    // texel ends up with the same total weight and no row or column is dropped.
+    //-------------------------------------------------------------------------------
+    struct box_taps
+    {
+        std::uint32_t               m_First;
+        int                         m_nTaps;
+        std::array<float, 3>        m_Weight;
+    };
+
+    inline box_taps getBoxTaps( const std::uint32_t SrcSize, const std::uint32_t i ) noexcept
+    {
+        if( SrcSize == 1 )         return { 0,     1, { 1.0f } };
+        if( ( SrcSize & 1 ) == 0 ) return { 2 * i, 2, { 0.5f, 0.5f } };
+
+        const float N = static_cast<float>( SrcSize );
+        const float M = static_cast<float>( SrcSize / 2 );
+        return { 2 * i, 3, { ( M - i ) / N, M / N, ( i + 1 ) / N } };
+    }
+
+    //-------------------------------------------------------------------------------
+    // One destination row of the polyphase box filter, done in float through the
+    // codec. Src and Dest are whole mips in Layout, Buffer and Scratch are scratch
+    // space reused across calls.
+    //-------------------------------------------------------------------------------
+    static void PolyphaseBoxRow
+    ( const texel_codec&            Codec
+    , const xbitmap::const_view&    Src
+    , const xbitmap::view&          Dest
+    , const xbitmap::texel_layout   Layout
+    , const std::uint32_t           y
+    , std::vector<float>&           Buffer
+    , std::vector<std::byte>&       Scratch
+    ) noexcept
+    {
+        const auto nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto SrcWidth  = Src.m_Width;
+        const auto SrcHeight = Src.m_Height;
+        const auto DestWidth = Dest.m_Width;
+        const auto RowSize   = std::size_t(SrcWidth) * nC;
+        Buffer.resize( RowSize * 2 + std::size_t(DestWidth) * nC );
+
+        auto pColumn = &Buffer[0];
+        auto pRow    = &Buffer[ RowSize ];
+        auto pOut    = &Buffer[ RowSize * 2 ];
+
+        // Vertical first, into a single row
+        const auto TapsY = getBoxTaps( SrcHeight, y );
+        std::fill_n( pColumn, RowSize, 0.0f );
+        for( int t = 0; t < TapsY.m_nTaps; ++t )
+        {
+            Codec.Decode( LoadLayoutRow( Src, Layout, TapsY.m_First + t, Scratch ), SrcWidth, pRow );
+            for( std::size_t i = 0; i < RowSize; ++i ) pColumn[i] += pRow[i] * TapsY.m_Weight[t];
+        }
+
+        for( std::uint32_t x = 0; x < DestWidth; ++x )
+        {
+            const auto TapsX = getBoxTaps( SrcWidth, x );
+            for( std::size_t c = 0; c < nC; ++c )
+            {
+                float Sum = 0;
+                for( int t = 0; t < TapsX.m_nTaps; ++t ) Sum += pColumn[ ( TapsX.m_First + t ) * nC + c ] * TapsX.m_Weight[t];
+                pOut[ x * nC + c ] = Sum;
+            }
+        }
+
+        if( Layout == xbitmap::texel_layout::LINEAR )
+        {
+            Codec.Encode( pOut, DestWidth, Dest.getRow( y ).data() );
+            return;
+        }
+
+        Scratch.resize( std::size_t(DestWidth) * Dest.m_TexelSize );
+        Codec.Encode( pOut, DestWidth, Scratch.data() );
+        StoreLayoutRow( Dest, Layout, y, 0, DestWidth, Scratch.data() );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Builds Region (in mip iMip texels) of mip iMip of every face and frame from mip
+    // iMip-1 with a box filter. All the rows of all the faces and frames are spread
+    // across the threads. Mips that are not row major are read and written a row at
+    // a time through their layout.
+    //-------------------------------------------------------------------------------
+    static void BoxFilterMip( xbitmap& Bitmap, const int iMip, const xbitmap::rect& Region ) noexcept
+    {
+        const auto Format    = Bitmap.getFormat();
+        const auto Layout    = Bitmap.getLayout();
+        const auto TexelSize = getFormatInfo( Format ).m_BlockBytes;
+        const auto SrcW      = getMipDimension( Bitmap.getWidth(),  iMip - 1 );
+        const auto SrcH      = getMipDimension( Bitmap.getHeight(), iMip - 1 );
+        const auto DestW     = getMipDimension( Bitmap.getWidth(),  iMip );
+        const auto nFaces    = static_cast<std::uint32_t>( Bitmap.getFaceCount() );
+        const auto nSlices   = nFaces * Bitmap.getFrameCount();
+        const auto nRows     = Region.m_Bottom - Region.m_Top;
+        const bool bSRGB     = Bitmap.getColorSpace() == xbitmap::color_space::SRGB;
+
+        assert( Region.m_Right <= DestW && Region.m_Bottom <= getMipDimension( Bitmap.getHeight(), iMip ) );
+        if( Region.m_Left >= Region.m_Right || nRows == 0 ) return;
+
+        // Odd sizes need the 3 tap polyphase filter, which does whole rows
+        if( ( SrcW > 1 && ( SrcW & 1 ) ) || ( SrcH > 1 && ( SrcH & 1 ) ) )
+        {
+            const texel_codec Codec( Format, bSRGB );
+            ParallelFor( nSlices * nRows, 8, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                std::vector<float>     Buffer;
+                std::vector<std::byte> Scratch;
+                for( auto iRow = Begin; iRow < End; ++iRow )
+                {
+                    const auto iSlice = iRow / nRows;
+                    const auto iFace  = static_cast<int>( iSlice % nFaces );
+                    const auto iFrame = static_cast<int>( iSlice / nFaces );
+                    PolyphaseBoxRow( Codec
+                                   , getLayoutView( Bitmap, iMip - 1, iFace, iFrame )
+                                   , getLayoutView( Bitmap, iMip,     iFace, iFrame )
+                                   , Layout
+                                   , Region.m_Top + iRow % nRows
+                                   , Buffer
+                                   , Scratch );
+                }
+            });
+            return;
+        }
+
+        ParallelFor( nSlices * nRows, 8, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<std::byte> Row0, Row1, Out;
+            for( auto iRow = Begin; iRow < End; ++iRow )
+            {
+                const auto iSlice = iRow / nRows;
+                const auto y      = Region.m_Top + iRow % nRows;
+                const auto iFace  = static_cast<int>( iSlice % nFaces );
+                const auto iFrame = static_cast<int>( iSlice / nFaces );
+                const auto Src    = getLayoutView( Bitmap, iMip - 1, iFace, iFrame );
+                const auto Dest   = getLayoutView( Bitmap, iMip,     iFace, iFrame );
+                const auto y1     = std::min( 2 * y + 1, SrcH - 1 );
+                const auto x0     = std::size_t( Region.m_Left );
+                const bool bRows  = Layout == xbitmap::texel_layout::LINEAR;
+
+                Out.resize( std::size_t( Region.m_Right - Region.m_Left ) * TexelSize );
+                BoxFilterRow( Format
+                            , &LoadLayoutRow( Src, Layout, 2 * y, Row0 )[ 2 * x0 * TexelSize ]
+                            , &LoadLayoutRow( Src, Layout, y1,    Row1 )[ 2 * x0 * TexelSize ]
+                            , SrcW - static_cast<std::uint32_t>( 2 * x0 )
+                            , bRows ? &Dest.getRow( y )[ x0 * TexelSize ] : Out.data()
+                            , Region.m_Right - Region.m_Left
+                            , bSRGB );
+
+                if( bRows == false ) StoreLayoutRow( Dest, Layout, y, Region.m_Left, Region.m_Right, Out.data() );
+            }
+        });
+    }
+
+    static void BoxFilterMip( xbitmap& Bitmap, const int iMip ) noexcept
+    {
+        BoxFilterMip( Bitmap, iMip, { 0, 0, getMipDimension( Bitmap.getWidth(), iMip ), getMipDimension( Bitmap.getHeight(), iMip ) } );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Filter kernels, x is in destination texels
+    //-------------------------------------------------------------------------------
+    static float Sinc( const float x ) noexcept
+    {
+        if( std::abs( x ) < 1e-5f ) return 1.0f;
+        const float a = x * 3.14159265358979f;
+        return std::sin( a ) / a;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    static float BesselI0( const float x ) noexcept
+    {
+        float Sum  = 1.0f;
+        float Term = 1.0f;
+        for( int k = 1; k < 32 && Term > Sum * 1e-8f; ++k )
+        {
+            const float t = x / ( 2.0f * k );
+            Term *= t * t;
+            Sum  += Term;
+        }
+        return Sum;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    static float getFilterSupport( const xbitmap::mip_filter Filter ) noexcept
+    {
+        switch( Filter )
+        {
+        case xbitmap::mip_filter::MITCHELL: return 2.0f;
+        case xbitmap::mip_filter::KAISER:
+        case xbitmap::mip_filter::LANCZOS3: return 3.0f;
+        default:                            return 0.5f;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+
+    static float EvaluateFilter( const xbitmap::mip_filter Filter, const float x ) noexcept
+    {
+        const float Ax = std::abs( x );
+        switch( Filter )
+        {
+        case xbitmap::mip_filter::KAISER:
+        {
+            constexpr float Alpha = 4.0f;
+            const float     t     = x / 3.0f;
+            if( t * t >= 1.0f ) return 0.0f;
+            return Sinc( x ) * BesselI0( Alpha * std::sqrt( 1.0f - t * t ) ) / BesselI0( Alpha );
+        }
+        case xbitmap::mip_filter::LANCZOS3:
+            return Ax < 3.0f ? Sinc( x ) * Sinc( x / 3.0f ) : 0.0f;
+        case xbitmap::mip_filter::MITCHELL:
+        {
+            constexpr float B = 1.0f / 3.0f;
+            constexpr float C = 1.0f / 3.0f;
+            if( Ax < 1.0f ) return ( ( 12 - 9 * B - 6 * C ) * Ax * Ax * Ax + ( -18 + 12 * B + 6 * C ) * Ax * Ax + ( 6 - 2 * B ) ) / 6.0f;
+            if( Ax < 2.0f ) return ( ( -B - 6 * C ) * Ax * Ax * Ax + ( 6 * B + 30 * C ) * Ax * Ax + ( -12 * B - 48 * C ) * Ax + ( 8 * B + 24 * C ) ) / 6.0f;
+            return 0.0f;
+        }
+        default:
+            return Ax <= 0.5f ? 1.0f : 0.0f;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Normalized weights of one axis, m_nTaps per destination texel. The source
+    // indices are already wrapped; -1 stands for the clamp color.
+    //-------------------------------------------------------------------------------
+    struct filter_taps
+    {
+        int                             m_nTaps {};
+        std::vector<std::int32_t>       m_Index {};
+        std::vector<float>              m_Weight{};
+    };
+
+    static filter_taps BuildFilterTaps( const xbitmap::mip_filter Filter, const std::uint32_t SrcSize, const std::uint32_t DestSize, const xbitmap::wrap_mode WrapMode ) noexcept
+    {
+        const float Ratio  = float( SrcSize ) / float( DestSize );
+        const float Scale  = std::max( 1.0f, Ratio );
+        const float Radius = getFilterSupport( Filter ) * Scale;
+
+        filter_taps Taps;
+        Taps.m_nTaps = static_cast<int>( std::ceil( Radius * 2.0f ) ) + 1;
+        Taps.m_Index.resize( std::size_t(DestSize) * Taps.m_nTaps );
+        Taps.m_Weight.resize( std::size_t(DestSize) * Taps.m_nTaps );
+
+        for( std::uint32_t d = 0; d < DestSize; ++d )
+        {
+            const float Center = ( d + 0.5f ) * Ratio - 0.5f;
+            const int   First  = static_cast<int>( std::ceil( Center - Radius ) );
+            const auto  iBase  = std::size_t(d) * Taps.m_nTaps;
+
+            float Total = 0;
+            for( int t = 0; t < Taps.m_nTaps; ++t )
+            {
+                const float W = EvaluateFilter( Filter, ( First + t - Center ) / Scale );
+                Taps.m_Index [ iBase + t ] = WrapCoordinate( First + t, static_cast<int>( SrcSize ), WrapMode );
+                Taps.m_Weight[ iBase + t ] = W;
+                Total += W;
+            }
+
+            for( int t = 0; t < Taps.m_nTaps; ++t ) Taps.m_Weight[ iBase + t ] /= Total;
+        }
+
+        return Taps;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Weight tables only depend on the sizes, the filter and the wrap mode, so the
+    // recent ones are kept around for repeated resizes (thumbnails, LODs)
+    //-------------------------------------------------------------------------------
+    static std::shared_ptr<const filter_taps> getCachedFilterTaps( const xbitmap::mip_filter Filter, const std::uint32_t SrcSize, const std::uint32_t DestSize, const xbitmap::wrap_mode WrapMode ) noexcept
+    {
+        static std::mutex                                                   Mutex;
+        static std::map<std::uint64_t, std::shared_ptr<const filter_taps>>  Cache;
+
+        const std::uint64_t Key = ( std::uint64_t( SrcSize ) << 32 ) | ( std::uint64_t( DestSize ) << 4 ) | ( std::uint64_t( Filter ) << 2 ) | std::uint64_t( WrapMode );
+        {
+            std::scoped_lock Lock( Mutex );
+            if( auto It = Cache.find( Key ); It != Cache.end() ) return It->second;
+        }
+
+        auto Taps = std::make_shared<const filter_taps>( BuildFilterTaps( Filter, SrcSize, DestSize, WrapMode ) );
+
+        std::scoped_lock Lock( Mutex );
+        if( Cache.size() >= 64 ) Cache.clear();
+        Cache.emplace( Key, Taps );
+        return Taps;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Resamples one image over bands of destination rows. Each band filters the
+    // source rows it reads horizontally into a ring of as many rows as one
+    // destination row reads (slot == source row % ring size), then filters the ring
+    // vertically, so there is no intermediate float image. Filtering happens in float
+    // so the kernels are the same for every format, 4 channel texels and the vertical
+    // accumulation run in SSE2. With iPremultiplied >= 0 (the alpha channel) the
+    // color is weighted by alpha while filtering. Views of mips that are not row
+    // major must cover the whole mip, their rows go through the layout.
+    //-------------------------------------------------------------------------------
+    struct resample_job
+    {
+        const texel_codec&          m_Codec;
+        const filter_taps&          m_TapsX;
+        const filter_taps&          m_TapsY;
+        std::array<float, 4>        m_Border;               // the clamp color, decoded
+        int                         m_iPremultiply;
+        xbitmap::texel_layout       m_SrcLayout             { xbitmap::texel_layout::LINEAR };
+        xbitmap::texel_layout       m_DestLayout            { xbitmap::texel_layout::LINEAR };
+    };
+
+    static void SeparableResample( const resample_job& Job, const xbitmap::const_view& Src, const xbitmap::view& Dest ) noexcept
+    {
+        const auto  SrcW      = Src.m_Width;
+        const auto  SrcH      = Src.m_Height;
+        const auto  DestW     = Dest.m_Width;
+        const auto  DestH     = Dest.m_Height;
+        const auto& Codec     = Job.m_Codec;
+        const auto& TapsX     = Job.m_TapsX;
+        const auto& TapsY     = Job.m_TapsY;
+        const auto  nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto  iAlpha    = Job.m_iPremultiply;
+        const auto  RowSize   = std::size_t(DestW) * nC;
+        const auto  RingSize  = std::min<std::size_t>( TapsY.m_nTaps, SrcH );
+
+        assert( Src.m_Format == Codec.m_Format && Dest.m_Format == Codec.m_Format );
+
+        const auto Premultiply = [&]( float* pTexels, const std::size_t Count ) noexcept
+        {
+            for( std::size_t i = 0; i < Count; ++i, pTexels += nC )
+            for( std::size_t c = 0; c < nC; ++c ) if( int(c) != iAlpha ) pTexels[c] *= pTexels[iAlpha];
+        };
+
+        // The clamp color stays the same when filtered horizontally
+        std::vector<float> BorderRow( RowSize );
+        for( std::size_t i = 0; i < RowSize; ++i ) BorderRow[i] = Job.m_Border[ i % nC ];
+        if( iAlpha >= 0 ) Premultiply( BorderRow.data(), DestW );
+
+        ParallelFor( DestH, 8, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<float>         Ring( RingSize * RowSize );
+            std::vector<std::uint32_t> RingRows( RingSize, SrcH );          // Source row in each slot, SrcH when empty
+            std::vector<float>         Row( RowSize );
+            std::vector<std::byte>     SrcScratch, DestScratch( std::size_t(DestW) * Dest.m_TexelSize );
+
+            // Decoded source row with the clamp color as the last texel
+            std::vector<float> Decoded( ( std::size_t(SrcW) + 1 ) * nC );
+            std::copy_n( Job.m_Border.begin(), nC, &Decoded[ std::size_t(SrcW) * nC ] );
+            if( iAlpha >= 0 ) Premultiply( &Decoded[ std::size_t(SrcW) * nC ], 1 );
+
+            const auto FilterRow = [&]( const std::uint32_t y, float* pOut ) noexcept
+            {
+                Codec.Decode( LoadLayoutRow( Src, Job.m_SrcLayout, y, SrcScratch ), SrcW, Decoded.data() );
+                if( iAlpha >= 0 ) Premultiply( Decoded.data(), SrcW );
+
+                for( std::uint32_t x = 0; x < DestW; ++x, pOut += nC )
+                {
+                    const auto pIndex  = &TapsX.m_Index [ std::size_t(x) * TapsX.m_nTaps ];
+                    const auto pWeight = &TapsX.m_Weight[ std::size_t(x) * TapsX.m_nTaps ];
+
+#if XBITMAP_SSE2
+                    if( nC == 4 )
+                    {
+                        auto Sum = _mm_setzero_ps();
+                        for( int t = 0; t < TapsX.m_nTaps; ++t )
+                        {
+                            const auto iSrc = pIndex[t] < 0 ? SrcW : static_cast<std::uint32_t>( pIndex[t] );
+                            Sum = _mm_add_ps( Sum, _mm_mul_ps( _mm_loadu_ps( &Decoded[ iSrc * 4 ] ), _mm_set1_ps( pWeight[t] ) ) );
+                        }
+                        _mm_storeu_ps( pOut, Sum );
+                        continue;
+                    }
+#endif
+                    std::array<float, 4> Sum{};
+                    for( int t = 0; t < TapsX.m_nTaps; ++t )
+                    {
+                        const auto iSrc = pIndex[t] < 0 ? SrcW : static_cast<std::uint32_t>( pIndex[t] );
+                        for( std::size_t c = 0; c < nC; ++c ) Sum[c] += Decoded[ iSrc * nC + c ] * pWeight[t];
+                    }
+                    std::copy_n( Sum.begin(), nC, pOut );
+                }
+            };
+
+            for( auto y = Begin; y < End; ++y )
+            {
+                std::fill( Row.begin(), Row.end(), 0.0f );
+                for( int t = 0; t < TapsY.m_nTaps; ++t )
+                {
+                    const auto  iTap = std::size_t(y) * TapsY.m_nTaps + t;
+                    const float W    = TapsY.m_Weight[iTap];
+                    if( W == 0.0f ) continue;
+
+                    // Each row is used right away, a wrapped row taking the slot of another one only costs filtering it again
+                    const float* pIn = BorderRow.data();
+                    if( TapsY.m_Index[iTap] >= 0 )
+                    {
+                        const auto iSrc  = static_cast<std::uint32_t>( TapsY.m_Index[iTap] );
+                        const auto iSlot = iSrc % RingSize;
+                        if( RingRows[iSlot] != iSrc )
+                        {
+                            FilterRow( iSrc, &Ring[ iSlot * RowSize ] );
+                            RingRows[iSlot] = iSrc;
+                        }
+                        pIn = &Ring[ iSlot * RowSize ];
+                    }
+
+                    std::size_t i = 0;
+#if XBITMAP_SSE2
+                    const auto vW = _mm_set1_ps( W );
+                    for( ; i + 4 <= Row.size(); i += 4 ) _mm_storeu_ps( &Row[i], _mm_add_ps( _mm_loadu_ps( &Row[i] ), _mm_mul_ps( _mm_loadu_ps( &pIn[i] ), vW ) ) );
+#endif
+                    for( ; i < Row.size(); ++i ) Row[i] += pIn[i] * W;
+                }
+
+                if( iAlpha >= 0 )
+                {
+                    for( std::size_t i = 0; i < Row.size(); i += nC )
+                    {
+                        const float Inv = Row[ i + iAlpha ] > 0 ? 1.0f / Row[ i + iAlpha ] : 0.0f;
+                        for( std::size_t c = 0; c < nC; ++c ) if( int(c) != iAlpha ) Row[ i + c ] *= Inv;
+                    }
+                }
+
+                if( Job.m_DestLayout == xbitmap::texel_layout::LINEAR )
+                {
+                    Codec.Encode( Row.data(), DestW, Dest.getRow( y ).data() );
+                    continue;
+                }
+
+                Codec.Encode( Row.data(), DestW, DestScratch.data() );
+                StoreLayoutRow( Dest, Job.m_DestLayout, y, 0, DestW, DestScratch.data() );
+            }
+        });
+    }
+
+    //-------------------------------------------------------------------------------
+    // Builds mip iMip from mip iMip-1 with one of the separable filters
+    //-------------------------------------------------------------------------------
+    static void SeparableFilterMip( xbitmap& Bitmap, const int iMip, const xbitmap::mip_filter Filter ) noexcept
+    {
+        const texel_codec Codec( Bitmap.getFormat(), Bitmap.getColorSpace() == xbitmap::color_space::SRGB );
+        const auto  SrcW  = getMipDimension( Bitmap.getWidth(),  iMip - 1 );
+        const auto  SrcH  = getMipDimension( Bitmap.getHeight(), iMip - 1 );
+        const auto  DestW = getMipDimension( Bitmap.getWidth(),  iMip );
+        const auto  DestH = getMipDimension( Bitmap.getHeight(), iMip );
+        const auto  TapsX = getCachedFilterTaps( Filter, SrcW, DestW, Bitmap.getUWrapMode() );
+        const auto  TapsY = getCachedFilterTaps( Filter, SrcH, DestH, Bitmap.getVWrapMode() );
+
+        resample_job Job{ Codec, *TapsX, *TapsY, {}, -1, Bitmap.getLayout(), Bitmap.getLayout() };
+        Codec.DecodeColor( Bitmap.m_ClampColor, Job.m_Border.data() );
+
+        for( int iFrame = 0; iFrame < Bitmap.getFrameCount(); ++iFrame )
+        for( int iFace  = 0; iFace  < Bitmap.getFaceCount();  ++iFace  )
+        {
+            SeparableResample( Job, getLayoutView( Bitmap, iMip - 1, iFace, iFrame ), getLayoutView( Bitmap, iMip, iFace, iFrame ) );
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Number of alpha bytes above Threshold. Alpha is every 4th byte starting at
+    // AlphaByte.
+    //-------------------------------------------------------------------------------
+    static std::uint64_t CountAlphaAbove( const std::span<const std::uint8_t> Texels, const int AlphaByte, const std::uint8_t Threshold ) noexcept
+    {
+        std::uint64_t Count = 0;
+        std::size_t   i     = 0;
+
+#if XBITMAP_SSE2
+        alignas(16) std::array<std::uint8_t, 16> MaskBytes{};
+        for( int k = AlphaByte; k < 16; k += 4 ) MaskBytes[k] = 0xff;
+
+        // Unsigned compare through the signed one by flipping the top bit
+        const auto Mask  = _mm_load_si128( reinterpret_cast<const __m128i*>( MaskBytes.data() ) );
+        const auto Bias  = _mm_set1_epi8( static_cast<char>( 0x80 ) );
+        const auto Limit = _mm_xor_si128( _mm_set1_epi8( static_cast<char>( Threshold ) ), Bias );
+        const auto Zero  = _mm_setzero_si128();
+
+        while( i + 16 <= Texels.size() )
+        {
+            // Per lane 8 bit counters, flushed before they can overflow
+            auto       Acc = _mm_setzero_si128();
+            const auto End = std::min( Texels.size() - ( Texels.size() - i ) % 16, i + 255 * 16 );
+            for( ; i < End; i += 16 )
+            {
+                const auto V = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &Texels[i] ) ), Bias );
+                Acc = _mm_sub_epi8( Acc, _mm_and_si128( _mm_cmpgt_epi8( V, Limit ), Mask ) );
+            }
+
+            const auto Sum = _mm_sad_epu8( Acc, Zero );
+            Count += static_cast<std::uint64_t>( _mm_cvtsi128_si32( Sum ) ) + static_cast<std::uint64_t>( _mm_cvtsi128_si32( _mm_srli_si128( Sum, 8 ) ) );
+        }
+#endif
+        for( i += AlphaByte; i < Texels.size(); i += 4 )
+        {
+            Count += Texels[i] > Threshold;
+        }
+
+        return Count;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Fraction of texels that pass the alpha test at Reference once alpha is scaled
+    //-------------------------------------------------------------------------------
+    static float getAlphaCoverage( const std::span<const std::uint8_t> Texels, const int AlphaByte, const float Reference, const float Scale ) noexcept
+    {
+        // a * Scale > Reference * 255 is the same as a > floor( Reference * 255 / Scale ) for whole numbers
+        const float Threshold = Scale > 0 ? Reference * 255.0f / Scale : 255.0f;
+        if( Threshold >= 255.0f ) return 0;
+        return float( CountAlphaAbove( Texels, AlphaByte, static_cast<std::uint8_t>( std::max( 0.0f, Threshold ) ) ) ) / float( Texels.size() / 4 );
+    }
+
+    static float getAlphaCoverage( const std::span<const float> Alphas, const float Reference, const float Scale ) noexcept
+    {
+        std::size_t Count = 0;
+        for( const auto A : Alphas ) Count += A * Scale > Reference;
+        return float( Count ) / float( Alphas.size() );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Binary search for the alpha scale that brings the coverage back to Target.
+    // Coverage moves in steps so the closest one seen is kept.
+    //-------------------------------------------------------------------------------
+    template< typename T_COVERAGE >
+    float FindAlphaScale( const float Target, T_COVERAGE&& getCoverage ) noexcept
+    {
+        float Min       = 0;
+        float Max       = 4;
+        float Scale     = 1;
+        float Best      = 1;
+        float BestError = std::numeric_limits<float>::max();
+        for( int i = 0; i < 16; ++i )
+        {
+            const float Coverage = getCoverage( Scale );
+            if( const float Error = std::abs( Coverage - Target ); Error < BestError )
+            {
+                Best      = Scale;
+                BestError = Error;
+            }
+
+            if( Coverage < Target )      Min = Scale;
+            else if( Coverage > Target ) Max = Scale;
+            else                         break;
+            Scale = ( Min + Max ) * 0.5f;
+        }
+        return Best;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Scales the alpha of every mip after the first so its alpha test coverage at
+    // Reference matches the one of mip 0. The coverage of mip 0 is measured once per
+    // face and frame, then every mip of every face and frame is searched
+    // independently, spread across the threads. Only alpha is kept around, texels
+    // are decoded one row at a time.
+    //-------------------------------------------------------------------------------
+    static void PreserveAlphaCoverage( xbitmap& Bitmap, const float Reference ) noexcept
+    {
+        const auto Format  = Bitmap.getFormat();
+        const auto nMips   = Bitmap.getMipCount();
+        const auto nFaces  = Bitmap.getFaceCount();
+        const auto nSlices = static_cast<std::uint32_t>( nFaces * Bitmap.getFrameCount() );
+        if( nMips <= 1 ) return;
+
+        std::array<int, 4> Channels;
+        const bool         bBytes    = getFormatInfo( Format ).m_Kind == texel_kind::UNORM8 && getByteChannels( Format, Channels ) == 4;
+        const int          AlphaByte = bBytes ? static_cast<int>( std::find( Channels.begin(), Channels.end(), 3 ) - Channels.begin() ) : -1;
+        std::vector<float> Targets( nSlices );
+
+        if( bBytes )
+        {
+            if( AlphaByte == 4 ) return;
+
+            ParallelFor( nSlices, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto i = Begin; i < End; ++i ) Targets[i] = getAlphaCoverage( Bitmap.getMip<std::uint8_t>( 0, int(i) % nFaces, int(i) / nFaces ), AlphaByte, Reference, 1.0f );
+            });
+
+            ParallelFor( nSlices * ( nMips - 1 ), 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto i = Begin; i < End; ++i )
+                {
+                    const int  iMip   = static_cast<int>( i / nSlices ) + 1;
+                    const int  iFace  = static_cast<int>( i % nSlices ) % nFaces;
+                    const int  iFrame = static_cast<int>( i % nSlices ) / nFaces;
+                    auto       Mip    = Bitmap.getMip<std::uint8_t>( iMip, iFace, iFrame );
+                    const auto Scale  = FindAlphaScale( Targets[ i % nSlices ], [&]( float S ) noexcept { return getAlphaCoverage( Mip, AlphaByte, Reference, S ); } );
+
+                    for( std::size_t k = AlphaByte; k < Mip.size(); k += 4 )
+                    {
+                        Mip[k] = static_cast<std::uint8_t>( std::min( 255.0f, Mip[k] * Scale + 0.5f ) );
+                    }
+                }
+            });
+            return;
+        }
+
+        // Everything else goes through floats
+        const texel_codec Codec( Format, Bitmap.getColorSpace() == xbitmap::color_space::SRGB );
+        const auto        nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto        Alpha     = static_cast<std::size_t>( std::find( Codec.m_Channels.begin(), Codec.m_Channels.begin() + nC, 3 ) - Codec.m_Channels.begin() );
+        const auto        TexelSize = static_cast<std::size_t>( Codec.m_Info.m_BlockBytes );
+        if( nC < 4 || Alpha >= nC ) return;
+
+        // Alpha of every texel of a mip
+        const auto getAlphas = [&]( const std::byte* pData, const std::uint32_t W, const std::uint32_t H ) noexcept
+        {
+            std::vector<float> Row( W * nC ), Alphas( std::size_t(W) * H );
+            for( std::uint32_t y = 0; y < H; ++y )
+            {
+                Codec.Decode( &pData[ std::size_t(y) * W * TexelSize ], W, Row.data() );
+                for( std::uint32_t x = 0; x < W; ++x ) Alphas[ std::size_t(y) * W + x ] = Row[ x * nC + Alpha ];
+            }
+            return Alphas;
+        };
+
+        ParallelFor( nSlices, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            const auto         W = Bitmap.getWidth();
+            const auto         H = Bitmap.getHeight();
+            std::vector<float> Row( W * nC );
+            for( auto i = Begin; i < End; ++i )
+            {
+                const auto    pTop  = Bitmap.getMip<std::byte>( 0, int(i) % nFaces, int(i) / nFaces ).data();
+                std::uint64_t Count = 0;
+                for( std::uint32_t y = 0; y < H; ++y )
+                {
+                    Codec.Decode( &pTop[ std::size_t(y) * W * TexelSize ], W, Row.data() );
+                    for( std::uint32_t x = 0; x < W; ++x ) Count += Row[ x * nC + Alpha ] > Reference;
+                }
+                Targets[i] = float( Count ) / float( std::uint64_t(W) * H );
+            }
+        });
+
+        ParallelFor( nSlices * ( nMips - 1 ), 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( auto i = Begin; i < End; ++i )
+            {
+                const int  iMip   = static_cast<int>( i / nSlices ) + 1;
+                const int  iFace  = static_cast<int>( i % nSlices ) % nFaces;
+                const int  iFrame = static_cast<int>( i % nSlices ) / nFaces;
+                const auto W      = getMipDimension( Bitmap.getWidth(),  iMip );
+                const auto H      = getMipDimension( Bitmap.getHeight(), iMip );
+                auto       pMip   = Bitmap.getMip<std::byte>( iMip, iFace, iFrame ).data();
+
+                const auto MipAlphas = getAlphas( pMip, W, H );
+                const auto Scale     = FindAlphaScale( Targets[ i % nSlices ], [&]( float S ) noexcept { return getAlphaCoverage( MipAlphas, Reference, S ); } );
+
+                std::vector<float> Row( W * nC );
+                for( std::uint32_t y = 0; y < H; ++y )
+                {
+                    const auto pRow = &pMip[ std::size_t(y) * W * TexelSize ];
+                    Codec.Decode( pRow, W, Row.data() );
+                    for( std::size_t k = Alpha; k < Row.size(); k += nC ) Row[k] = std::min( 1.0f, Row[k] * Scale );
+                    Codec.Encode( Row.data(), W, pRow );
+                }
+            }
+        });
+    }
+
+    //-------------------------------------------------------------------------------
+    // Normal map mips. Each level averages the (not renormalized) mean vectors of the
+    // level above, kept as X, Y, Z planes, so the length lost by the average covers
+    // the whole footprint in mip 0. That length gives the Toksvig factor
+    // |N| / ( |N| + Power * ( 1 - |N| ) ); the stored normals are renormalized.
+    //-------------------------------------------------------------------------------
+    struct normal_planes
+    {
+        void resize( const std::size_t Count ) noexcept
+        {
+            m_X.resize( Count );
+            m_Y.resize( Count );
+            m_Z.resize( Count );
+        }
+
+        std::vector<float>  m_X {};
+        std::vector<float>  m_Y {};
+        std::vector<float>  m_Z {};
+    };
+
+    static void NormalMapMips( xbitmap& Bitmap, const xbitmap::mip_settings& Settings ) noexcept
+    {
+        assert( Bitmap.getFormat() == xbitmap::format::XCOLOR );
+        assert( Settings.m_ToksvigChannel < 4 );
+
+        const auto  nMips    = Bitmap.getMipCount();
+        const auto  nFaces   = Bitmap.getFaceCount();
+        const float Power    = Settings.m_ToksvigPower;
+        const int   Channel  = Power > 0 ? Settings.m_ToksvigChannel : -1;
+        xbitmap*    pToksvig = Power > 0 ? Settings.m_pToksvigBitmap : nullptr;
+
+        const auto Toksvig = [&]( const float Length ) noexcept
+        {
+            const float L = std::min( 1.0f, Length );
+            return static_cast<std::uint32_t>( L / std::max( 1e-6f, L + Power * ( 1.0f - L ) ) * 255.0f + 0.5f );
+        };
+
+        // Writes the renormalized normal, the averaged alpha and the Toksvig factor
+        const auto Store = [&]( std::uint32_t* pDest, std::uint8_t* pFactor, const std::uint32_t Encoded, const std::uint32_t Alpha, const float Length ) noexcept
+        {
+            auto Texel = ( Encoded & 0x00ffffffu ) | ( Alpha << 24 );
+            if( Channel >= 0 || pFactor )
+            {
+                const auto Factor = Toksvig( Length );
+                if( Channel >= 0 ) Texel = ( Texel & ~( 0xffu << ( 8 * Channel ) ) ) | ( Factor << ( 8 * Channel ) );
+                if( pFactor )      *pFactor = static_cast<std::uint8_t>( Factor );
+            }
+            *pDest = Texel;
+        };
+
+        if( pToksvig )
+        {
+            pToksvig->CreateBitmap( Bitmap.getWidth(), Bitmap.getHeight(), xbitmap::format::R8, nMips, Bitmap.getFrameCount(), Bitmap.isCubemap() );
+            pToksvig->setColorSpace( xbitmap::color_space::LINEAR );
+        }
+
+        for( int iFrame = 0; iFrame < Bitmap.getFrameCount(); ++iFrame )
+        for( int iFace  = 0; iFace  < nFaces;                 ++iFace  )
+        {
+            // Mip 0 is taken as unit normals so quantization does not show up as variance
+            normal_planes Prev, Next;
+            {
+                auto       Top    = Bitmap.getMip<std::uint32_t>( 0, iFace, iFrame );
+                const auto Factor = pToksvig ? pToksvig->getMip<std::uint8_t>( 0, iFace, iFrame ).data() : nullptr;
+                Prev.resize( Top.size() );
+                for( std::size_t i = 0; i < Top.size(); ++i )
+                {
+                    const float X   = ( static_cast<float>( ( Top[i] >>  0 ) & 0xff ) - 127.0f ) * ( 1.0f / 127.0f );
+                    const float Y   = ( static_cast<float>( ( Top[i] >>  8 ) & 0xff ) - 127.0f ) * ( 1.0f / 127.0f );
+                    const float Z   = ( static_cast<float>( ( Top[i] >> 16 ) & 0xff ) - 127.0f ) * ( 1.0f / 127.0f );
+                    const float Inv = 1.0f / std::max( 1e-6f, std::sqrt( X * X + Y * Y + Z * Z ) );
+                    Prev.m_X[i] = X * Inv;
+                    Prev.m_Y[i] = Y * Inv;
+                    Prev.m_Z[i] = Z * Inv;
+                    Store( &Top[i], Factor ? &Factor[i] : nullptr, Top[i], Top[i] >> 24, 1.0f );
+                }
+            }
+
+            for( int iMip = 1; iMip < nMips; ++iMip )
+            {
+                const auto SrcW    = getMipDimension( Bitmap.getWidth(),  iMip - 1 );
+                const auto SrcH    = getMipDimension( Bitmap.getHeight(), iMip - 1 );
+                const auto DestW   = getMipDimension( Bitmap.getWidth(),  iMip );
+                const auto DestH   = getMipDimension( Bitmap.getHeight(), iMip );
+                const auto Src     = Bitmap.getMip<std::uint32_t>( iMip - 1, iFace, iFrame );
+                auto       Dest    = Bitmap.getMip<std::uint32_t>( iMip,     iFace, iFrame );
+                const auto pFactor = pToksvig ? pToksvig->getMip<std::uint8_t>( iMip, iFace, iFrame ).data() : nullptr;
+                Next.resize( std::size_t(DestW) * DestH );
+
+                ParallelFor( DestH, 8, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+                {
+                    for( auto y = Begin; y < End; ++y )
+                    {
+                        const auto    TapsY = getBoxTaps( SrcH, y );
+                        std::uint32_t x     = 0;
+
+#if XBITMAP_SSE2
+                        if( ( SrcW & 1 ) == 0 && TapsY.m_nTaps <= 2 )
+                        {
+                            const auto Row0    = std::size_t( TapsY.m_First ) * SrcW;
+                            const auto Row1    = std::size_t( TapsY.m_First + TapsY.m_nTaps - 1 ) * SrcW;
+                            const auto Quarter = _mm_set1_ps( 0.25f );
+                            const auto Reduce  = [&]( const std::vector<float>& Plane, const std::uint32_t x ) noexcept
+                            {
+                                const auto A0 = _mm_loadu_ps( &Plane[ Row0 + 2 * x ] );
+                                const auto B0 = _mm_loadu_ps( &Plane[ Row0 + 2 * x + 4 ] );
+                                const auto A1 = _mm_loadu_ps( &Plane[ Row1 + 2 * x ] );
+                                const auto B1 = _mm_loadu_ps( &Plane[ Row1 + 2 * x + 4 ] );
+                                const auto S0 = _mm_add_ps( _mm_shuffle_ps( A0, B0, _MM_SHUFFLE( 2, 0, 2, 0 ) ), _mm_shuffle_ps( A0, B0, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+                                const auto S1 = _mm_add_ps( _mm_shuffle_ps( A1, B1, _MM_SHUFFLE( 2, 0, 2, 0 ) ), _mm_shuffle_ps( A1, B1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+                                return _mm_mul_ps( _mm_add_ps( S0, S1 ), Quarter );
+                            };
+
+                            for( ; x + 4 <= DestW; x += 4 )
+                            {
+                                const auto X      = Reduce( Prev.m_X, x );
+                                const auto Y      = Reduce( Prev.m_Y, x );
+                                const auto Z      = Reduce( Prev.m_Z, x );
+                                const auto Length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( X, X ), _mm_mul_ps( Y, Y ) ), _mm_mul_ps( Z, Z ) ) );
+                                const auto Inv    = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_max_ps( Length, _mm_set1_ps( 1e-6f ) ) );
+                                const auto iDest  = std::size_t(y) * DestW + x;
+
+                                _mm_storeu_ps( &Next.m_X[iDest], X );
+                                _mm_storeu_ps( &Next.m_Y[iDest], Y );
+                                _mm_storeu_ps( &Next.m_Z[iDest], Z );
+
+                                alignas(16) std::array<std::uint32_t, 4> Encoded;
+                                alignas(16) std::array<float, 4>         Lengths;
+                                _mm_store_si128( reinterpret_cast<__m128i*>( Encoded.data() ), EncodeNormal4( _mm_mul_ps( X, Inv ), _mm_mul_ps( Y, Inv ), _mm_mul_ps( Z, Inv ) ) );
+                                _mm_store_ps( Lengths.data(), Length );
+
+                                for( int k = 0; k < 4; ++k )
+                                {
+                                    const auto a = Row0 + 2 * ( x + k );
+                                    const auto b = Row1 + 2 * ( x + k );
+                                    const auto Alpha = ( ( Src[a] >> 24 ) + ( Src[a + 1] >> 24 ) + ( Src[b] >> 24 ) + ( Src[b + 1] >> 24 ) + 2 ) >> 2;
+                                    Store( &Dest[ iDest + k ], pFactor ? &pFactor[ iDest + k ] : nullptr, Encoded[k], Alpha, Lengths[k] );
+                                }
+                            }
+                        }
+#endif
+                        for( ; x < DestW; ++x )
+                        {
+                            const auto TapsX = getBoxTaps( SrcW, x );
+                            float X = 0, Y = 0, Z = 0, Alpha = 0;
+                            for( int ty = 0; ty < TapsY.m_nTaps; ++ty )
+                            for( int tx = 0; tx < TapsX.m_nTaps; ++tx )
+                            {
+                                const float W = TapsY.m_Weight[ty] * TapsX.m_Weight[tx];
+                                const auto  i = std::size_t( TapsY.m_First + ty ) * SrcW + TapsX.m_First + tx;
+                                X     += Prev.m_X[i] * W;
+                                Y     += Prev.m_Y[i] * W;
+                                Z     += Prev.m_Z[i] * W;
+                                Alpha += static_cast<float>( Src[i] >> 24 ) * W;
+                            }
+
+                            const auto  iDest  = std::size_t(y) * DestW + x;
+                            const float Length = std::sqrt( X * X + Y * Y + Z * Z );
+                            const float Inv    = 1.0f / std::max( 1e-6f, Length );
+                            Next.m_X[iDest] = X;
+                            Next.m_Y[iDest] = Y;
+                            Next.m_Z[iDest] = Z;
+                            Store( &Dest[iDest], pFactor ? &pFactor[iDest] : nullptr, EncodeNormal( X * Inv, Y * Inv, Z * Inv ), static_cast<std::uint32_t>( Alpha + 0.5f ), Length );
+                        }
+                    }
+                });
+
+                std::swap( Prev, Next );
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Cube map mips without seams. Each level is a [1 3 3 1] tent over the level above
+    // whose taps past a face edge come from the neighbor face, then the texels along
+    // every shared edge and corner are averaged so both sides match exactly. All the
+    // rows of the 6 faces of every frame are filtered at once.
+    //-------------------------------------------------------------------------------
+    static void SeamlessCubemapMips( xbitmap& Bitmap ) noexcept
+    {
+        assert( Bitmap.isCubemap() );
+        assert( Bitmap.getWidth() == Bitmap.getHeight() );
+
+        const texel_codec Codec( Bitmap.getFormat(), Bitmap.getColorSpace() == xbitmap::color_space::SRGB );
+        const auto        nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto        TexelSize = static_cast<std::size_t>( Codec.m_Info.m_BlockBytes );
+        const auto        nFrames   = static_cast<std::uint32_t>( Bitmap.getFrameCount() );
+        constexpr float   Weights[] = { 1.0f / 8, 3.0f / 8, 3.0f / 8, 1.0f / 8 };
+
+        for( int iMip = 1; iMip < Bitmap.getMipCount(); ++iMip )
+        {
+            const auto SrcSize  = getMipDimension( Bitmap.getWidth(), iMip - 1 );
+            const auto DestSize = getMipDimension( Bitmap.getWidth(), iMip );
+            const auto SrcFace  = std::size_t(SrcSize)  * SrcSize  * nC;
+            const auto DestFace = std::size_t(DestSize) * DestSize * nC;
+
+            // Where every tap of a face lands, the same for all faces and frames
+            std::vector<cube_texel> Taps( 6 * std::size_t(SrcSize + 2) * ( SrcSize + 2 ) );
+            for( int iFace = 0; iFace < 6; ++iFace )
+            for( int y = -1; y <= static_cast<int>( SrcSize ); ++y )
+            for( int x = -1; x <= static_cast<int>( SrcSize ); ++x )
+            {
+                Taps[ ( iFace * std::size_t(SrcSize + 2) + y + 1 ) * ( SrcSize + 2 ) + x + 1 ] = getCubeTexel( iFace, x, y, SrcSize );
+            }
+
+            std::vector<float> Src( nFrames * 6 * SrcFace );
+            std::vector<float> Dest( nFrames * 6 * DestFace );
+
+            ParallelFor( nFrames * 6, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto i = Begin; i < End; ++i )
+                {
+                    Codec.Decode( Bitmap.getMip<std::byte>( iMip - 1, i % 6, i / 6 ).data(), SrcSize * SrcSize, &Src[ i * SrcFace ] );
+                }
+            });
+
+            ParallelFor( nFrames * 6 * DestSize, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto iRow = Begin; iRow < End; ++iRow )
+                {
+                    const auto iSlice = iRow / DestSize;
+                    const auto iFace  = iSlice % 6;
+                    const auto pFrame = &Src[ ( iSlice - iFace ) * SrcFace ];
+                    const auto y      = static_cast<int>( iRow % DestSize );
+                    auto       pOut   = &Dest[ iSlice * DestFace + std::size_t(y) * DestSize * nC ];
+
+                    for( int x = 0; x < static_cast<int>( DestSize ); ++x, pOut += nC )
+                    {
+                        std::array<float, 4> Sum{};
+                        for( int ty = 0; ty < 4; ++ty )
+                        for( int tx = 0; tx < 4; ++tx )
+                        {
+                            const int  sx  = 2 * x - 1 + tx;
+                            const int  sy  = 2 * y - 1 + ty;
+                            const auto Tap = Taps[ ( iFace * std::size_t(SrcSize + 2) + sy + 1 ) * ( SrcSize + 2 ) + sx + 1 ];
+                            const auto pIn = &pFrame[ Tap.m_iFace * SrcFace + ( std::size_t(Tap.m_Y) * SrcSize + Tap.m_X ) * nC ];
+                            const float W  = Weights[tx] * Weights[ty];
+                            for( std::size_t c = 0; c < nC; ++c ) Sum[c] += pIn[c] * W;
+                        }
+                        std::copy_n( Sum.begin(), nC, pOut );
+                    }
+                }
+            });
+
+            // Edge fixup, texels that touch across an edge or corner get the same value
+            ParallelFor( nFrames * 6 * DestSize, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                std::vector<float> Row( std::size_t(DestSize) * nC );
+                for( auto iRow = Begin; iRow < End; ++iRow )
+                {
+                    const auto iSlice = iRow / DestSize;
+                    const auto iFace  = static_cast<int>( iSlice % 6 );
+                    const auto pFrame = &Dest[ ( iSlice - iFace ) * DestFace ];
+                    const int  y      = static_cast<int>( iRow % DestSize );
+                    const int  Last   = static_cast<int>( DestSize ) - 1;
+
+                    std::copy_n( &pFrame[ iFace * DestFace + std::size_t(y) * DestSize * nC ], Row.size(), Row.begin() );
+                    for( int x = 0; x <= Last; ++x )
+                    {
+                        if( x != 0 && x != Last && y != 0 && y != Last ) continue;
+
+                        std::array<cube_texel, 5> Set{ cube_texel{ iFace, std::uint32_t(x), std::uint32_t(y) } };
+                        int n = 1;
+                        const auto Add = [&]( const int X, const int Y ) noexcept
+                        {
+                            const auto T = getCubeTexel( iFace, X, Y, DestSize );
+                            for( int k = 0; k < n; ++k ) if( Set[k].m_iFace == T.m_iFace && Set[k].m_X == T.m_X && Set[k].m_Y == T.m_Y ) return;
+                            Set[ n++ ] = T;
+                        };
+                        if( x == 0 )    Add( -1,       y );
+                        if( x == Last ) Add( Last + 1, y );
+                        if( y == 0 )    Add( x,       -1 );
+                        if( y == Last ) Add( x, Last + 1 );
+
+                        for( std::size_t c = 0; c < nC; ++c )
+                        {
+                            float Sum = 0;
+                            for( int k = 0; k < n; ++k ) Sum += pFrame[ Set[k].m_iFace * DestFace + ( std::size_t(Set[k].m_Y) * DestSize + Set[k].m_X ) * nC + c ];
+                            Row[ x * nC + c ] = Sum / n;
+                        }
+                    }
+
+                    Codec.Encode( Row.data(), DestSize, &Bitmap.getMip<std::byte>( iMip, iFace, static_cast<int>( iSlice / 6 ) ).data()[ std::size_t(y) * DestSize * TexelSize ] );
+                }
+            });
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Replaces the mip chain with nMips levels built from mip 0. The final layout
+// (offset table, every face and frame) is allocated once and each level is
+// filtered straight from the previous one. sRGB bitmaps are filtered in linear
+// space. The box and separable filters keep the texel layout, normal map and
+// seamless cube map mips are built row major.
+//-------------------------------------------------------------------------------
+void xbitmap::GenerateMips( const mip_settings& Settings, int nMips ) noexcept
+{
+    assert( isValid() );
+    assert( Settings.m_Filter < mip_filter::ENUM_COUNT );
+
+    if( getLayout() != texel_layout::LINEAR && ( Settings.m_bNormalMap || ( Settings.m_bSeamlessCubemap && isCubemap() ) ) )
+    {
+        xbitmap_details::linear_scope Linear( *this );
+        return GenerateMips( Settings, nMips );
+    }
+
+    const auto& Info = xbitmap_details::getFormatInfo( getFormat() );
+    assert( Info.m_Kind != xbitmap_details::texel_kind::UNSUPPORTED && Info.m_Kind != xbitmap_details::texel_kind::BLOCK );
+
+    const int FullChain = getFullMipChainCount();
+    nMips = nMips < 0 ? FullChain : std::clamp( nMips, 1, FullChain );
+
+    // The new bitmap keeps all our settings (wrap modes, color space, etc.)
+    xbitmap Final;
+    Final.CreateBitmap( getWidth(), getHeight(), getFormat(), nMips, getFrameCount(), isCubemap() );
+    Final.m_Flags               = m_Flags;
+    Final.m_Flags.m_bOwnsMemory = true;
+    Final.m_ClampColor          = m_ClampColor;
+    Final.m_Layout              = m_Layout;
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    for( int iFace  = 0; iFace  < getFaceCount();  ++iFace  )
+    {
+        std::memcpy( Final.getMipPtr( 0, iFace, iFrame ), getMipPtr( 0, iFace, iFrame ), Final.getMipSize(0) );
+    }
+
+    if( Settings.m_bNormalMap )
+    {
+        xbitmap_details::NormalMapMips( Final, Settings );
+    }
+    else if( Settings.m_bSeamlessCubemap && isCubemap() )
+    {
+        xbitmap_details::SeamlessCubemapMips( Final );
+    }
+    else
+    {
+        for( int iMip = 1; iMip < nMips; ++iMip )
+        {
+            if( Settings.m_Filter == mip_filter::BOX ) xbitmap_details::BoxFilterMip( Final, iMip );
+            else                                       xbitmap_details::SeparableFilterMip( Final, iMip, Settings.m_Filter );
+        }
+    }
+
+    if( Settings.m_bPreserveAlphaCoverage ) xbitmap_details::PreserveAlphaCoverage( Final, Settings.m_AlphaReference );
+
+    Kill();
+    *this = std::move( Final );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::GenerateMips( int nMips ) noexcept
+{
+    GenerateMips( mip_settings{}, nMips );
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// CUBE MAP LIGHTING
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    inline std::array<float, 3> Normalize( const std::array<float, 3>& V ) noexcept
+    {
+        const float Inv = 1.0f / std::sqrt( V[0] * V[0] + V[1] * V[1] + V[2] * V[2] );
+        return { V[0] * Inv, V[1] * Inv, V[2] * Inv };
+    }
+
+    //-------------------------------------------------------------------------------
+    // One frame of a cube map as RGBA floats with a full mip chain. Mips missing in
+    // the source are box filtered from the last one it has.
+    //-------------------------------------------------------------------------------
+    struct float_cubemap
+    {
+        float_cubemap( const xbitmap& Bitmap, const int iFrame ) noexcept
+            : m_Size ( Bitmap.getWidth() )
+            , m_nMips( Bitmap.getFullMipChainCount() )
+        {
+            assert( Bitmap.isCubemap() );
+            assert( Bitmap.getWidth() == Bitmap.getHeight() );
+
+            const texel_codec Codec( Bitmap.getFormat(), Bitmap.getColorSpace() == xbitmap::color_space::SRGB );
+            assert( Codec.m_nChannels == 4 );
+
+            m_Faces.resize( std::size_t(m_nMips) * 6 );
+            for( int iMip = 0; iMip < m_nMips; ++iMip )
+            for( int iFace = 0; iFace < 6; ++iFace )
+            {
+                const auto Size = getMipDimension( m_Size, iMip );
+                auto&      Face = m_Faces[ iMip * 6 + iFace ];
+                Face.resize( std::size_t(Size) * Size * 4 );
+
+                if( iMip < Bitmap.getMipCount() )
+                {
+                    Codec.Decode( Bitmap.getMip<std::byte>( iMip, iFace, iFrame ).data(), Size * Size, Face.data() );
+                    continue;
+                }
+
+                const auto& Src     = m_Faces[ ( iMip - 1 ) * 6 + iFace ];
+                const auto  SrcSize = getMipDimension( m_Size, iMip - 1 );
+                for( std::uint32_t y = 0; y < Size; ++y )
+                for( std::uint32_t x = 0; x < Size; ++x )
+                for( int c = 0; c < 4; ++c )
+                {
+                    const auto At = [&]( std::uint32_t sx, std::uint32_t sy ) noexcept { return Src[ ( std::size_t( std::min( sy, SrcSize - 1 ) ) * SrcSize + std::min( sx, SrcSize - 1 ) ) * 4 + c ]; };
+                    Face[ ( std::size_t(y) * Size + x ) * 4 + c ] = 0.25f * ( At( 2 * x, 2 * y ) + At( 2 * x + 1, 2 * y ) + At( 2 * x, 2 * y + 1 ) + At( 2 * x + 1, 2 * y + 1 ) );
+                }
+            }
+        }
+
+        //-------------------------------------------------------------------------------
+        // Bilinear inside the face the direction lands on
+        //-------------------------------------------------------------------------------
+        std::array<float, 4> SampleMip( const std::array<float, 3>& Dir, const int iMip ) const noexcept
+        {
+            float U, V;
+            const int  iFace = getCubeFace( Dir, U, V );
+            const auto Size  = static_cast<int>( getMipDimension( m_Size, iMip ) );
+            const auto& Face = m_Faces[ iMip * 6 + iFace ];
+
+            const float X  = U * Size - 0.5f;
+            const float Y  = V * Size - 0.5f;
+            const float Fx = X - std::floor( X );
+            const float Fy = Y - std::floor( Y );
+            const int   X0 = std::clamp( static_cast<int>( std::floor( X ) ),     0, Size - 1 );
+            const int   X1 = std::clamp( static_cast<int>( std::floor( X ) ) + 1, 0, Size - 1 );
+            const int   Y0 = std::clamp( static_cast<int>( std::floor( Y ) ),     0, Size - 1 );
+            const int   Y1 = std::clamp( static_cast<int>( std::floor( Y ) ) + 1, 0, Size - 1 );
+
+            std::array<float, 4> Result;
+            for( int c = 0; c < 4; ++c )
+            {
+                const float Top    = Face[ ( Y0 * Size + X0 ) * 4 + c ] * ( 1 - Fx ) + Face[ ( Y0 * Size + X1 ) * 4 + c ] * Fx;
+                const float Bottom = Face[ ( Y1 * Size + X0 ) * 4 + c ] * ( 1 - Fx ) + Face[ ( Y1 * Size + X1 ) * 4 + c ] * Fx;
+                Result[c] = Top * ( 1 - Fy ) + Bottom * Fy;
+            }
+            return Result;
+        }
+
+        //-------------------------------------------------------------------------------
+        // Trilinear across mips
+        //-------------------------------------------------------------------------------
+        std::array<float, 4> Sample( const std::array<float, 3>& Dir, const float Lod ) const noexcept
+        {
+            const float L  = std::clamp( Lod, 0.0f, float( m_nMips - 1 ) );
+            const int   L0 = static_cast<int>( L );
+            const float F  = L - L0;
+            auto        A  = SampleMip( Dir, L0 );
+            if( F > 0 )
+            {
+                const auto B = SampleMip( Dir, std::min( L0 + 1, m_nMips - 1 ) );
+                for( int c = 0; c < 4; ++c ) A[c] += ( B[c] - A[c] ) * F;
+            }
+            return A;
+        }
+
+        std::uint32_t                       m_Size;
+        int                                 m_nMips;
+        std::vector<std::vector<float>>     m_Faces;            // [iMip * 6 + iFace], RGBA per texel
+    };
+
+    //-------------------------------------------------------------------------------
+    // GGX importance samples around +Z (the normal, which is also the view vector) with
+    // the source mip each one should read from (filtered importance sampling). Stored
+    // as structure of arrays padded to a multiple of 4 with weightless samples.
+    //-------------------------------------------------------------------------------
+    struct ggx_samples
+    {
+        void push_back( const float X, const float Y, const float Z, const float Weight, const float Lod ) noexcept
+        {
+            m_X.push_back( X );
+            m_Y.push_back( Y );
+            m_Z.push_back( Z );
+            m_Weight.push_back( Weight );
+            m_Lod.push_back( Lod );
+        }
+
+        std::vector<float>  m_X         {};
+        std::vector<float>  m_Y         {};
+        std::vector<float>  m_Z         {};
+        std::vector<float>  m_Weight    {};
+        std::vector<float>  m_Lod       {};
+        float               m_Total     {};
+    };
+
+    // Van der Corput sequence in base 2, the second coordinate of the Hammersley set
+    inline float RadicalInverse( std::uint32_t B ) noexcept
+    {
+        B = ( B << 16 ) | ( B >> 16 );
+        B = ( ( B & 0x55555555u ) << 1 ) | ( ( B & 0xaaaaaaaau ) >> 1 );
+        B = ( ( B & 0x33333333u ) << 2 ) | ( ( B & 0xccccccccu ) >> 2 );
+        B = ( ( B & 0x0f0f0f0fu ) << 4 ) | ( ( B & 0xf0f0f0f0u ) >> 4 );
+        B = ( ( B & 0x00ff00ffu ) << 8 ) | ( ( B & 0xff00ff00u ) >> 8 );
+        return float( B ) * ( 1.0f / 4294967296.0f );
+    }
+
+    //-------------------------------------------------------------------------------
+
+    static ggx_samples BuildGGXSamples( const float Roughness, const int nSamples, const std::uint32_t SourceSize ) noexcept
+    {
+        const float Alpha2          = std::max( 1e-8f, Roughness * Roughness * Roughness * Roughness );
+        const float TexelSolidAngle = 4.0f * pi_v / ( 6.0f * SourceSize * SourceSize );
+
+        ggx_samples Samples;
+        for( int i = 0; i < nSamples; ++i )
+        {
+            // Hammersley point set
+            const float E1 = float(i) / float(nSamples);
+            const float E2 = RadicalInverse( static_cast<std::uint32_t>( i ) );
+
+            // Half vector from the GGX distribution, the light is the view mirrored around it
+            const float Phi      = 2.0f * pi_v * E1;
+            const float CosTheta = std::sqrt( ( 1.0f - E2 ) / ( 1.0f + ( Alpha2 - 1.0f ) * E2 ) );
+            const float SinTheta = std::sqrt( 1.0f - CosTheta * CosTheta );
+            const float Hx       = SinTheta * std::cos( Phi );
+            const float Hy       = SinTheta * std::sin( Phi );
+            const float NdotL    = 2.0f * CosTheta * CosTheta - 1.0f;
+            if( NdotL <= 0 ) continue;
+
+            // With N == V the pdf of L is D(H) / 4
+            const float Denom            = CosTheta * CosTheta * ( Alpha2 - 1.0f ) + 1.0f;
+            const float Pdf              = Alpha2 / ( pi_v * Denom * Denom ) * 0.25f;
+            const float SampleSolidAngle = 1.0f / ( nSamples * Pdf + 1e-6f );
+            const float Lod              = std::max( 0.0f, 0.5f * std::log2( SampleSolidAngle / TexelSolidAngle ) + 1.0f );
+
+            Samples.push_back( 2.0f * CosTheta * Hx, 2.0f * CosTheta * Hy, NdotL, NdotL, Lod );
+            Samples.m_Total += NdotL;
+        }
+
+        while( Samples.m_X.size() % 4 ) Samples.push_back( 0, 0, 1, 0, 0 );
+        return Samples;
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Prefiltered specular chain for image based lighting. Mip i of Dest is the GGX
+// convolution of this HDR cube map for perceptual roughness i / (nMips - 1), with
+// N == V as usual. Faces are split in 8x8 tiles that are spread across the threads.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateGGXSpecularCubemap( xbitmap& Dest, int nMips, const int nSamples ) const noexcept
+{
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).CreateGGXSpecularCubemap( Dest, nMips, nSamples );
+    }
+
+    assert( isValid() );
+    assert( isCubemap() );
+    assert( getFormat() == format::R16G16B16A16_SFLOAT || getFormat() == format::R32G32B32A32_FLOAT );
+    assert( nSamples > 0 );
+    assert( &Dest != this );
+
+    const int FullChain = getFullMipChainCount();
+    nMips = nMips < 0 ? FullChain : std::clamp( nMips, 1, FullChain );
+
+    Dest.CreateBitmap( getWidth(), getHeight(), getFormat(), nMips, getFrameCount(), true );
+    Dest.setColorSpace( color_space::LINEAR );
+
+    const xbitmap_details::texel_codec Codec( getFormat(), false );
+    constexpr std::uint32_t            TileSize = 8;
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    {
+        const xbitmap_details::float_cubemap Source( *this, iFrame );
+
+        for( int iFace = 0; iFace < 6; ++iFace )
+        {
+            std::memcpy( Dest.getMipPtr( 0, iFace, iFrame ), getMipPtr( 0, iFace, iFrame ), Dest.getMipSize(0) );
+        }
+
+        for( int iMip = 1; iMip < nMips; ++iMip )
+        {
+            const auto Size    = xbitmap_details::getMipDimension( getWidth(), iMip );
+            const auto nTiles  = ( Size + TileSize - 1 ) / TileSize;
+            const auto Samples = xbitmap_details::BuildGGXSamples( float(iMip) / float( std::max( 1, nMips - 1 ) ), nSamples, getWidth() );
+
+            xbitmap_details::ParallelFor( 6 * nTiles * nTiles, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                std::vector<float> World( Samples.m_X.size() * 3 );
+                std::vector<float> Row( TileSize * 4 );
+
+                for( auto iTile = Begin; iTile < End; ++iTile )
+                {
+                    const int  iFace = static_cast<int>( iTile / ( nTiles * nTiles ) );
+                    const auto X0    = ( iTile % nTiles ) * TileSize;
+                    const auto Y0    = ( ( iTile / nTiles ) % nTiles ) * TileSize;
+                    const auto X1    = std::min( Size, X0 + TileSize );
+                    const auto Y1    = std::min( Size, Y0 + TileSize );
+                    auto       pDest = Dest.getMip<std::byte>( iMip, iFace, iFrame ).data();
+
+                    for( auto y = Y0; y < Y1; ++y )
+                    {
+                        for( auto x = X0; x < X1; ++x )
+                        {
+                            // Tangent frame around the texel direction
+                            const auto N  = xbitmap_details::Normalize( xbitmap_details::getCubeDirection( iFace, ( x + 0.5f ) / Size, ( y + 0.5f ) / Size ) );
+                            const auto T  = xbitmap_details::Normalize( std::abs( N[2] ) < 0.999f ? std::array<float, 3>{ -N[1], N[0], 0 } : std::array<float, 3>{ 0, -N[2], N[1] } );
+                            const std::array<float, 3> B{ N[1] * T[2] - N[2] * T[1], N[2] * T[0] - N[0] * T[2], N[0] * T[1] - N[1] * T[0] };
+
+                            std::size_t i = 0;
+#if XBITMAP_SSE2
+                            for( ; i < Samples.m_X.size(); i += 4 )
+                            {
+                                const auto Sx = _mm_loadu_ps( &Samples.m_X[i] );
+                                const auto Sy = _mm_loadu_ps( &Samples.m_Y[i] );
+                                const auto Sz = _mm_loadu_ps( &Samples.m_Z[i] );
+                                for( int k = 0; k < 3; ++k )
+                                {
+                                    const auto V = _mm_add_ps( _mm_add_ps( _mm_mul_ps( Sx, _mm_set1_ps( T[k] ) ), _mm_mul_ps( Sy, _mm_set1_ps( B[k] ) ) ), _mm_mul_ps( Sz, _mm_set1_ps( N[k] ) ) );
+                                    _mm_storeu_ps( &World[ k * Samples.m_X.size() + i ], V );
+                                }
+                            }
+#endif
+                            for( ; i < Samples.m_X.size(); ++i )
+                            {
+                                for( int k = 0; k < 3; ++k ) World[ k * Samples.m_X.size() + i ] = Samples.m_X[i] * T[k] + Samples.m_Y[i] * B[k] + Samples.m_Z[i] * N[k];
+                            }
+
+                            std::array<float, 4> Sum{};
+                            for( i = 0; i < Samples.m_X.size(); ++i )
+                            {
+                                if( Samples.m_Weight[i] == 0 ) continue;
+                                const auto C = Source.Sample( { World[i], World[ Samples.m_X.size() + i ], World[ 2 * Samples.m_X.size() + i ] }, Samples.m_Lod[i] );
+                                for( int c = 0; c < 4; ++c ) Sum[c] += C[c] * Samples.m_Weight[i];
+                            }
+
+                            for( int c = 0; c < 4; ++c ) Row[ ( x - X0 ) * 4 + c ] = Sum[c] / Samples.m_Total;
+                        }
+
+                        Codec.Encode( Row.data(), X1 - X0, &pDest[ ( std::size_t(y) * Size + X0 ) * Codec.m_Info.m_BlockBytes ] );
+                    }
+                }
+            });
+        }
+    }
+}
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Real L2 spherical harmonics basis for a unit direction
+    //-------------------------------------------------------------------------------
+    inline std::array<float, 9> EvaluateSH9( const std::array<float, 3>& D ) noexcept
+    {
+        const float x = D[0], y = D[1], z = D[2];
+        return
+        { 0.282095f
+        , 0.488603f * y
+        , 0.488603f * z
+        , 0.488603f * x
+        , 1.092548f * x * y
+        , 1.092548f * y * z
+        , 0.315392f * ( 3.0f * z * z - 1.0f )
+        , 1.092548f * x * z
+        , 0.546274f * ( x * x - y * y )
+        };
+    }
+
+    //-------------------------------------------------------------------------------
+    // Running sum of Color * Weight * Y(Dir), one RGB_ lane group per coefficient
+    //-------------------------------------------------------------------------------
+    struct sh9_accumulator
+    {
+        void Add( const std::array<float, 3>& Dir, const float* pRGB, const float Weight ) noexcept
+        {
+            const auto Y = EvaluateSH9( Dir );
+#if XBITMAP_SSE2
+            const auto C = _mm_mul_ps( _mm_setr_ps( pRGB[0], pRGB[1], pRGB[2], 0 ), _mm_set1_ps( Weight ) );
+            for( int i = 0; i < 9; ++i )
+            {
+                _mm_storeu_ps( &m_Sum[i][0], _mm_add_ps( _mm_loadu_ps( &m_Sum[i][0] ), _mm_mul_ps( C, _mm_set1_ps( Y[i] ) ) ) );
+            }
+#else
+            for( int i = 0; i < 9; ++i )
+            for( int c = 0; c < 3; ++c ) m_Sum[i][c] += pRGB[c] * Weight * Y[i];
+#endif
+        }
+
+        void Add( const sh9_accumulator& Other ) noexcept
+        {
+            for( int i = 0; i < 9; ++i )
+            for( int c = 0; c < 3; ++c ) m_Sum[i][c] += Other.m_Sum[i][c];
+        }
+
+        std::array<std::array<float, 4>, 9>     m_Sum {};
+    };
+}
+
+//-------------------------------------------------------------------------------
+// Projects the radiance of a cube map, or of an equirectangular map (any other
+// bitmap), into L2 spherical harmonics. Every texel is weighted by its solid angle.
+// Rows are accumulated in parallel and reduced in order, so the result does not
+// depend on the number of threads.
+//-------------------------------------------------------------------------------
+xbitmap::sh9 xbitmap::ProjectSH9( const int iFrame ) const noexcept
+{
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).ProjectSH9( iFrame );
+    }
+
+    assert( isValid() );
+    assert( iFrame < getFrameCount() );
+
+    const xbitmap_details::texel_codec Codec( getFormat(), getColorSpace() == color_space::SRGB );
+    const auto nC     = static_cast<std::size_t>( Codec.m_nChannels );
+    const auto Width  = getWidth();
+    const auto Height = getHeight();
+    const auto nRows  = static_cast<std::uint32_t>( getFaceCount() ) * Height;
+
+    // Where R, G and B are in a decoded texel (missing ones read as R)
+    std::array<std::size_t, 3> RGB{};
+    for( std::size_t i = 0; i < nC; ++i ) if( Codec.m_Channels[i] >= 0 && Codec.m_Channels[i] < 3 ) RGB[ Codec.m_Channels[i] ] = i;
+
+    std::vector<xbitmap_details::sh9_accumulator> Rows( nRows );
+    xbitmap_details::ParallelFor( nRows, 16, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        std::vector<float> Texels( std::size_t(Width) * nC );
+        for( auto iRow = Begin; iRow < End; ++iRow )
+        {
+            const int  iFace = static_cast<int>( iRow / Height );
+            const auto y     = iRow % Height;
+            Codec.Decode( &getMip<std::byte>( 0, iFace, iFrame ).data()[ std::size_t(y) * Width * Codec.m_Info.m_BlockBytes ], Width, Texels.data() );
+
+            // Equirect texels shrink toward the poles
+            const float RowSolidAngle = ( 2.0f * xbitmap_details::pi_v / Width ) * ( xbitmap_details::pi_v / Height ) * std::sin( xbitmap_details::pi_v * ( y + 0.5f ) / Height );
+
+            for( std::uint32_t x = 0; x < Width; ++x )
+            {
+                const auto  pTexel = &Texels[ x * nC ];
+                const float Color[] = { pTexel[ RGB[0] ], pTexel[ RGB[1] ], pTexel[ RGB[2] ] };
+
+                if( isCubemap() )
+                {
+                    const auto Dir = xbitmap_details::Normalize( xbitmap_details::getCubeDirection( iFace, ( x + 0.5f ) / Width, ( y + 0.5f ) / Height ) );
+                    Rows[iRow].Add( Dir, Color, xbitmap_details::getCubeTexelSolidAngle( x, y, Width ) );
+                }
+                else
+                {
+                    Rows[iRow].Add( xbitmap_details::getEquirectDirection( ( x + 0.5f ) / Width, ( y + 0.5f ) / Height ), Color, RowSolidAngle );
+                }
+            }
+        }
+    });
+
+    xbitmap_details::sh9_accumulator Total;
+    for( const auto& Row : Rows ) Total.Add( Row );
+
+    sh9 SH;
+    for( int i = 0; i < 9; ++i ) SH[i] = { Total.m_Sum[i][0], Total.m_Sum[i][1], Total.m_Sum[i][2] };
+    return SH;
+}
+
+//-------------------------------------------------------------------------------
+// Renders the irradiance E(n) of the SH radiance into a new cube map, using the
+// clamped cosine convolution (pi, 2pi/3, pi/4 per band). Divide by pi for the
+// outgoing radiance of a white Lambertian surface.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateIrradianceCubemap( const sh9& SH, const std::uint32_t Size, const format Format ) noexcept
+{
+    assert( Size >= 1 );
+
+    CreateBitmap( Size, Size, Format, 1, 1, true );
+    setColorSpace( color_space::LINEAR );
+
+    const xbitmap_details::texel_codec Codec( Format, false );
+    assert( Codec.m_nChannels >= 3 );
+
+    constexpr std::array<float, 9> Band{ xbitmap_details::pi_v
+                                       , 2.0f * xbitmap_details::pi_v / 3.0f, 2.0f * xbitmap_details::pi_v / 3.0f, 2.0f * xbitmap_details::pi_v / 3.0f
+                                       , xbitmap_details::pi_v / 4.0f, xbitmap_details::pi_v / 4.0f, xbitmap_details::pi_v / 4.0f, xbitmap_details::pi_v / 4.0f, xbitmap_details::pi_v / 4.0f };
+
+    xbitmap_details::ParallelFor( 6 * Size, 8, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        const auto         nC = static_cast<std::size_t>( Codec.m_nChannels );
+        std::vector<float> Row( std::size_t(Size) * nC );
+        for( auto iRow = Begin; iRow < End; ++iRow )
+        {
+            const int  iFace = static_cast<int>( iRow / Size );
+            const auto y     = iRow % Size;
+            for( std::uint32_t x = 0; x < Size; ++x )
+            {
+                const auto Y   = xbitmap_details::EvaluateSH9( xbitmap_details::Normalize( xbitmap_details::getCubeDirection( iFace, ( x + 0.5f ) / Size, ( y + 0.5f ) / Size ) ) );
+                auto       pOut = &Row[ x * nC ];
+                std::fill_n( pOut, nC, 1.0f );
+                for( std::size_t c = 0; c < nC; ++c )
+                {
+                    const auto Channel = Codec.m_Channels[c];
+                    if( Channel < 0 || Channel > 2 ) continue;
+
+                    float E = 0;
+                    for( int i = 0; i < 9; ++i ) E += Band[i] * SH[i][Channel] * Y[i];
+                    pOut[c] = std::max( 0.0f, E );
+                }
+            }
+            Codec.Encode( Row.data(), Size, &getMip<std::byte>( 0, iFace ).data()[ std::size_t(y) * Size * Codec.m_Info.m_BlockBytes ] );
+        }
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// INCREMENTAL MIPS
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Merges rectangles that overlap or touch until none do
+    //-------------------------------------------------------------------------------
+    static void CoalesceRects( std::vector<xbitmap::rect>& Rects ) noexcept
+    {
+        const auto Touch = []( const xbitmap::rect& A, const xbitmap::rect& B ) noexcept
+        {
+            return A.m_Left <= B.m_Right && B.m_Left <= A.m_Right && A.m_Top <= B.m_Bottom && B.m_Top <= A.m_Bottom;
+        };
+
+        std::erase_if( Rects, []( const xbitmap::rect& R ) noexcept { return R.m_Left >= R.m_Right || R.m_Top >= R.m_Bottom; } );
+
+        for( bool bMerged = true; bMerged; )
+        {
+            bMerged = false;
+            for( std::size_t i = 0; i < Rects.size(); ++i )
+            for( std::size_t j = i + 1; j < Rects.size(); ++j )
+            {
+                if( Touch( Rects[i], Rects[j] ) == false ) continue;
+
+                Rects[i] = { std::min( Rects[i].m_Left,   Rects[j].m_Left   ), std::min( Rects[i].m_Top,    Rects[j].m_Top    )
+                           , std::max( Rects[i].m_Right,  Rects[j].m_Right  ), std::max( Rects[i].m_Bottom, Rects[j].m_Bottom ) };
+                Rects.erase( Rects.begin() + j-- );
+                bMerged = true;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Range of destination texels that read from [Begin, End) of a source of Size
+    // texels (pairs when even, 3 taps at 2i when odd)
+    //-------------------------------------------------------------------------------
+    inline void getMipFootprint( std::uint32_t& Begin, std::uint32_t& End, const std::uint32_t Size ) noexcept
+    {
+        const auto DestSize = getMipDimension( Size, 1 );
+        Begin = ( Size & 1 ) && Size > 1 ? ( Begin > 0 ? ( Begin - 1 ) / 2 : 0 ) : Begin / 2;
+        End   = std::min( DestSize, ( End - 1 ) / 2 + 1 );
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Rebuilds the part of every lower mip that depends on the dirty rectangles of
+// mip 0 (all faces and frames). The rectangles are coalesced again at every level
+// since their footprints grow together as the mips shrink. Empty rectangles are
+// dropped, they have no footprint.
+//-------------------------------------------------------------------------------
+void xbitmap::RegenerateMips( const std::span<const rect> DirtyRects ) noexcept
+{
+    assert( isValid() );
+
+    std::vector<rect> Rects;
+    for( auto R : DirtyRects )
+    {
+        R.m_Right  = std::min( R.m_Right,  getWidth()  );
+        R.m_Bottom = std::min( R.m_Bottom, getHeight() );
+        if( R.m_Left < R.m_Right && R.m_Top < R.m_Bottom ) Rects.push_back( R );
+    }
+    if( Rects.empty() ) return;
+
+    for( int iMip = 1; iMip < getMipCount(); ++iMip )
+    {
+        for( auto& R : Rects )
+        {
+            xbitmap_details::getMipFootprint( R.m_Left, R.m_Right,  xbitmap_details::getMipDimension( getWidth(),  iMip - 1 ) );
+            xbitmap_details::getMipFootprint( R.m_Top,  R.m_Bottom, xbitmap_details::getMipDimension( getHeight(), iMip - 1 ) );
+        }
+        xbitmap_details::CoalesceRects( Rects );
+
+        for( const auto& R : Rects ) xbitmap_details::BoxFilterMip( *this, iMip, R );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+xbitmap_mip_updater::~xbitmap_mip_updater( void ) noexcept
+{
+    Wait();
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_mip_updater::MarkDirty( const xbitmap::rect& Rect ) noexcept
+{
+    m_Pending.push_back( Rect );
+    xbitmap_details::CoalesceRects( m_Pending );
+}
+
+//-------------------------------------------------------------------------------
+// Starts rebuilding everything marked so far. A rebuild still running is waited
+// for first, so the two never touch the bitmap at the same time.
+//-------------------------------------------------------------------------------
+void xbitmap_mip_updater::Flush( xbitmap& Bitmap ) noexcept
+{
+    Wait();
+    if( m_Pending.empty() ) return;
+
+    m_Work = std::async( std::launch::async, [ &Bitmap, Rects = std::move( m_Pending ) ]() noexcept
+    {
+        Bitmap.RegenerateMips( Rects );
+    });
+    m_Pending.clear();
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_mip_updater::Wait( void ) noexcept
+{
+    if( m_Work.valid() ) m_Work.get();
+}
+
+//-------------------------------------------------------------------------------
+
+bool xbitmap_mip_updater::isBusy( void ) const noexcept
+{
+    return m_Work.valid() && m_Work.wait_for( std::chrono::seconds(0) ) != std::future_status::ready;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ALPHA BLEEDING
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Exact nearest visible texel for every texel with a two pass Euclidean distance
+    // transform (Felzenszwalb), O(texels). The first pass finds the nearest visible
+    // texel of each column, sweeping whole rows over a band of columns so memory is
+    // read in order; the second runs the lower envelope of parabolas on every row.
+    //-------------------------------------------------------------------------------
+    static void BleedAlpha( std::span<std::uint32_t> Texels, const std::uint32_t Width, const std::uint32_t Height, const std::uint32_t AlphaMask ) noexcept
+    {
+        constexpr std::int32_t none_v = -1;
+        std::vector<std::int32_t> NearestY( Texels.size() );
+
+        ParallelFor( Width, 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( std::uint32_t y = 0; y < Height; ++y )
+            for( auto x = Begin; x < End; ++x )
+            {
+                const auto i = std::size_t(y) * Width + x;
+                NearestY[i] = ( Texels[i] & AlphaMask ) ? std::int32_t(y) : ( y ? NearestY[ i - Width ] : none_v );
+            }
+
+            for( auto y = std::int32_t(Height) - 2; y >= 0; --y )
+            for( auto x = Begin; x < End; ++x )
+            {
+                const auto i     = std::size_t(y) * Width + x;
+                const auto Below = NearestY[ i + Width ];
+                if( Below != none_v && ( NearestY[i] == none_v || Below - y < y - NearestY[i] ) ) NearestY[i] = Below;
+            }
+        });
+
+        ParallelFor( Height, 16, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<std::int32_t>   Sites( Width );
+            std::vector<float>          Bounds( Width + 1 );
+            std::vector<std::uint32_t>  Colors( Width );
+
+            for( auto y = Begin; y < End; ++y )
+            {
+                const auto pNearest = &NearestY[ std::size_t(y) * Width ];
+                const auto f        = [&]( const std::int32_t x ) noexcept { const float d = float( pNearest[x] - std::int32_t(y) ); return d * d; };
+
+                // Lower envelope of the parabolas of the columns that have a visible texel
+                int k = -1;
+                for( std::int32_t x = 0; x < std::int32_t(Width); ++x )
+                {
+                    if( pNearest[x] == none_v ) continue;
+
+                    float s = 0;
+                    while( k >= 0 )
+                    {
+                        const auto q = Sites[k];
+                        s = ( ( f(x) + float(x) * x ) - ( f(q) + float(q) * q ) ) / ( 2.0f * ( x - q ) );
+                        if( s > Bounds[k] ) break;
+                        --k;
+                    }
+
+                    ++k;
+                    Sites[k]      = x;
+                    Bounds[k]     = k ? s : -std::numeric_limits<float>::infinity();
+                    Bounds[k + 1] = std::numeric_limits<float>::infinity();
+                }
+
+                // Nothing visible in the whole bitmap
+                if( k < 0 ) return;
+
+                auto pRow = &Texels[ std::size_t(y) * Width ];
+                int  j    = 0;
+                for( std::uint32_t x = 0; x < Width; ++x )
+                {
+                    while( Bounds[ j + 1 ] < float(x) ) ++j;
+                    const auto Site = Sites[j];
+                    Colors[x] = Texels[ std::size_t( pNearest[Site] ) * Width + Site ];
+                }
+
+                // Only the invisible texels change, and they are never read
+                for( std::uint32_t x = 0; x < Width; ++x )
+                {
+                    if( ( pRow[x] & AlphaMask ) == 0 ) pRow[x] = ( Colors[x] & ~AlphaMask ) | ( pRow[x] & AlphaMask );
+                }
+            }
+        });
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::BleedAlpha( void ) noexcept
+{
+    assert( isValid() );
+
+    xbitmap_details::linear_scope Linear( *this );
+
+    std::array<int, 4> Channels;
+    const auto         nBytes = xbitmap_details::getByteChannels( getFormat(), Channels );
+    const auto         iAlpha = std::find( Channels.begin(), Channels.end(), 3 ) - Channels.begin();
+    assert( nBytes == 4 );
+    if( nBytes != 4 || iAlpha == 4 ) return;
+
+    const std::uint32_t AlphaMask = 0xffu << ( 8 * iAlpha );
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    for( int iFace  = 0; iFace  < getFaceCount();  ++iFace  )
+    for( int iMip   = 0; iMip   < getMipCount();   ++iMip   )
+    {
+        xbitmap_details::BleedAlpha( getMip<std::uint32_t>( iMip, iFace, iFrame )
+                                   , xbitmap_details::getMipDimension( getWidth(),  iMip )
+                                   , xbitmap_details::getMipDimension( getHeight(), iMip )
+                                   , AlphaMask );
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// RESIZE
+//////////////////////////////////////////////////////////////////////////////////
+
+//-------------------------------------------------------------------------------
+// Resamples mip 0 of every face and frame into Dest (a single mip, same format
+// and flags). Bitmaps with alpha that is not premultiplied are filtered with the
+// color weighted by alpha so transparent texels do not bleed into the result;
+// sRGB bitmaps are filtered in linear space.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateResizedBitmap( xbitmap& Dest, const std::uint32_t FinalWidth, const std::uint32_t FinalHeight, const mip_filter Filter ) const noexcept
+{
+    assert( isValid() );
+    assert( &Dest != this );
+    assert( FinalWidth >= 1 && FinalHeight >= 1 );
+    assert( Filter < mip_filter::ENUM_COUNT );
+
+    Dest.CreateBitmap( FinalWidth, FinalHeight, getFormat(), 1, getFrameCount(), isCubemap() );
+    Dest.m_Flags               = m_Flags;
+    Dest.m_Flags.m_bOwnsMemory = true;
+    Dest.m_ClampColor          = m_ClampColor;
+
+    const xbitmap_details::texel_codec Codec( getFormat(), getColorSpace() == color_space::SRGB );
+    const auto TapsX  = xbitmap_details::getCachedFilterTaps( Filter, getWidth(),  FinalWidth,  getUWrapMode() );
+    const auto TapsY  = xbitmap_details::getCachedFilterTaps( Filter, getHeight(), FinalHeight, getVWrapMode() );
+    const auto iAlpha = std::find( Codec.m_Channels.begin(), Codec.m_Channels.begin() + Codec.m_nChannels, 3 ) - Codec.m_Channels.begin();
+
+    xbitmap_details::resample_job Job{ Codec, *TapsX, *TapsY, {}, ( iAlpha < Codec.m_nChannels && m_Flags.m_bAlphaPremultiplied == false ) ? int(iAlpha) : -1, getLayout() };
+    Codec.DecodeColor( m_ClampColor, Job.m_Border.data() );
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    for( int iFace  = 0; iFace  < getFaceCount();  ++iFace  )
+    {
+        xbitmap_details::SeparableResample( Job, xbitmap_details::getLayoutView( *this, 0, iFace, iFrame ), Dest.getView( 0, iFace, iFrame ) );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Resize( const view& Dest, const const_view& Src, const mip_filter Filter, const color_space ColorSpace ) noexcept
+{
+    assert( Dest.m_Format == Src.m_Format );
+    assert( Dest.m_Width >= 1 && Dest.m_Height >= 1 && Src.m_Width >= 1 && Src.m_Height >= 1 );
+    assert( Filter < mip_filter::ENUM_COUNT );
+
+    const xbitmap_details::texel_codec Codec( Src.m_Format, ColorSpace == color_space::SRGB );
+    const auto TapsX  = xbitmap_details::getCachedFilterTaps( Filter, Src.m_Width,  Dest.m_Width,  wrap_mode::CLAMP_TO_EDGE );
+    const auto TapsY  = xbitmap_details::getCachedFilterTaps( Filter, Src.m_Height, Dest.m_Height, wrap_mode::CLAMP_TO_EDGE );
+    const auto iAlpha = std::find( Codec.m_Channels.begin(), Codec.m_Channels.begin() + Codec.m_nChannels, 3 ) - Codec.m_Channels.begin();
+
+    xbitmap_details::SeparableResample( { Codec, *TapsX, *TapsY, {}, iAlpha < Codec.m_nChannels ? int(iAlpha) : -1 }, Src, Dest );
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ROTATION
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Texel moved around as raw bytes, for sizes with no integer type and for the
+    // ones whose integer would need more than the 4 byte alignment of a mip
+    //-------------------------------------------------------------------------------
+    template< std::size_t T_SIZE >
+    struct texel_bytes
+    {
+        std::array<std::byte, T_SIZE>   m_Bytes;
+    };
+
+    //-------------------------------------------------------------------------------
+    // Calls Function with a value of a type as big as one texel
+    //-------------------------------------------------------------------------------
+    template< typename T_FUNCTION >
+    void DispatchTexelSize( const std::uint32_t Bytes, T_FUNCTION&& Function ) noexcept
+    {
+        switch( Bytes )
+        {
+        case 1:  Function( std::uint8_t{}     ); break;
+        case 2:  Function( std::uint16_t{}    ); break;
+        case 3:  Function( texel_bytes<3>{}   ); break;
+        case 4:  Function( std::uint32_t{}    ); break;
+        case 6:  Function( texel_bytes<6>{}   ); break;
+        case 8:  Function( texel_bytes<8>{}   ); break;
+        case 12: Function( texel_bytes<12>{}  ); break;
+        case 16: Function( texel_bytes<16>{}  ); break;
+        default: assert( false );
+        }
+    }
+
+    constexpr std::uint32_t s_TransposeTile = 16;                   // Texels per side of a tile, 16x16 4 byte texels is 1KB
+
+    //-------------------------------------------------------------------------------
+    // Dest(x, y) = Src( bFlipY ? DestH-1-y : y, bFlipX ? DestW-1-x : x ) for the
+    // tile rows [TileBegin, TileEnd). Src is DestH texels wide and DestW tall.
+    // Working one tile at a time keeps the source rows and destination rows of a
+    // tile in L1 instead of striding a whole column of the source per texel.
+    //-------------------------------------------------------------------------------
+    template< typename T >
+    void TransposeTiles( const T* pSrc, T* pDest, const std::uint32_t DestW, const std::uint32_t DestH, const bool bFlipX, const bool bFlipY, const std::uint32_t TileBegin, const std::uint32_t TileEnd ) noexcept
+    {
+        const auto SrcW = DestH;
+
+        for( std::uint32_t iTile = TileBegin; iTile < TileEnd; ++iTile )
+        for( std::uint32_t x0 = 0; x0 < DestW; x0 += s_TransposeTile )
+        {
+            const auto y0 = iTile * s_TransposeTile;
+            const auto y1 = std::min( y0 + s_TransposeTile, DestH );
+            const auto x1 = std::min( x0 + s_TransposeTile, DestW );
+
+#if XBITMAP_SSE2
+            if constexpr ( sizeof(T) == 4 )
+            {
+                if( y1 - y0 == s_TransposeTile && x1 - x0 == s_TransposeTile )
+                {
+                    // 4x4 blocks transposed in registers: four source rows in, four destination rows out
+                    for( auto y = y0; y < y1; y += 4 )
+                    for( auto x = x0; x < x1; x += 4 )
+                    {
+                        const auto SrcX = bFlipY ? DestH - 4 - y : y;
+                        __m128i    R[4];
+                        for( std::uint32_t k = 0; k < 4; ++k )
+                        {
+                            const auto SrcY = bFlipX ? DestW - 1 - ( x + k ) : x + k;
+                            R[k] = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pSrc[ SrcY * SrcW + SrcX ] ) );
+                        }
+
+                        const __m128i T0 = _mm_unpacklo_epi32( R[0], R[1] );
+                        const __m128i T1 = _mm_unpacklo_epi32( R[2], R[3] );
+                        const __m128i T2 = _mm_unpackhi_epi32( R[0], R[1] );
+                        const __m128i T3 = _mm_unpackhi_epi32( R[2], R[3] );
+                        const __m128i C[4] = { _mm_unpacklo_epi64( T0, T1 ), _mm_unpackhi_epi64( T0, T1 )
+                                             , _mm_unpacklo_epi64( T2, T3 ), _mm_unpackhi_epi64( T2, T3 ) };
+
+                        // C[j] holds source column SrcX + j
+                        for( std::uint32_t j = 0; j < 4; ++j )
+                        {
+                            const auto DestY = bFlipY ? y + 3 - j : y + j;
+                            _mm_storeu_si128( reinterpret_cast<__m128i*>( &pDest[ DestY * DestW + x ] ), C[j] );
+                        }
+                    }
+                    continue;
+                }
+            }
+#endif
+            for( auto y = y0; y < y1; ++y )
+            {
+                const auto SrcX = bFlipY ? DestH - 1 - y : y;
+                for( auto x = x0; x < x1; ++x )
+                {
+                    const auto SrcY = bFlipX ? DestW - 1 - x : x;
+                    pDest[ y * DestW + x ] = pSrc[ SrcY * SrcW + SrcX ];
+                }
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Dest(x, y) = Src( bFlipX ? W-1-x : x, bFlipY ? H-1-y : y ) for the rows [Begin, End)
+    //-------------------------------------------------------------------------------
+    template< typename T >
+    void FlipRows( const T* pSrc, T* pDest, const std::uint32_t W, const std::uint32_t H, const bool bFlipX, const bool bFlipY, const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        for( std::uint32_t y = Begin; y < End; ++y )
+        {
+            const T* pS = &pSrc[ ( bFlipY ? H - 1 - y : y ) * W ];
+            T*       pD = &pDest[ y * W ];
+
+            if( bFlipX == false )
+            {
+                std::memcpy( pD, pS, W * sizeof(T) );
+                continue;
+            }
+
+            std::uint32_t x = 0;
+#if XBITMAP_SSE2
+            if constexpr ( sizeof(T) == 4 )
+            {
+                for( ; x + 4 <= W; x += 4 )
+                {
+                    const __m128i V = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pS[ W - 4 - x ] ) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>( &pD[x] ), _mm_shuffle_epi32( V, _MM_SHUFFLE( 0, 1, 2, 3 ) ) );
+                }
+            }
+#endif
+            for( ; x < W; ++x ) pD[x] = pS[ W - 1 - x ];
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Both of the above for mips that are not row major, with the source and the
+    // destination addressed through the layout. Going over s_TransposeTile blocks
+    // of destination texels keeps the reads and writes within a few layout tiles
+    // (or Morton blocks) at a time.
+    //-------------------------------------------------------------------------------
+    template< typename T >
+    void ReorientLayoutTiles( const T* pSrc, T* pDest, const xbitmap::texel_layout Layout, const std::uint32_t SrcW, const std::uint32_t SrcH, const bool bTranspose, const bool bFlipX, const bool bFlipY, const std::uint32_t TileBegin, const std::uint32_t TileEnd ) noexcept
+    {
+        const auto DestW = bTranspose ? SrcH : SrcW;
+        const auto DestH = bTranspose ? SrcW : SrcH;
+
+        for( std::uint32_t iTile = TileBegin; iTile < TileEnd; ++iTile )
+        for( std::uint32_t x0 = 0; x0 < DestW; x0 += s_TransposeTile )
+        {
+            const auto y0 = iTile * s_TransposeTile;
+            const auto y1 = std::min( y0 + s_TransposeTile, DestH );
+            const auto x1 = std::min( x0 + s_TransposeTile, DestW );
+
+            for( auto y = y0; y < y1; ++y )
+            for( auto x = x0; x < x1; ++x )
+            {
+                const auto u = bFlipX ? DestW - 1 - x : x;
+                const auto v = bFlipY ? DestH - 1 - y : y;
+                pDest[ getTexelIndex( Layout, x, y, DestW, DestH ) ] = pSrc[ bTranspose ? getTexelIndex( Layout, v, u, SrcW, SrcH ) : getTexelIndex( Layout, u, v, SrcW, SrcH ) ];
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Rebuilds the bitmap with every mip, face and frame optionally transposed and
+    // then mirrored. Width, height and the wrap modes swap when transposing, the
+    // texel layout stays.
+    //-------------------------------------------------------------------------------
+    void Reorient( xbitmap& Bitmap, const bool bTranspose, const bool bFlipX, const bool bFlipY ) noexcept
+    {
+        assert( Bitmap.isValid() );
+
+        const auto  Layout = Bitmap.getLayout();
+        const auto& Info   = getFormatInfo( Bitmap.getFormat() );
+        assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+
+        xbitmap Final;
+        Final.CreateBitmap( bTranspose ? Bitmap.getHeight() : Bitmap.getWidth()
+                          , bTranspose ? Bitmap.getWidth()  : Bitmap.getHeight()
+                          , Bitmap.getFormat(), Bitmap.getMipCount(), Bitmap.getFrameCount(), Bitmap.isCubemap() );
+        Final.m_Flags               = Bitmap.m_Flags;
+        Final.m_Flags.m_bOwnsMemory = true;
+        Final.m_ClampColor          = Bitmap.m_ClampColor;
+        Final.m_Layout              = Layout;
+        if( bTranspose )
+        {
+            Final.setUWrapMode( Bitmap.getVWrapMode() );
+            Final.setVWrapMode( Bitmap.getUWrapMode() );
+        }
+
+        DispatchTexelSize( Info.m_BlockBytes, [&]< typename T >( const T ) noexcept
+        {
+            for( int iFrame = 0; iFrame < Bitmap.getFrameCount(); ++iFrame )
+            for( int iFace  = 0; iFace  < Bitmap.getFaceCount();  ++iFace  )
+            for( int iMip   = 0; iMip   < Bitmap.getMipCount();   ++iMip   )
+            {
+                const auto SrcW  = getMipDimension( Bitmap.getWidth(),  iMip );
+                const auto SrcH  = getMipDimension( Bitmap.getHeight(), iMip );
+                const T*   pSrc  = reinterpret_cast<const T*>( Bitmap.getMip<std::byte>( iMip, iFace, iFrame ).data() );
+                T*         pDest = reinterpret_cast<T*>( Final.getMip<std::byte>( iMip, iFace, iFrame ).data() );
+
+                if( Layout != xbitmap::texel_layout::LINEAR )
+                {
+                    ParallelFor( ( ( bTranspose ? SrcW : SrcH ) + s_TransposeTile - 1 ) / s_TransposeTile, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+                    {
+                        ReorientLayoutTiles( pSrc, pDest, Layout, SrcW, SrcH, bTranspose, bFlipX, bFlipY, Begin, End );
+                    });
+                }
+                else if( bTranspose )
+                {
+                    ParallelFor( ( SrcW + s_TransposeTile - 1 ) / s_TransposeTile, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+                    {
+                        TransposeTiles( pSrc, pDest, SrcH, SrcW, bFlipX, bFlipY, Begin, End );
+                    });
+                }
+                else
+                {
+                    ParallelFor( SrcH, 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+                    {
+                        FlipRows( pSrc, pDest, SrcW, SrcH, bFlipX, bFlipY, Begin, End );
+                    });
+                }
+            }
+        });
+
+        Bitmap.Kill();
+        Bitmap = std::move( Final );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Transpose( void ) noexcept
+{
+    xbitmap_details::Reorient( *this, true, false, false );
+}
+
+//-------------------------------------------------------------------------------
+// 90 is a transpose mirrored in X, 270 a transpose mirrored in Y, 180 mirrors both
+//-------------------------------------------------------------------------------
+void xbitmap::Rotate( const rotation Rotation ) noexcept
+{
+    assert( Rotation < rotation::ENUM_COUNT );
+
+    switch( Rotation )
+    {
+    case rotation::CW_90:  xbitmap_details::Reorient( *this, true,  true,  false ); break;
+    case rotation::CW_180: xbitmap_details::Reorient( *this, false, true,  true  ); break;
+    case rotation::CW_270: xbitmap_details::Reorient( *this, true,  false, true  ); break;
+    default:               break;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// BLIT
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Between two 32 bit xcolor formats every destination byte comes from one source
+    // byte, or is a constant when the source lacks the channel (alpha reads as 255)
+    //-------------------------------------------------------------------------------
+    struct byte_swizzle
+    {
+        std::array<int, 4>              m_Source;                   // Source byte of each destination byte, -1 for constant
+        std::array<std::uint8_t, 4>     m_Constant;
+        int                             m_iAlphaByte;               // Destination byte with alpha, -1 if none
+        int                             m_iSrcAlphaByte;            // Source byte with alpha, -1 if none
+    };
+
+    static byte_swizzle getByteSwizzle( const std::array<int, 4>& DestChannels, const std::array<int, 4>& SrcChannels ) noexcept
+    {
+        byte_swizzle Swizzle;
+        const auto pAlpha       = std::find( SrcChannels.begin(), SrcChannels.end(), 3 );
+        Swizzle.m_iAlphaByte    = -1;
+        Swizzle.m_iSrcAlphaByte = pAlpha == SrcChannels.end() ? -1 : int( pAlpha - SrcChannels.begin() );
+        for( int d = 0; d < 4; ++d )
+        {
+            const auto iChannel = DestChannels[d];
+            const auto pSource  = iChannel < 0 ? SrcChannels.end() : std::find( SrcChannels.begin(), SrcChannels.end(), iChannel );
+
+            Swizzle.m_Source[d]   = pSource == SrcChannels.end() ? -1 : int( pSource - SrcChannels.begin() );
+            Swizzle.m_Constant[d] = ( iChannel < 0 || iChannel == 3 ) ? 0xff : 0;
+            if( iChannel == 3 ) Swizzle.m_iAlphaByte = d;
+        }
+        return Swizzle;
+    }
+
+    //-------------------------------------------------------------------------------
+
+    static void SwizzleRow( const byte_swizzle& Swizzle, const std::uint32_t* pSrc, std::uint32_t* pDest, const std::uint32_t Count, const bool bPremultiply ) noexcept
+    {
+        std::uint32_t Constant = 0;
+        for( int d = 0; d < 4; ++d ) if( Swizzle.m_Source[d] < 0 ) Constant |= std::uint32_t( Swizzle.m_Constant[d] ) << ( 8 * d );
+
+        std::uint32_t i = 0;
+#if XBITMAP_SSE2
+        if( bPremultiply == false )
+        {
+            // Each destination byte is the source shifted into place and masked
+            for( ; i + 4 <= Count; i += 4 )
+            {
+                const auto V      = _mm_loadu_si128( reinterpret_cast<const __m128i*>( &pSrc[i] ) );
+                auto       Result = _mm_set1_epi32( static_cast<int>( Constant ) );
+                for( int d = 0; d < 4; ++d )
+                {
+                    const auto s = Swizzle.m_Source[d];
+                    if( s < 0 ) continue;
+
+                    const auto Moved = s > d ? _mm_srl_epi32( V, _mm_cvtsi32_si128( 8 * ( s - d ) ) )
+                                             : _mm_sll_epi32( V, _mm_cvtsi32_si128( 8 * ( d - s ) ) );
+                    Result = _mm_or_si128( Result, _mm_and_si128( Moved, _mm_set1_epi32( 0xff << ( 8 * d ) ) ) );
+                }
+                _mm_storeu_si128( reinterpret_cast<__m128i*>( &pDest[i] ), Result );
+            }
+        }
+#endif
+        for( ; i < Count; ++i )
+        {
+            const auto    V      = pSrc[i];
+            std::uint32_t Result = Constant;
+            for( int d = 0; d < 4; ++d )
+            {
+                if( Swizzle.m_Source[d] >= 0 ) Result |= ( ( V >> ( 8 * Swizzle.m_Source[d] ) ) & 0xff ) << ( 8 * d );
+            }
+
+            // Keyed on the source alpha like ConvertRow, the destination may have no alpha byte
+            if( bPremultiply && Swizzle.m_iSrcAlphaByte >= 0 )
+            {
+                const auto Alpha = ( V >> ( 8 * Swizzle.m_iSrcAlphaByte ) ) & 0xff;
+                for( int d = 0; d < 4; ++d )
+                {
+                    if( d == Swizzle.m_iAlphaByte || Swizzle.m_Source[d] < 0 ) continue;
+                    const auto Byte = xcolor::details::MulDiv255( ( Result >> ( 8 * d ) ) & 0xff, Alpha );
+                    Result = ( Result & ~( 0xffu << ( 8 * d ) ) ) | ( std::uint32_t( Byte ) << ( 8 * d ) );
+                }
+            }
+
+            pDest[i] = Result;
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Any other pair of formats: decode to RGBA floats, remap and encode
+    //-------------------------------------------------------------------------------
+    static void ConvertRow( const texel_codec& DestCodec, const texel_codec& SrcCodec, const std::byte* pSrc, std::byte* pDest, const std::uint32_t Count, const bool bPremultiply, std::vector<float>& Scratch ) noexcept
+    {
+        const auto nSrc  = static_cast<std::size_t>( SrcCodec.m_nChannels );
+        const auto nDest = static_cast<std::size_t>( DestCodec.m_nChannels );
+
+        Scratch.resize( std::size_t(Count) * ( nSrc + nDest ) );
+        float* pIn  = Scratch.data();
+        float* pOut = pIn + std::size_t(Count) * nSrc;
+
+        SrcCodec.Decode( pSrc, Count, pIn );
+        for( std::size_t i = 0; i < Count; ++i )
+        {
+            std::array<float, 4> RGBA{ 0, 0, 0, 1 };
+            for( std::size_t c = 0; c < nSrc; ++c ) if( SrcCodec.m_Channels[c] >= 0 ) RGBA[ SrcCodec.m_Channels[c] ] = pIn[ i * nSrc + c ];
+            if( bPremultiply ) for( int c = 0; c < 3; ++c ) RGBA[c] *= RGBA[3];
+            for( std::size_t c = 0; c < nDest; ++c ) pOut[ i * nDest + c ] = DestCodec.m_Channels[c] >= 0 ? RGBA[ DestCodec.m_Channels[c] ] : 1.0f;
+        }
+        DestCodec.Encode( pOut, Count, pDest );
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Rows are converted straight from the source into the destination, there is
+// no intermediate image. The values are converted as stored, no color space
+// change happens on the way.
+//-------------------------------------------------------------------------------
+void xbitmap::Blit( const view& Dest, const const_view& Src, const blit_options& Options ) noexcept
+{
+    assert( Dest.m_Width == Src.m_Width && Dest.m_Height == Src.m_Height );
+
+    std::array<int, 4> DestChannels, SrcChannels;
+    const bool bBytes = xbitmap_details::getByteChannels( Dest.m_Format, DestChannels ) == 4
+                     && xbitmap_details::getByteChannels( Src.m_Format,  SrcChannels  ) == 4;
+    const bool bCopy  = Dest.m_Format == Src.m_Format && Options.m_bPremultiplyAlpha == false;
+
+    const xbitmap_details::texel_codec DestCodec( Dest.m_Format, false );
+    const xbitmap_details::texel_codec SrcCodec ( Src.m_Format,  false );
+    const auto Swizzle  = xbitmap_details::getByteSwizzle( DestChannels, SrcChannels );
+    const auto RowBytes = std::size_t( Dest.m_Width ) * Dest.m_TexelSize;
+
+    xbitmap_details::ParallelFor( Dest.m_Height, std::max( 1u, ( 1u << 14 ) / std::max( 1u, Dest.m_Width ) ), [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        std::vector<float> Scratch;
+        for( auto y = Begin; y < End; ++y )
+        {
+            const auto pSrc  = Src.getRow( y ).data();
+            const auto pDest = Dest.getRow( Options.m_bFlipY ? Dest.m_Height - 1 - y : y ).data();
+
+            if( bCopy )       std::memcpy( pDest, pSrc, RowBytes );
+            else if( bBytes ) xbitmap_details::SwizzleRow( Swizzle, reinterpret_cast<const std::uint32_t*>( pSrc ), reinterpret_cast<std::uint32_t*>( pDest ), Dest.m_Width, Options.m_bPremultiplyAlpha );
+            else              xbitmap_details::ConvertRow( DestCodec, SrcCodec, pSrc, pDest, Dest.m_Width, Options.m_bPremultiplyAlpha, Scratch );
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap::Blit( xbitmap& Dest, const rect& DestRect, const xbitmap& Src, const rect& SrcRect, const blit_options& Options ) noexcept
+{
+    Blit( Dest.getView().getSubView( DestRect ), Src.getView().getSubView( SrcRect ), Options );
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// EQUIRECTANGULAR
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Texels and weights along one axis for a position given in texels (centers at
+    // +0.5). Bicubic uses Catmull-Rom.
+    //-------------------------------------------------------------------------------
+    struct sample_taps
+    {
+        int                     m_First;
+        int                     m_nTaps;
+        std::array<float, 4>    m_Weight;
+    };
+
+    inline sample_taps getSampleTaps( const float X, const xbitmap::sample_filter Filter ) noexcept
+    {
+        const float P = X - 0.5f;
+        const float F = std::floor( P );
+        const float t = P - F;
+
+        if( Filter == xbitmap::sample_filter::BILINEAR ) return { static_cast<int>( F ), 2, { 1 - t, t, 0, 0 } };
+
+        return { static_cast<int>( F ) - 1, 4, { ( ( -t + 2 ) * t - 1 ) * t * 0.5f
+                                              , ( ( 3 * t - 5 ) * t * t + 2 ) * 0.5f
+                                              , ( ( -3 * t + 4 ) * t + 1 ) * t * 0.5f
+                                              , ( t - 1 ) * t * t * 0.5f } };
+    }
+
+    //-------------------------------------------------------------------------------
+    // How many samples per axis a destination texel takes so a much bigger source
+    // does not alias, Ratio is source texels per destination texel
+    //-------------------------------------------------------------------------------
+    inline int getSuperSampleCount( const float Ratio ) noexcept
+    {
+        return std::clamp( static_cast<int>( std::ceil( Ratio - 0.001f ) ), 1, 4 );
+    }
+
+    //-------------------------------------------------------------------------------
+    // Filtered sample of an equirect mip, U wraps and V clamps. Texels are decoded
+    // as they are needed so huge sources are never expanded to floats.
+    //-------------------------------------------------------------------------------
+    static void SampleEquirect( const texel_codec& Codec, const std::byte* pData, const std::uint32_t W, const std::uint32_t H, const xbitmap::texel_layout Layout
+                              , const float U, const float V, const xbitmap::sample_filter Filter, float* pOut ) noexcept
+    {
+        const auto nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto TexelSize = static_cast<std::size_t>( Codec.m_Info.m_BlockBytes );
+        const auto Tx        = getSampleTaps( U * W, Filter );
+        const auto Ty        = getSampleTaps( V * H, Filter );
+
+        std::array<float, 4> Texel;
+        std::fill_n( pOut, nC, 0.0f );
+        for( int j = 0; j < Ty.m_nTaps; ++j )
+        {
+            const auto y = static_cast<std::size_t>( std::clamp( Ty.m_First + j, 0, int(H) - 1 ) );
+            for( int i = 0; i < Tx.m_nTaps; ++i )
+            {
+                const auto x = static_cast<std::size_t>( WrapCoordinate( Tx.m_First + i, int(W), xbitmap::wrap_mode::WRAP ) );
+                Codec.Decode( &pData[ getTexelIndex( Layout, std::uint32_t(x), std::uint32_t(y), W, H ) * TexelSize ], 1, Texel.data() );
+
+                const float Weight = Tx.m_Weight[i] * Ty.m_Weight[j];
+                for( std::size_t c = 0; c < nC; ++c ) pOut[c] += Texel[c] * Weight;
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Filtered sample of a cube map mip, the footprint continues on the
+    // neighbor faces so there are no seams
+    //-------------------------------------------------------------------------------
+    static void SampleCube( const texel_codec& Codec, const xbitmap& Cube, const int iFrame, const std::array<float, 3>& Dir
+                          , const xbitmap::sample_filter Filter, float* pOut ) noexcept
+    {
+        const auto nC        = static_cast<std::size_t>( Codec.m_nChannels );
+        const auto TexelSize = static_cast<std::size_t>( Codec.m_Info.m_BlockBytes );
+        const auto Size      = Cube.getWidth();
+
+        float U, V;
+        const int  iFace = getCubeFace( Dir, U, V );
+        const auto Tx    = getSampleTaps( U * Size, Filter );
+        const auto Ty    = getSampleTaps( V * Size, Filter );
+
+        std::array<float, 4> Texel;
+        std::fill_n( pOut, nC, 0.0f );
+        for( int j = 0; j < Ty.m_nTaps; ++j )
+        for( int i = 0; i < Tx.m_nTaps; ++i )
+        {
+            const auto T = getCubeTexel( iFace, Tx.m_First + i, Ty.m_First + j, Size );
+            Codec.Decode( &Cube.getMip<std::byte>( 0, T.m_iFace, iFrame )[ std::size_t( Cube.getTexelIndex( T.m_X, T.m_Y ) ) * TexelSize ], 1, Texel.data() );
+
+            const float Weight = Tx.m_Weight[i] * Ty.m_Weight[j];
+            for( std::size_t c = 0; c < nC; ++c ) pOut[c] += Texel[c] * Weight;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Each cube texel averages a grid of filtered samples when the equirect has more
+// texels than the face (up to 4x4). The equirect UV of every sub sample is
+// tabulated once per face size: the side faces are the +Z face turned a quarter
+// at a time (U moves by 0.25) and -Y is +Y upside down, so two faces are enough.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateCubemapFromEquirect( xbitmap& Dest, std::uint32_t FaceSize, const sample_filter Filter ) const noexcept
+{
+    assert( isValid() );
+    assert( &Dest != this );
+    assert( isCubemap() == false );
+    assert( Filter < sample_filter::ENUM_COUNT );
+
+    if( FaceSize == 0 ) FaceSize = std::max( 1u, getWidth() / 4 );
+
+    Dest.CreateBitmap( FaceSize, FaceSize, getFormat(), 1, getFrameCount(), true );
+    Dest.m_Flags               = m_Flags;
+    Dest.m_Flags.m_bOwnsMemory = true;
+    Dest.m_Flags.m_bCubeMap    = true;
+    Dest.m_ClampColor          = m_ClampColor;
+
+    const xbitmap_details::texel_codec Codec( getFormat(), getColorSpace() == color_space::SRGB );
+    const auto nC = static_cast<std::size_t>( Codec.m_nChannels );
+    const auto N  = xbitmap_details::getSuperSampleCount( ( getWidth() / 4.0f ) / FaceSize );
+
+    // Face coordinate of every sub sample, the same for rows and columns
+    const auto         M = static_cast<std::uint32_t>( FaceSize * N );
+    std::vector<float> Coord( M );
+    for( std::size_t i = 0; i < Coord.size(); ++i ) Coord[i] = ( i + 0.5f ) / M;
+
+    // Equirect UV of every sub sample of the +Z and +Y faces
+    std::vector<std::array<float, 2>> SideUV( std::size_t(M) * M ), PoleUV( SideUV.size() );
+    xbitmap_details::ParallelFor( M, 16, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        for( auto y = Begin; y < End; ++y )
+        for( std::uint32_t x = 0; x < M; ++x )
+        {
+            auto& Side = SideUV[ std::size_t(y) * M + x ];
+            auto& Pole = PoleUV[ std::size_t(y) * M + x ];
+            xbitmap_details::getEquirectUV( xbitmap_details::getCubeDirection( 4, Coord[x], Coord[y] ), Side[0], Side[1] );
+            xbitmap_details::getEquirectUV( xbitmap_details::getCubeDirection( 2, Coord[x], Coord[y] ), Pole[0], Pole[1] );
+        }
+    });
+    constexpr std::array<float, 6> FaceTurn{ 0.25f, 0.75f, 0, 0, 0, 0.5f };
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    {
+        const auto pSrc = getMip<std::byte>( 0, 0, iFrame ).data();
+
+        xbitmap_details::ParallelFor( 6 * FaceSize, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<float>   Row( std::size_t(FaceSize) * nC );
+            std::array<float, 4> Sample;
+            for( auto iRow = Begin; iRow < End; ++iRow )
+            {
+                const int  iFace = static_cast<int>( iRow / FaceSize );
+                const auto y     = iRow % FaceSize;
+                const auto& UVs  = ( iFace == 2 || iFace == 3 ) ? PoleUV : SideUV;
+                std::fill( Row.begin(), Row.end(), 0.0f );
+
+                for( std::uint32_t x = 0; x < FaceSize; ++x )
+                {
+                    auto pOut = &Row[ x * nC ];
+                    for( int j = 0; j < N; ++j )
+                    for( int i = 0; i < N; ++i )
+                    {
+                        // -Y reads the row of +Y mirrored in V
+                        const auto  sY = iFace == 3 ? M - 1 - ( y * N + j ) : y * N + j;
+                        const auto& UV = UVs[ std::size_t(sY) * M + x * N + i ];
+                        const float U  = UV[0] + FaceTurn[iFace] - ( UV[0] + FaceTurn[iFace] >= 1.0f ? 1.0f : 0.0f );
+                        const float V  = iFace == 3 ? 1.0f - UV[1] : UV[1];
+                        xbitmap_details::SampleEquirect( Codec, pSrc, getWidth(), getHeight(), getLayout(), U, V, Filter, Sample.data() );
+                        for( std::size_t c = 0; c < nC; ++c ) pOut[c] += Sample[c];
+                    }
+                    for( std::size_t c = 0; c < nC; ++c ) pOut[c] = std::max( 0.0f, pOut[c] / float( N * N ) );
+                }
+
+                Codec.Encode( Row.data(), FaceSize, Dest.getView( 0, iFace, iFrame ).getRow( y ).data() );
+            }
+        });
+    }
+}
+
+//-------------------------------------------------------------------------------
+// The direction of every sub sample comes from sin/cos tables of its column and
+// row, so no trigonometry runs per texel.
+//-------------------------------------------------------------------------------
+void xbitmap::CreateEquirectFromCubemap( xbitmap& Dest, std::uint32_t Width, const sample_filter Filter ) const noexcept
+{
+    assert( isValid() );
+    assert( &Dest != this );
+    assert( isCubemap() && getWidth() == getHeight() );
+    assert( Filter < sample_filter::ENUM_COUNT );
+
+    if( Width == 0 ) Width = 4 * getWidth();
+    const auto Height = std::max( 1u, Width / 2 );
+
+    Dest.CreateBitmap( Width, Height, getFormat(), 1, getFrameCount(), false );
+    Dest.m_Flags               = m_Flags;
+    Dest.m_Flags.m_bOwnsMemory = true;
+    Dest.m_Flags.m_bCubeMap    = false;
+    Dest.m_ClampColor          = m_ClampColor;
+    Dest.setUWrapMode( wrap_mode::WRAP );
+
+    const xbitmap_details::texel_codec Codec( getFormat(), getColorSpace() == color_space::SRGB );
+    const auto nC = static_cast<std::size_t>( Codec.m_nChannels );
+    const auto N  = xbitmap_details::getSuperSampleCount( ( 4.0f * getWidth() ) / Width );
+
+    // Longitude and latitude of every sub sample
+    std::vector<float> SinPhi( std::size_t(Width) * N ), CosPhi( SinPhi.size() ), SinTheta( std::size_t(Height) * N ), CosTheta( SinTheta.size() );
+    for( std::size_t i = 0; i < SinPhi.size(); ++i )
+    {
+        const float Phi = ( ( i + 0.5f ) / SinPhi.size() - 0.5f ) * 2.0f * xbitmap_details::pi_v;
+        SinPhi[i] = std::sin( Phi );
+        CosPhi[i] = std::cos( Phi );
+    }
+    for( std::size_t i = 0; i < SinTheta.size(); ++i )
+    {
+        const float Theta = ( i + 0.5f ) / SinTheta.size() * xbitmap_details::pi_v;
+        SinTheta[i] = std::sin( Theta );
+        CosTheta[i] = std::cos( Theta );
+    }
+
+    for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+    {
+        const auto DestView = Dest.getView( 0, 0, iFrame );
+
+        xbitmap_details::ParallelFor( Height, 4, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            std::vector<float>   Row( std::size_t(Width) * nC );
+            std::array<float, 4> Sample;
+            for( auto y = Begin; y < End; ++y )
+            {
+                std::fill( Row.begin(), Row.end(), 0.0f );
+                for( std::uint32_t x = 0; x < Width; ++x )
+                {
+                    auto pOut = &Row[ x * nC ];
+                    for( int j = 0; j < N; ++j )
+                    for( int i = 0; i < N; ++i )
+                    {
+                        const auto iX = x * N + i;
+                        const auto iY = y * N + j;
+                        xbitmap_details::SampleCube( Codec, *this, iFrame, { SinTheta[iY] * SinPhi[iX], CosTheta[iY], SinTheta[iY] * CosPhi[iX] }, Filter, Sample.data() );
+                        for( std::size_t c = 0; c < nC; ++c ) pOut[c] += Sample[c];
+                    }
+                    for( std::size_t c = 0; c < nC; ++c ) pOut[c] = std::max( 0.0f, pOut[c] / float( N * N ) );
+                }
+
+                Codec.Encode( Row.data(), Width, DestView.getRow( y ).data() );
+            }
+        });
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// ATLAS
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Skyline bottom-left packer. The skyline is a list of segments, each the top of
+    // what has been placed below it; a rectangle goes where its top ends lowest.
+    //-------------------------------------------------------------------------------
+    class skyline_packer
+    {
+    public:
+
+        skyline_packer( const std::uint32_t Width, const std::uint32_t Height ) noexcept
+            : m_Width { Width }
+            , m_Height{ Height }
+            , m_Nodes { { 0, 0, Width } }
+        {}
+
+        //-------------------------------------------------------------------------------
+
+        bool Insert( const std::uint32_t W, const std::uint32_t H, std::uint32_t& X, std::uint32_t& Y ) noexcept
+        {
+            std::size_t   iBest     = m_Nodes.size();
+            std::uint32_t BestTop   = ~0u;
+            std::uint32_t BestWidth = ~0u;
+
+            for( std::size_t i = 0; i < m_Nodes.size(); ++i )
+            {
+                std::uint32_t Top;
+                if( Fit( i, W, H, Top ) == false ) continue;
+                if( Top + H < BestTop || ( Top + H == BestTop && m_Nodes[i].m_Width < BestWidth ) )
+                {
+                    iBest     = i;
+                    BestTop   = Top + H;
+                    BestWidth = m_Nodes[i].m_Width;
+                    Y         = Top;
+                }
+            }
+
+            if( iBest == m_Nodes.size() ) return false;
+
+            X = m_Nodes[iBest].m_X;
+            m_Nodes.insert( m_Nodes.begin() + iBest, node{ X, Y + H, W } );
+
+            // The new segment hides whatever it covers of the following ones
+            for( auto i = iBest + 1; i < m_Nodes.size(); )
+            {
+                auto&      Node  = m_Nodes[i];
+                const auto Right = X + W;
+                if( Node.m_X >= Right ) break;
+
+                const auto Shrink = Right - Node.m_X;
+                if( Shrink < Node.m_Width )
+                {
+                    Node.m_X     += Shrink;
+                    Node.m_Width -= Shrink;
+                    break;
+                }
+                m_Nodes.erase( m_Nodes.begin() + i );
+            }
+
+            for( std::size_t i = 0; i + 1 < m_Nodes.size(); )
+            {
+                if( m_Nodes[i].m_Y == m_Nodes[i + 1].m_Y )
+                {
+                    m_Nodes[i].m_Width += m_Nodes[i + 1].m_Width;
+                    m_Nodes.erase( m_Nodes.begin() + i + 1 );
+                }
+                else ++i;
+            }
+
+            return true;
+        }
+
+    private:
+
+        struct node
+        {
+            std::uint32_t   m_X;
+            std::uint32_t   m_Y;
+            std::uint32_t   m_Width;
+        };
+
+        //-------------------------------------------------------------------------------
+        // Lowest height a W x H rectangle can sit at starting at node iNode
+        //-------------------------------------------------------------------------------
+        bool Fit( std::size_t iNode, const std::uint32_t W, const std::uint32_t H, std::uint32_t& Top ) const noexcept
+        {
+            if( m_Nodes[iNode].m_X + W > m_Width ) return false;
+
+            Top = 0;
+            for( std::uint32_t Left = W; Left > 0; ++iNode )
+            {
+                const auto& Node = m_Nodes[iNode];
+                Top = std::max( Top, Node.m_Y );
+                if( Top + H > m_Height ) return false;
+                Left -= std::min( Left, Node.m_Width );
+            }
+            return true;
+        }
+
+        std::uint32_t       m_Width;
+        std::uint32_t       m_Height;
+        std::vector<node>   m_Nodes;
+    };
+}
+
+//-------------------------------------------------------------------------------
+// Sources go in tallest first. The atlas starts as the smallest power of two that
+// could hold them all and doubles its shorter side until everything fits. The
+// gutter and alignment padding of each entry repeat its edges following the
+// source wrap modes (or its clamp color), so mips and bilinear filtering do not
+// pick up the neighbors. A gutter of G texels protects about log2(G)+1 mips.
+//-------------------------------------------------------------------------------
+xerr xbitmap::CreateAtlas( xbitmap& Dest, const std::span<atlas_entry> Entries, const std::span<const xbitmap> Sources, const atlas_settings& Settings ) noexcept
+{
+    assert( Entries.size() == Sources.size() );
+    assert( Settings.m_Alignment >= 1 );
+
+    const auto& Info = xbitmap_details::getFormatInfo( Settings.m_Format );
+    assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+
+    const auto Align = [&]( const std::uint32_t V ) noexcept { return ( V + Settings.m_Alignment - 1 ) / Settings.m_Alignment * Settings.m_Alignment; };
+
+    // Slots are the entries with their gutters, rounded up to the alignment
+    std::vector<std::uint32_t>  Order( Sources.size() );
+    std::vector<rect>           Slots( Sources.size() );
+    std::uint64_t               Area    = 0;
+    std::uint32_t               MaxSide = 1;
+    for( std::uint32_t i = 0; i < Sources.size(); ++i )
+    {
+        assert( Sources[i].isValid() );
+        Order[i] = i;
+        Slots[i] = { 0, 0, Align( Sources[i].getWidth() + 2 * Settings.m_Gutter ), Align( Sources[i].getHeight() + 2 * Settings.m_Gutter ) };
+        Area    += std::uint64_t( Slots[i].m_Right ) * Slots[i].m_Bottom;
+        MaxSide  = std::max( { MaxSide, Slots[i].m_Right, Slots[i].m_Bottom } );
+    }
+
+    std::sort( Order.begin(), Order.end(), [&]( const std::uint32_t A, const std::uint32_t B ) noexcept
+    {
+        return Slots[A].m_Bottom != Slots[B].m_Bottom ? Slots[A].m_Bottom > Slots[B].m_Bottom : Slots[A].m_Right > Slots[B].m_Right;
+    });
+
+    std::uint32_t Width  = std::bit_ceil( std::max( MaxSide, static_cast<std::uint32_t>( std::ceil( std::sqrt( double( Area ) ) ) ) ) );
+    std::uint32_t Height = Width;
+    for( ;; )
+    {
+        if( Width > Settings.m_MaxSize || Height > Settings.m_MaxSize )
+            return xerr::create_f<xerr::default_states, "The atlas entries do not fit in the maximum size">();
+
+        xbitmap_details::skyline_packer Packer( Width, Height );
+        bool                            bFit = true;
+        for( const auto i : Order )
+        {
+            auto& Slot = Slots[i];
+            const auto W = Slot.m_Right - Slot.m_Left, H = Slot.m_Bottom - Slot.m_Top;
+            if( ( bFit = Packer.Insert( W, H, Slot.m_Left, Slot.m_Top ) ) == false ) break;
+            Slot.m_Right  = Slot.m_Left + W;
+            Slot.m_Bottom = Slot.m_Top  + H;
+        }
+        if( bFit ) break;
+
+        for( auto& Slot : Slots ) Slot = { 0, 0, Slot.m_Right - Slot.m_Left, Slot.m_Bottom - Slot.m_Top };
+        if( Width <= Height ) Width  *= 2;
+        else                  Height *= 2;
+    }
+
+    Dest.CreateBitmap( Width, Height, Settings.m_Format );
+    Dest.setColorSpace( Sources.empty() ? color_space::SRGB : Sources[0].getColorSpace() );
+    std::memset( Dest.getMip<std::byte>( 0 ).data(), 0, Dest.getMipSize( 0 ) );
+
+    const xbitmap_details::texel_codec Codec( Settings.m_Format, false );
+    const auto                         DestView = Dest.getView();
+
+    xbitmap_details::ParallelFor( static_cast<std::uint32_t>( Sources.size() ), 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        for( auto i = Begin; i < End; ++i )
+        {
+            xbitmap     Temp;
+            const auto& Src   = xbitmap_details::AsLinear( Sources[i], Temp );
+            const auto& Slot  = Slots[i];
+            const auto  Image = rect{ Slot.m_Left + Settings.m_Gutter, Slot.m_Top + Settings.m_Gutter
+                                    , Slot.m_Left + Settings.m_Gutter + Src.getWidth(), Slot.m_Top + Settings.m_Gutter + Src.getHeight() };
+
+            Blit( DestView.getSubView( Image ), Src.getView(), {} );
+
+            // The clamp color as one texel of the atlas format
+            std::array<float, 4>        Clamp;
+            std::array<std::byte, 16>   ClampTexel;
+            Codec.DecodeColor( Src.m_ClampColor, Clamp.data() );
+            Codec.Encode( Clamp.data(), 1, ClampTexel.data() );
+
+            // Gutter texels copy the already converted texel their wrapped coordinate lands on
+            for( auto y = Slot.m_Top; y < Slot.m_Bottom; ++y )
+            {
+                const auto Row = DestView.getRow( y );
+                const int  SrcY = xbitmap_details::WrapCoordinate( int(y) - int(Image.m_Top), int(Src.getHeight()), Src.getVWrapMode() );
+                for( auto x = Slot.m_Left; x < Slot.m_Right; ++x )
+                {
+                    if( x >= Image.m_Left && x < Image.m_Right && y >= Image.m_Top && y < Image.m_Bottom ) continue;
+
+                    const int  SrcX = xbitmap_details::WrapCoordinate( int(x) - int(Image.m_Left), int(Src.getWidth()), Src.getUWrapMode() );
+                    const auto pTexel = ( SrcX < 0 || SrcY < 0 ) ? ClampTexel.data() : DestView.getRow( Image.m_Top + SrcY ).data() + ( Image.m_Left + SrcX ) * Info.m_BlockBytes;
+                    std::memcpy( &Row[ std::size_t(x) * Info.m_BlockBytes ], pTexel, Info.m_BlockBytes );
+                }
+            }
+
+            Entries[i].m_Rect = Image;
+            Entries[i].m_UV   = { float( Image.m_Left ) / Width, float( Image.m_Top ) / Height, float( Image.m_Right ) / Width, float( Image.m_Bottom ) / Height };
+        }
+    });
+
+    if( Settings.m_nMips != 1 ) Dest.GenerateMips( Settings.m_nMips );
+    return {};
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// TEXEL LAYOUT
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Moves the texels of a W x H mip between row major (pLinear) and a tiled or
+    // Morton layout (pOther). Tiles move one tile row at a time with a copy per
+    // texel row of a tile. Morton moves 2x2 quads, which are four consecutive
+    // texels of the curve (one SSE2 store for 4 byte texels).
+    //-------------------------------------------------------------------------------
+    template< typename T >
+    void ConvertLayout( T* pLinear, T* pOther, const xbitmap::texel_layout Layout, const std::uint32_t W, const std::uint32_t H, const bool bToLinear ) noexcept
+    {
+        const auto Move = [&]( T* pL, T* pO, const std::uint32_t Count ) noexcept
+        {
+            if( bToLinear ) std::copy_n( pO, Count, pL );
+            else            std::copy_n( pL, Count, pO );
+        };
+
+        if( Layout == xbitmap::texel_layout::MORTON )
+        {
+            // A single row or column is already in Morton order
+            if( W == 1 || H == 1 ) return Move( pLinear, pOther, W * H );
+
+            ParallelFor( H / 2, 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto y = 2 * Begin; y < 2 * End; y += 2 )
+                for( std::uint32_t x = 0; x < W; x += 2 )
+                {
+                    T*         pRow0 = &pLinear[ std::size_t(y) * W + x ];
+                    T*         pRow1 = pRow0 + W;
+                    T*         pQuad = &pOther[ getTexelIndex( Layout, x, y, W, H ) ];
+#if XBITMAP_SSE2
+                    if constexpr ( sizeof(T) == 4 )
+                    {
+                        if( bToLinear )
+                        {
+                            const __m128i Q = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pQuad ) );
+                            _mm_storel_epi64( reinterpret_cast<__m128i*>( pRow0 ), Q );
+                            _mm_storel_epi64( reinterpret_cast<__m128i*>( pRow1 ), _mm_srli_si128( Q, 8 ) );
+                        }
+                        else
+                        {
+                            _mm_storeu_si128( reinterpret_cast<__m128i*>( pQuad ), _mm_unpacklo_epi64( _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pRow0 ) )
+                                                                                                   , _mm_loadl_epi64( reinterpret_cast<const __m128i*>( pRow1 ) ) ) );
+                        }
+                        continue;
+                    }
+#endif
+                    Move( pRow0, pQuad,     2 );
+                    Move( pRow1, pQuad + 2, 2 );
+                }
+            });
+            return;
+        }
+
+        const std::uint32_t Tile = Layout == xbitmap::texel_layout::TILED_4X4 ? 4 : 8;
+        ParallelFor( ( H + Tile - 1 ) / Tile, 16, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( auto iTileRow = Begin; iTileRow < End; ++iTileRow )
+            {
+                const auto Y0 = iTileRow * Tile;
+                const auto TH = std::min( Tile, H - Y0 );
+                for( std::uint32_t X0 = 0; X0 < W; X0 += Tile )
+                {
+                    const auto TW    = std::min( Tile, W - X0 );
+                    T*         pTile = &pOther[ std::size_t(Y0) * W + std::size_t(X0) * TH ];
+                    for( std::uint32_t r = 0; r < TH; ++r ) Move( &pLinear[ std::size_t( Y0 + r ) * W + X0 ], &pTile[ r * TW ], TW );
+                }
+            }
+        });
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Going between two non linear layouts passes through row major
+//-------------------------------------------------------------------------------
+void xbitmap::setLayout( const texel_layout Layout ) noexcept
+{
+    assert( isValid() );
+    assert( Layout < texel_layout::ENUM_COUNT );
+    if( Layout == m_Layout ) return;
+
+    const auto& Info = xbitmap_details::getFormatInfo( getFormat() );
+    assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+    assert( Layout != texel_layout::MORTON || isPowerOfTwo() );
+
+    xbitmap_details::DispatchTexelSize( Info.m_BlockBytes, [&]< typename T >( const T ) noexcept
+    {
+        std::vector<T> Linear;
+        for( int iFrame = 0; iFrame < getFrameCount(); ++iFrame )
+        for( int iFace  = 0; iFace  < getFaceCount();  ++iFace  )
+        for( int iMip   = 0; iMip   < getMipCount();   ++iMip   )
+        {
+            const auto W     = xbitmap_details::getMipDimension( getWidth(),  iMip );
+            const auto H     = xbitmap_details::getMipDimension( getHeight(), iMip );
+            T*         pMip  = reinterpret_cast<T*>( getMip<std::byte>( iMip, iFace, iFrame ).data() );
+
+            Linear.resize( std::size_t(W) * H );
+            if( m_Layout == texel_layout::LINEAR ) std::copy_n( pMip, Linear.size(), Linear.data() );
+            else                                   xbitmap_details::ConvertLayout( Linear.data(), pMip, m_Layout, W, H, true );
+
+            if( Layout == texel_layout::LINEAR )   std::copy_n( Linear.data(), Linear.size(), pMip );
+            else                                   xbitmap_details::ConvertLayout( Linear.data(), pMip, Layout, W, H, false );
+        }
+    });
+
+    m_Layout = Layout;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// STAGING
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    constexpr std::uint64_t AlignUp( const std::uint64_t Value, const std::uint32_t Alignment ) noexcept
+    {
+        return ( Value + Alignment - 1 ) / Alignment * Alignment;
+    }
+
+    //-------------------------------------------------------------------------------
+    // Fills the subresources and total size from the description part of the layout
+    //-------------------------------------------------------------------------------
+    inline void BuildStagingLayout( xbitmap::staging_layout& Layout ) noexcept
+    {
+        assert( Layout.m_RowPitchAlignment > 0 && Layout.m_OffsetAlignment > 0 );
+
+        const auto& Info = getFormatInfo( Layout.m_Format );
+        assert( Info.m_BlockBytes );
+
+        Layout.m_Subresources.clear();
+        Layout.m_Subresources.reserve( std::size_t( Layout.m_nFrames ) * Layout.m_nFaces * Layout.m_nMips );
+
+        std::uint64_t Offset = 0;
+        for( int iFrame = 0; iFrame < Layout.m_nFrames; ++iFrame )
+        for( int iFace  = 0; iFace  < Layout.m_nFaces;  ++iFace  )
+        for( int iMip   = 0; iMip   < Layout.m_nMips;   ++iMip   )
+        {
+            auto& Sub = Layout.m_Subresources.emplace_back();
+            Sub.m_Width     = getMipDimension( Layout.m_Width,  iMip );
+            Sub.m_Height    = getMipDimension( Layout.m_Height, iMip );
+            Sub.m_RowSize   = ( Sub.m_Width  + Info.m_BlockWidth  - 1 ) / Info.m_BlockWidth * Info.m_BlockBytes;
+            Sub.m_nRows     = ( Sub.m_Height + Info.m_BlockHeight - 1 ) / Info.m_BlockHeight;
+            Sub.m_RowPitch  = static_cast<std::uint32_t>( AlignUp( Sub.m_RowSize, Layout.m_RowPitchAlignment ) );
+            Sub.m_Offset    = AlignUp( Offset, Layout.m_OffsetAlignment );
+            Offset          = Sub.m_Offset + std::uint64_t( Sub.m_RowPitch ) * ( Sub.m_nRows - 1 ) + Sub.m_RowSize;
+        }
+
+        Layout.m_TotalSize = Offset;
+    }
+}
+
+//-------------------------------------------------------------------------------
+// The last row of every subresource is not padded, which is what D3D12 and
+// Vulkan expect from the size of a copy.
+//-------------------------------------------------------------------------------
+xbitmap::staging_layout xbitmap::getStagingLayout( const std::uint32_t RowPitchAlignment, const std::uint32_t OffsetAlignment ) const noexcept
+{
+    assert( isValid() );
+
+    staging_layout Layout;
+    Layout.m_RowPitchAlignment  = RowPitchAlignment;
+    Layout.m_OffsetAlignment    = OffsetAlignment;
+    Layout.m_Width              = getWidth();
+    Layout.m_Height             = getHeight();
+    Layout.m_Format             = getFormat();
+    Layout.m_ColorSpace         = getColorSpace();
+    Layout.m_nMips              = getMipCount();
+    Layout.m_nFaces             = getFaceCount();
+    Layout.m_nFrames            = getFrameCount();
+    xbitmap_details::BuildStagingLayout( Layout );
+    return Layout;
+}
+
+//-------------------------------------------------------------------------------
+// Rows of all the subresources are numbered one after the other and spread
+// across the threads, so a single large mip does not serialize the copy.
+//-------------------------------------------------------------------------------
+void xbitmap::WriteStaging( std::span<std::byte> Dest, const staging_layout& Layout ) const noexcept
+{
+    assert( isValid() );
+    assert( Dest.size() >= Layout.m_TotalSize );
+    assert( Layout.m_Format  == getFormat()    );
+    assert( Layout.m_Width   == getWidth()     );
+    assert( Layout.m_Height  == getHeight()    );
+    assert( Layout.m_nMips   == getMipCount()  );
+    assert( Layout.m_nFaces  == getFaceCount() );
+    assert( Layout.m_nFrames == getFrameCount() );
+
+    if( getLayout() != texel_layout::LINEAR )
+    {
+        xbitmap Linear;
+        return xbitmap_details::AsLinear( *this, Linear ).WriteStaging( Dest, Layout );
+    }
+
+    std::vector<std::uint32_t> FirstRow( Layout.m_Subresources.size() + 1 );
+    for( std::size_t i = 0; i < Layout.m_Subresources.size(); ++i ) FirstRow[i + 1] = FirstRow[i] + Layout.m_Subresources[i].m_nRows;
+
+    xbitmap_details::ParallelFor( FirstRow.back(), 64, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+    {
+        auto        iSub = static_cast<int>( std::upper_bound( FirstRow.begin(), FirstRow.end(), Begin ) - FirstRow.begin() ) - 1;
+        auto        Row  = Begin;
+        while( Row < End )
+        {
+            const auto&         Sub     = Layout.m_Subresources[iSub];
+            const auto          iMip    = iSub % Layout.m_nMips;
+            const auto          iFace   = ( iSub / Layout.m_nMips ) % Layout.m_nFaces;
+            const auto          iFrame  = iSub / ( Layout.m_nMips * Layout.m_nFaces );
+            const std::byte*    pSrc    = getMip<std::byte>( iMip, iFace, iFrame ).data();
+            const auto          Last    = std::min( End, FirstRow[iSub + 1] );
+
+            for( ; Row < Last; ++Row )
+            {
+                const auto r = Row - FirstRow[iSub];
+                std::memcpy( &Dest[ Sub.m_Offset + std::uint64_t( r ) * Sub.m_RowPitch ], &pSrc[ std::size_t( r ) * Sub.m_RowSize ], Sub.m_RowSize );
+            }
+            ++iSub;
+        }
+    });
+}
+
+//-------------------------------------------------------------------------------
+
+xerr xbitmap::SaveStaging( const std::wstring_view FileName, const std::uint32_t RowPitchAlignment, const std::uint32_t OffsetAlignment ) const noexcept
+{
+    const auto             Layout = getStagingLayout( RowPitchAlignment, OffsetAlignment );
+    std::vector<std::byte> Data( Layout.m_TotalSize );
+    WriteStaging( Data, Layout );
+
+    FILE* fp;
+    if( auto Err = _wfopen_s( &fp, std::wstring(FileName).c_str(), L"wb" ); Err )
+    {
+        xbitmap_details::HandleError( FileName, Err );
+        return xerr::create_f<xerr::default_states, "Fail to open file">();
+    }
+
+    static constexpr std::uint32_t Signature('XBST');
+
+    if( false
+        || (1 != fwrite(&Signature,                     sizeof(std::uint32_t),                  1, fp))
+        || (1 != fwrite(&Layout.m_Width,                sizeof(Layout.m_Width),                 1, fp))
+        || (1 != fwrite(&Layout.m_Height,               sizeof(Layout.m_Height),                1, fp))
+        || (1 != fwrite(&Layout.m_Format,               sizeof(Layout.m_Format),                1, fp))
+        || (1 != fwrite(&Layout.m_ColorSpace,           sizeof(Layout.m_ColorSpace),            1, fp))
+        || (1 != fwrite(&Layout.m_nMips,                sizeof(Layout.m_nMips),                 1, fp))
+        || (1 != fwrite(&Layout.m_nFaces,               sizeof(Layout.m_nFaces),                1, fp))
+        || (1 != fwrite(&Layout.m_nFrames,              sizeof(Layout.m_nFrames),               1, fp))
+        || (1 != fwrite(&Layout.m_RowPitchAlignment,    sizeof(Layout.m_RowPitchAlignment),     1, fp))
+        || (1 != fwrite(&Layout.m_OffsetAlignment,      sizeof(Layout.m_OffsetAlignment),       1, fp))
+        || (1 != fwrite(&Layout.m_TotalSize,            sizeof(Layout.m_TotalSize),             1, fp))
+        || (1 != fwrite(Data.data(),                    Data.size(),                            1, fp))
+        )
+    {
+        fclose(fp);
+        xbitmap_details::HandleError( FileName, errno );
+        return xerr::create_f<xerr::default_states, "Fail to write data to file">();
+    }
+
+    fclose(fp);
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+
+xerr xbitmap::LoadStaging( const std::wstring_view FileName, staging_layout& Layout, std::vector<std::byte>& Data ) noexcept
+{
+    FILE* fp;
+    if( auto Err = _wfopen_s( &fp, std::wstring(FileName).c_str(), L"rb" ); Err )
+    {
+        xbitmap_details::HandleError( FileName, Err );
+        return xerr::create_f<xerr::default_states, "Fail to open file">();
+    }
+
+    std::uint32_t Signature;
+    std::uint64_t TotalSize;
+    if( false
+        || (1 != fread(&Signature,                      sizeof(Signature),                      1, fp))
+        || (1 != fread(&Layout.m_Width,                 sizeof(Layout.m_Width),                 1, fp))
+        || (1 != fread(&Layout.m_Height,                sizeof(Layout.m_Height),                1, fp))
+        || (1 != fread(&Layout.m_Format,                sizeof(Layout.m_Format),                1, fp))
+        || (1 != fread(&Layout.m_ColorSpace,            sizeof(Layout.m_ColorSpace),            1, fp))
+        || (1 != fread(&Layout.m_nMips,                 sizeof(Layout.m_nMips),                 1, fp))
+        || (1 != fread(&Layout.m_nFaces,                sizeof(Layout.m_nFaces),                1, fp))
+        || (1 != fread(&Layout.m_nFrames,               sizeof(Layout.m_nFrames),               1, fp))
+        || (1 != fread(&Layout.m_RowPitchAlignment,     sizeof(Layout.m_RowPitchAlignment),     1, fp))
+        || (1 != fread(&Layout.m_OffsetAlignment,       sizeof(Layout.m_OffsetAlignment),       1, fp))
+        || (1 != fread(&TotalSize,                      sizeof(TotalSize),                      1, fp))
+        )
+    {
+        fclose(fp);
+        xbitmap_details::HandleError( FileName, errno );
+        return xerr::create_f<xerr::default_states, "Fail to read in file">();
+    }
+
+    if( Signature != std::uint32_t('XBST') )
+    {
+        fclose(fp);
+        return xerr::create_f<xerr::default_states, "Wrong file signature">();
+    }
+
+    if( false
+        || Layout.m_Format >= format::ENUM_COUNT || 0 == xbitmap_details::getFormatInfo( Layout.m_Format ).m_BlockBytes
+        || Layout.m_Width == 0 || Layout.m_Height == 0
+        || Layout.m_nMips < 1  || Layout.m_nMips > 32 || ( Layout.m_nFaces != 1 && Layout.m_nFaces != 6 ) || Layout.m_nFrames < 1
+        || Layout.m_RowPitchAlignment == 0 || Layout.m_OffsetAlignment == 0
+        )
+    {
+        fclose(fp);
+        return xerr::create_f<xerr::default_states, "Corrupted staging file header">();
+    }
+
+    xbitmap_details::BuildStagingLayout( Layout );
+    if( Layout.m_TotalSize != TotalSize )
+    {
+        fclose(fp);
+        return xerr::create_f<xerr::default_states, "Corrupted staging file header">();
+    }
+
+    Data.resize( TotalSize );
+    if( 1 != fread( Data.data(), Data.size(), 1, fp ) )
+    {
+        fclose(fp);
+        xbitmap_details::HandleError( FileName, errno );
+        return xerr::create_f<xerr::default_states, "Fail to read data in file">();
+    }
+
+    fclose(fp);
+    return {};
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// TILED BITMAPS
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    // Source texels per axis a resampled chunk of a tile reads at most (a bit more for the filter support)
+    constexpr std::uint32_t tiled_window_v = 2048;
+
+    //-------------------------------------------------------------------------------
+    // Taps of the destination texels [Begin, End) of a whole axis, re-based to the
+    // first source texel they read. First and Count return the source window.
+    //-------------------------------------------------------------------------------
+    inline filter_taps SliceFilterTaps( const filter_taps& Taps, const std::uint32_t Begin, const std::uint32_t End, std::uint32_t& First, std::uint32_t& Count ) noexcept
+    {
+        const auto iBegin = std::size_t(Begin) * Taps.m_nTaps;
+        const auto iEnd   = std::size_t(End)   * Taps.m_nTaps;
+        const auto [Lo, Hi] = std::minmax_element( Taps.m_Index.begin() + iBegin, Taps.m_Index.begin() + iEnd );
+        assert( *Lo >= 0 );
+
+        First = static_cast<std::uint32_t>( *Lo );
+        Count = static_cast<std::uint32_t>( *Hi - *Lo + 1 );
+
+        filter_taps Slice;
+        Slice.m_nTaps = Taps.m_nTaps;
+        Slice.m_Weight.assign( Taps.m_Weight.begin() + iBegin, Taps.m_Weight.begin() + iEnd );
+        Slice.m_Index.resize( iEnd - iBegin );
+        for( std::size_t i = 0; i < Slice.m_Index.size(); ++i ) Slice.m_Index[i] = Taps.m_Index[ iBegin + i ] - *Lo;
+        return Slice;
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+xbitmap_tiled::~xbitmap_tiled( void ) noexcept
+{
+    Kill();
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::Kill( void ) noexcept
+{
+    for( auto& Level : m_Levels ) CloseLevel( Level );
+    m_Levels.clear();
+    m_TileSize   = 0;
+    m_Format     = xbitmap::format::INVALID;
+    m_ColorSpace = xbitmap::color_space::SRGB;
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::AddLevel( const std::uint32_t Width, const std::uint32_t Height ) noexcept
+{
+    auto& Level = m_Levels.emplace_back();
+    Level.m_Width   = Width;
+    Level.m_Height  = Height;
+    Level.m_nTilesX = ( Width  + m_TileSize - 1 ) / m_TileSize;
+    Level.m_nTilesY = ( Height + m_TileSize - 1 ) / m_TileSize;
+    Level.m_Tiles.resize( std::size_t(Level.m_nTilesX) * Level.m_nTilesY );
+    Level.m_State = std::make_unique<std::atomic<tile_state>[]>( Level.m_Tiles.size() );
+}
+
+//-------------------------------------------------------------------------------
+// Frees the tile, the next getTile creates or reads it again
+//-------------------------------------------------------------------------------
+void xbitmap_tiled::ReleaseTile( level& Level, const std::size_t iTile ) const noexcept
+{
+    assert( Level.m_State[iTile] != tile_state::LOADING );
+    Level.m_Tiles[iTile].Kill();
+    Level.m_State[iTile] = tile_state::EMPTY;
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::CloseLevel( level& Level ) const noexcept
+{
+    for( auto pFile : Level.m_Handles ) fclose( pFile );
+    Level.m_Handles.clear();
+
+    if( Level.m_bSpilled )
+    {
+        std::error_code Error;
+        std::filesystem::remove( std::filesystem::path( Level.m_FileName ), Error );
+        Level.m_bSpilled = false;
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Makes a new file in the spill directory, the name is unique to this process and
+// the file is only created if it does not exist yet
+//-------------------------------------------------------------------------------
+std::FILE* xbitmap_tiled::CreateSpillFile( std::wstring& FileName ) const noexcept
+{
+    static std::atomic<std::uint32_t> s_Count{ 0 };
+
+    std::error_code             Error;
+    const std::filesystem::path Directory = m_SpillPath.empty() ? std::filesystem::temp_directory_path( Error ) : std::filesystem::path( m_SpillPath );
+    if( Error ) return nullptr;
+
+    for( int i = 0; i < 64; ++i )
+    {
+        FileName = ( Directory / ( L"xbitmap_spill_" + std::to_wstring( reinterpret_cast<std::uintptr_t>( this ) ) + L"_" + std::to_wstring( s_Count++ ) + L".tmp" ) ).wstring();
+
+        std::FILE* pFile;
+        if( 0 == _wfopen_s( &pFile, FileName.c_str(), L"wbx" ) ) return pFile;
+    }
+
+    FileName.clear();
+    return nullptr;
+}
+
+//-------------------------------------------------------------------------------
+// Appends a finished row of tiles to the spill file and frees them. Rows are
+// written top to bottom, which is the order getTileFileOffset expects.
+//-------------------------------------------------------------------------------
+xerr xbitmap_tiled::SpillTileRow( level& Level, const std::uint32_t TileY, std::FILE* pFile ) const noexcept
+{
+    for( std::uint32_t TileX = 0; TileX < Level.m_nTilesX; ++TileX )
+    {
+        const auto iTile = std::size_t(TileY) * Level.m_nTilesX + TileX;
+        const auto Data  = Level.m_Tiles[iTile].getMip<std::byte>( 0 );
+        assert( Level.m_Tiles[iTile].isValid() );
+
+        if( 1 != fwrite( Data.data(), Data.size(), 1, pFile ) ) return xerr::create_f<xerr::default_states, "Fail to write to the spill file">();
+        ReleaseTile( Level, iTile );
+    }
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+// Nothing is allocated until the tiles are touched
+//-------------------------------------------------------------------------------
+void xbitmap_tiled::Create( const std::uint32_t Width, const std::uint32_t Height, const xbitmap::format Format, const std::uint32_t TileSize, const xbitmap::color_space ColorSpace ) noexcept
+{
+    assert( Width >= 1 && Height >= 1 );
+    assert( TileSize >= 1 && TileSize <= 0xffff );
+
+    [[maybe_unused]] const auto& Info = xbitmap_details::getFormatInfo( Format );
+    assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+    assert( std::uint64_t( TileSize ) * TileSize * Info.m_BlockBytes <= 0xffffffff );   // A tile is an xbitmap, its face size is a u32
+
+    Kill();
+    m_TileSize   = TileSize;
+    m_Format     = Format;
+    m_ColorSpace = ColorSpace;
+    AddLevel( Width, Height );
+}
+
+//-------------------------------------------------------------------------------
+
+xbitmap::rect xbitmap_tiled::getTileRect( const std::uint32_t TileX, const std::uint32_t TileY, const int iLevel ) const noexcept
+{
+    const auto& Level = m_Levels[iLevel];
+    assert( TileX < Level.m_nTilesX && TileY < Level.m_nTilesY );
+
+    const auto Left = TileX * m_TileSize;
+    const auto Top  = TileY * m_TileSize;
+    return { Left, Top, Left + std::min( m_TileSize, Level.m_Width - Left ), Top + std::min( m_TileSize, Level.m_Height - Top ) };
+}
+
+//-------------------------------------------------------------------------------
+// Tiles are stored one after the other in row major order, so every full row of
+// tiles above takes Width * TileSize texels
+//-------------------------------------------------------------------------------
+std::uint64_t xbitmap_tiled::getTileFileOffset( const std::uint32_t TileX, const std::uint32_t TileY, const int iLevel ) const noexcept
+{
+    const auto& Level     = m_Levels[iLevel];
+    const auto  Rect      = getTileRect( TileX, TileY, iLevel );
+    const auto  TexelSize = xbitmap_details::getFormatInfo( m_Format ).m_BlockBytes;
+    return Level.m_FileOffset + ( std::uint64_t(Rect.m_Top) * Level.m_Width + std::uint64_t(Rect.m_Left) * ( Rect.m_Bottom - Rect.m_Top ) ) * TexelSize;
+}
+
+//-------------------------------------------------------------------------------
+// The first thread to claim an empty tile creates it and reads it, the others
+// that want the same tile wait for it. Different tiles load at the same time,
+// each read uses its own file handle taken from the pool of the level, the lock
+// is only held to take and return the handle.
+//-------------------------------------------------------------------------------
+xbitmap& xbitmap_tiled::getTile( const std::uint32_t TileX, const std::uint32_t TileY, const int iLevel ) const noexcept
+{
+    auto&      Level = m_Levels[iLevel];
+    const auto iTile = std::size_t(TileY) * Level.m_nTilesX + TileX;
+    auto&      Tile  = Level.m_Tiles[iTile];
+    auto&      State = Level.m_State[iTile];
+
+    if( auto Expected = tile_state::EMPTY; State.compare_exchange_strong( Expected, tile_state::LOADING, std::memory_order_acquire ) == false )
+    {
+        for( ; Expected == tile_state::LOADING; Expected = State.load( std::memory_order_acquire ) ) State.wait( tile_state::LOADING, std::memory_order_acquire );
+        return Tile;
+    }
+
+    const auto Rect = getTileRect( TileX, TileY, iLevel );
+    Tile.CreateBitmap( Rect.m_Right - Rect.m_Left, Rect.m_Bottom - Rect.m_Top, m_Format );
+    Tile.setColorSpace( m_ColorSpace );
+
+    if( Level.m_FileName.empty() == false )
+    {
+        std::FILE* pFile = nullptr;
+        {
+            std::scoped_lock Lock( m_Mutex );
+            if( Level.m_Handles.empty() == false )
+            {
+                pFile = Level.m_Handles.back();
+                Level.m_Handles.pop_back();
+            }
+        }
+        if( pFile == nullptr && _wfopen_s( &pFile, Level.m_FileName.c_str(), L"rb" ) ) pFile = nullptr;
+
+        auto Data = Tile.getMip<std::byte>( 0 );
+        if( pFile == nullptr || _fseeki64( pFile, static_cast<std::int64_t>( getTileFileOffset( TileX, TileY, iLevel ) ), SEEK_SET ) || 1 != fread( Data.data(), Data.size(), 1, pFile ) )
+        {
+            std::memset( Data.data(), 0, Data.size() );
+            xerr::LogMessage<xerr::default_states::FAILURE>( std::format( "Fail to read tile {}x{} of level {}", TileX, TileY, iLevel ) );
+        }
+
+        if( pFile )
+        {
+            std::scoped_lock Lock( m_Mutex );
+            Level.m_Handles.push_back( pFile );
+        }
+    }
+
+    State.store( tile_state::RESIDENT, std::memory_order_release );
+    State.notify_all();
+    return Tile;
+}
+
+//-------------------------------------------------------------------------------
+
+bool xbitmap_tiled::isResident( const std::uint32_t TileX, const std::uint32_t TileY, const int iLevel ) const noexcept
+{
+    const auto& Level = m_Levels[iLevel];
+    return Level.m_State[ std::size_t(TileY) * Level.m_nTilesX + TileX ].load( std::memory_order_acquire ) == tile_state::RESIDENT;
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::Evict( const std::uint32_t TileX, const std::uint32_t TileY, const int iLevel ) noexcept
+{
+    auto& Level = m_Levels[iLevel];
+    ReleaseTile( Level, std::size_t(TileY) * Level.m_nTilesX + TileX );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::ReadRegion( const xbitmap::rect& Rect, const xbitmap::view& Dest, const int iLevel ) const noexcept
+{
+    assert( Dest.m_Format == m_Format );
+    assert( Rect.m_Right  <= getWidth( iLevel )  && Rect.m_Right  - Rect.m_Left == Dest.m_Width );
+    assert( Rect.m_Bottom <= getHeight( iLevel ) && Rect.m_Bottom - Rect.m_Top  == Dest.m_Height );
+    if( Rect.m_Left == Rect.m_Right || Rect.m_Top == Rect.m_Bottom ) return;
+
+    for( auto TileY = Rect.m_Top  / m_TileSize; TileY <= ( Rect.m_Bottom - 1 ) / m_TileSize; ++TileY )
+    for( auto TileX = Rect.m_Left / m_TileSize; TileX <= ( Rect.m_Right  - 1 ) / m_TileSize; ++TileX )
+    {
+        const auto          TileRect = getTileRect( TileX, TileY, iLevel );
+        const xbitmap::rect Overlap  { std::max( Rect.m_Left, TileRect.m_Left  ), std::max( Rect.m_Top,    TileRect.m_Top    )
+                                     , std::min( Rect.m_Right, TileRect.m_Right ), std::min( Rect.m_Bottom, TileRect.m_Bottom ) };
+        const xbitmap&      Tile     = getTile( TileX, TileY, iLevel );
+        const auto          Src      = Tile.getView().getSubView( { Overlap.m_Left - TileRect.m_Left, Overlap.m_Top - TileRect.m_Top, Overlap.m_Right - TileRect.m_Left, Overlap.m_Bottom - TileRect.m_Top } );
+        const auto          Out      = Dest.getSubView( { Overlap.m_Left - Rect.m_Left, Overlap.m_Top - Rect.m_Top, Overlap.m_Right - Rect.m_Left, Overlap.m_Bottom - Rect.m_Top } );
+
+        for( std::uint32_t y = 0; y < Src.m_Height; ++y ) std::memcpy( Out.getRow( y ).data(), Src.getRow( y ).data(), std::size_t( Src.m_Width ) * Src.m_TexelSize );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_tiled::WriteRegion( const xbitmap::rect& Rect, const xbitmap::const_view& Src, const int iLevel ) noexcept
+{
+    assert( Src.m_Format == m_Format );
+    assert( Rect.m_Right  <= getWidth( iLevel )  && Rect.m_Right  - Rect.m_Left == Src.m_Width );
+    assert( Rect.m_Bottom <= getHeight( iLevel ) && Rect.m_Bottom - Rect.m_Top  == Src.m_Height );
+    if( Rect.m_Left == Rect.m_Right || Rect.m_Top == Rect.m_Bottom ) return;
+
+    for( auto TileY = Rect.m_Top  / m_TileSize; TileY <= ( Rect.m_Bottom - 1 ) / m_TileSize; ++TileY )
+    for( auto TileX = Rect.m_Left / m_TileSize; TileX <= ( Rect.m_Right  - 1 ) / m_TileSize; ++TileX )
+    {
+        const auto          TileRect = getTileRect( TileX, TileY, iLevel );
+        const xbitmap::rect Overlap  { std::max( Rect.m_Left, TileRect.m_Left  ), std::max( Rect.m_Top,    TileRect.m_Top    )
+                                     , std::min( Rect.m_Right, TileRect.m_Right ), std::min( Rect.m_Bottom, TileRect.m_Bottom ) };
+        const auto          Out      = getTile( TileX, TileY, iLevel ).getView().getSubView( { Overlap.m_Left - TileRect.m_Left, Overlap.m_Top - TileRect.m_Top, Overlap.m_Right - TileRect.m_Left, Overlap.m_Bottom - TileRect.m_Top } );
+        const auto          In       = Src.getSubView( { Overlap.m_Left - Rect.m_Left, Overlap.m_Top - Rect.m_Top, Overlap.m_Right - Rect.m_Left, Overlap.m_Bottom - Rect.m_Top } );
+
+        for( std::uint32_t y = 0; y < In.m_Height; ++y ) std::memcpy( Out.getRow( y ).data(), In.getRow( y ).data(), std::size_t( In.m_Width ) * In.m_TexelSize );
+    }
+}
+
+//-------------------------------------------------------------------------------
+// Levels backed by a file are converted one row of tiles at a time into a new
+// spill file, tiles read for it are evicted again right after. Nothing changes
+// until all of those are written. Levels only in memory are then converted tile
+// by tile, untouched tiles stay zero.
+//-------------------------------------------------------------------------------
+xerr xbitmap_tiled::Convert( const xbitmap::format Format ) noexcept
+{
+    [[maybe_unused]] const auto& Info = xbitmap_details::getFormatInfo( Format );
+    assert( Info.m_BlockWidth == 1 && Info.m_BlockHeight == 1 && Info.m_BlockBytes );
+    if( Format == m_Format ) return {};
+
+    const auto ConvertTile = [&]( xbitmap& New, const xbitmap& Tile ) noexcept
+    {
+        New.CreateBitmap( Tile.getWidth(), Tile.getHeight(), Format );
+        New.setColorSpace( m_ColorSpace );
+        xbitmap::Blit( New.getView(), Tile.getView(), {} );
+    };
+
+    std::vector<std::wstring> SpillNames( m_Levels.size() );
+    const auto                Cancel = [&]( std::FILE* pSpill ) noexcept
+    {
+        if( pSpill ) fclose( pSpill );
+        for( const auto& Name : SpillNames )
+        {
+            std::error_code Error;
+            if( Name.empty() == false ) std::filesystem::remove( std::filesystem::path( Name ), Error );
+        }
+    };
+
+    for( int iLevel = 0; iLevel < getLevelCount(); ++iLevel )
+    {
+        auto& Level = m_Levels[iLevel];
+        if( Level.m_FileName.empty() ) continue;
+
+        std::FILE* pSpill = CreateSpillFile( SpillNames[iLevel] );
+        if( pSpill == nullptr )
+        {
+            Cancel( nullptr );
+            return xerr::create_f<xerr::default_states, "Fail to create the spill file">();
+        }
+
+        std::vector<xbitmap> Row( Level.m_nTilesX );
+        for( std::uint32_t TileY = 0; TileY < Level.m_nTilesY; ++TileY )
+        {
+            xbitmap_details::ParallelFor( Level.m_nTilesX, 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+            {
+                for( auto TileX = Begin; TileX < End; ++TileX )
+                {
+                    const bool bResident = isResident( TileX, TileY, iLevel );
+                    ConvertTile( Row[TileX], getTile( TileX, TileY, iLevel ) );
+                    if( bResident == false ) ReleaseTile( Level, std::size_t(TileY) * Level.m_nTilesX + TileX );
+                }
+            });
+
+            for( const auto& Tile : Row )
+            {
+                const auto Data = Tile.getMip<std::byte>( 0 );
+                if( 1 != fwrite( Data.data(), Data.size(), 1, pSpill ) )
+                {
+                    Cancel( pSpill );
+                    return xerr::create_f<xerr::default_states, "Fail to write to the spill file">();
+                }
+            }
+        }
+
+        if( fclose( pSpill ) )
+        {
+            Cancel( nullptr );
+            return xerr::create_f<xerr::default_states, "Fail to write to the spill file">();
+        }
+    }
+
+    for( int iLevel = 0; iLevel < getLevelCount(); ++iLevel )
+    {
+        auto& Level = m_Levels[iLevel];
+
+        // Resident tiles were written converted as well
+        if( SpillNames[iLevel].empty() == false )
+        {
+            CloseLevel( Level );
+            for( std::size_t i = 0; i < Level.m_Tiles.size(); ++i ) ReleaseTile( Level, i );
+            Level.m_FileName   = std::move( SpillNames[iLevel] );
+            Level.m_FileOffset = 0;
+            Level.m_bSpilled   = true;
+            continue;
+        }
+
+        xbitmap_details::ParallelFor( static_cast<std::uint32_t>( Level.m_Tiles.size() ), 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            for( auto i = Begin; i < End; ++i )
+            {
+                if( isResident( i % Level.m_nTilesX, i / Level.m_nTilesX, iLevel ) == false ) continue;
+
+                xbitmap New;
+                ConvertTile( New, Level.m_Tiles[i] );
+                Level.m_Tiles[i].Kill();
+                Level.m_Tiles[i] = std::move( New );
+            }
+        });
+    }
+
+    m_Format = Format;
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+// Resamples level iSrcLevel of Src into level iDestLevel of this one, one row of
+// destination tiles at a time with the tiles of the row in parallel. Each tile is
+// filtered in chunks that read at most about tiled_window_v source texels per
+// axis, taps are taken from the whole axis so there are no seams between tiles.
+// Source tiles read from a file that were not resident before are evicted once
+// the rows below do not need them. Every finished row of destination tiles goes
+// to a spill file, so only about a row of each level is in memory at a time.
+//-------------------------------------------------------------------------------
+xerr xbitmap_tiled::ResampleLevel( const xbitmap_tiled& Src, const int iSrcLevel, const int iDestLevel, const xbitmap::mip_filter Filter ) noexcept
+{
+    assert( Src.m_Format == m_Format );
+    assert( Filter < xbitmap::mip_filter::ENUM_COUNT );
+
+    auto&        DestLevel = m_Levels[iDestLevel];
+    std::wstring SpillName;
+    std::FILE*   pSpill    = CreateSpillFile( SpillName );
+    if( pSpill == nullptr ) return xerr::create_f<xerr::default_states, "Fail to create the spill file">();
+
+    auto&       SrcLevel  = Src.m_Levels[iSrcLevel];
+    const auto  SrcW      = SrcLevel.m_Width;
+    const auto  SrcH      = SrcLevel.m_Height;
+    const auto  DestW     = getWidth( iDestLevel );
+    const auto  DestH     = getHeight( iDestLevel );
+    const auto  TapsX     = xbitmap_details::BuildFilterTaps( Filter, SrcW, DestW, xbitmap::wrap_mode::CLAMP_TO_EDGE );
+    const auto  TapsY     = xbitmap_details::BuildFilterTaps( Filter, SrcH, DestH, xbitmap::wrap_mode::CLAMP_TO_EDGE );
+    const auto  ChunkW    = static_cast<std::uint32_t>( std::clamp<std::uint64_t>( std::uint64_t( xbitmap_details::tiled_window_v ) * DestW / SrcW, 1, m_TileSize ) );
+    const auto  ChunkH    = static_cast<std::uint32_t>( std::clamp<std::uint64_t>( std::uint64_t( xbitmap_details::tiled_window_v ) * DestH / SrcH, 1, m_TileSize ) );
+
+    const xbitmap_details::texel_codec Codec( m_Format, m_ColorSpace == xbitmap::color_space::SRGB );
+    const auto  iAlpha    = std::find( Codec.m_Channels.begin(), Codec.m_Channels.begin() + Codec.m_nChannels, 3 ) - Codec.m_Channels.begin();
+
+    // Source tiles that can be read again from the file and were not around before
+    std::vector<bool> Evictable( SrcLevel.m_Tiles.size(), false );
+    if( SrcLevel.m_FileName.empty() == false )
+    {
+        for( std::size_t i = 0; i < Evictable.size(); ++i ) Evictable[i] = Src.isResident( static_cast<std::uint32_t>( i % SrcLevel.m_nTilesX ), static_cast<std::uint32_t>( i / SrcLevel.m_nTilesX ), iSrcLevel ) == false;
+    }
+    std::uint32_t nEvictedRows = 0;
+
+    for( std::uint32_t TileY = 0; TileY < getTileCountY( iDestLevel ); ++TileY )
+    {
+        xbitmap_details::ParallelFor( getTileCountX( iDestLevel ), 1, [&]( const std::uint32_t Begin, const std::uint32_t End ) noexcept
+        {
+            xbitmap Window;
+            for( auto TileX = Begin; TileX < End; ++TileX )
+            {
+                const auto Rect = getTileRect( TileX, TileY, iDestLevel );
+                auto&      Tile = getTile( TileX, TileY, iDestLevel );
+
+                for( auto Y0 = Rect.m_Top;  Y0 < Rect.m_Bottom; Y0 += ChunkH )
+                for( auto X0 = Rect.m_Left; X0 < Rect.m_Right;  X0 += ChunkW )
+                {
+                    const auto    X1 = std::min( Rect.m_Right,  X0 + ChunkW );
+                    const auto    Y1 = std::min( Rect.m_Bottom, Y0 + ChunkH );
+                    std::uint32_t SX, SY, SW, SH;
+                    const auto    LocalX = xbitmap_details::SliceFilterTaps( TapsX, X0, X1, SX, SW );
+                    const auto    LocalY = xbitmap_details::SliceFilterTaps( TapsY, Y0, Y1, SY, SH );
+
+                    Window.CreateBitmap( SW, SH, m_Format );
+                    Src.ReadRegion( { SX, SY, SX + SW, SY + SH }, Window.getView(), iSrcLevel );
+                    xbitmap_details::SeparableResample( { Codec, LocalX, LocalY, {}, iAlpha < Codec.m_nChannels ? int(iAlpha) : -1 }
+                                                      , Window.getView()
+                                                      , Tile.getView().getSubView( { X0 - Rect.m_Left, Y0 - Rect.m_Top, X1 - Rect.m_Left, Y1 - Rect.m_Top } ) );
+                }
+            }
+        });
+
+        if( auto Err = SpillTileRow( DestLevel, TileY, pSpill ); Err )
+        {
+            fclose( pSpill );
+            std::error_code Error;
+            std::filesystem::remove( std::filesystem::path( SpillName ), Error );
+            return Err;
+        }
+
+        // Drop the source tile rows that are above everything the next row reads
+        if( SrcLevel.m_FileName.empty() == false )
+        {
+            std::uint32_t NextTop = SrcH, Count;
+            if( ( TileY + 1 ) * m_TileSize < DestH ) xbitmap_details::SliceFilterTaps( TapsY, ( TileY + 1 ) * m_TileSize, ( TileY + 1 ) * m_TileSize + 1, NextTop, Count );
+
+            for( ; nEvictedRows < SrcLevel.m_nTilesY && std::min<std::uint64_t>( ( nEvictedRows + 1 ) * std::uint64_t( Src.m_TileSize ), SrcH ) <= NextTop; ++nEvictedRows )
+            for( std::uint32_t x = 0; x < SrcLevel.m_nTilesX; ++x )
+            {
+                const auto i = std::size_t( nEvictedRows ) * SrcLevel.m_nTilesX + x;
+                if( Evictable[i] ) Src.ReleaseTile( SrcLevel, i );
+            }
+        }
+    }
+
+    // The level reads its tiles back from the spill file from now on
+    const bool bClosed = 0 == fclose( pSpill );
+    DestLevel.m_FileName   = SpillName;
+    DestLevel.m_FileOffset = 0;
+    DestLevel.m_bSpilled   = true;
+    if( bClosed == false ) return xerr::create_f<xerr::default_states, "Fail to write to the spill file">();
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+
+xerr xbitmap_tiled::CreateResized( xbitmap_tiled& Dest, const std::uint32_t Width, const std::uint32_t Height, const xbitmap::mip_filter Filter ) const noexcept
+{
+    assert( &Dest != this );
+    assert( getLevelCount() > 0 );
+
+    Dest.Create( Width, Height, m_Format, m_TileSize, m_ColorSpace );
+    return Dest.ResampleLevel( *this, 0, 0, Filter );
+}
+
+//-------------------------------------------------------------------------------
+// Replaces every level below 0, each one is filtered from the one above it as
+// it is read back from its spill file
+//-------------------------------------------------------------------------------
+xerr xbitmap_tiled::GenerateMips( int nLevels, const xbitmap::mip_filter Filter ) noexcept
+{
+    assert( getLevelCount() > 0 );
+
+    const auto Width  = getWidth();
+    const auto Height = getHeight();
+    const int  nFull  = static_cast<int>( std::bit_width( std::max( Width, Height ) ) );
+    if( nLevels == -1 ) nLevels = nFull;
+    assert( nLevels >= 1 && nLevels <= nFull );
+
+    for( std::size_t i = 1; i < m_Levels.size(); ++i ) CloseLevel( m_Levels[i] );
+    m_Levels.resize( 1 );
+    for( int iLevel = 1; iLevel < nLevels; ++iLevel )
+    {
+        AddLevel( xbitmap_details::getMipDimension( Width, iLevel ), xbitmap_details::getMipDimension( Height, iLevel ) );
+        if( auto Err = ResampleLevel( *this, iLevel - 1, iLevel, Filter ); Err )
+        {
+            CloseLevel( m_Levels.back() );
+            m_Levels.pop_back();
+            return Err;
+        }
+    }
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+
+xerr xbitmap_tiled::Open( const std::wstring_view FileName ) noexcept
+{
+    Kill();
+
+    FILE* fp;
+    if( auto Err = _wfopen_s( &fp, std::wstring(FileName).c_str(), L"rb" ); Err )
+    {
+        xbitmap_details::HandleError( FileName, Err );
+        return xerr::create_f<xerr::default_states, "Fail to open file">();
+    }
+
+    std::uint32_t        Signature, Width, Height, TileSize;
+    xbitmap::format      Format;
+    xbitmap::color_space ColorSpace;
+    std::uint8_t         nLevels;
+    if( false
+        || (1 != fread(&Signature,      sizeof(Signature),      1, fp))
+        || (1 != fread(&Width,          sizeof(Width),          1, fp))
+        || (1 != fread(&Height,         sizeof(Height),         1, fp))
+        || (1 != fread(&TileSize,       sizeof(TileSize),       1, fp))
+        || (1 != fread(&Format,         sizeof(Format),         1, fp))
+        || (1 != fread(&ColorSpace,     sizeof(ColorSpace),     1, fp))
+        || (1 != fread(&nLevels,        sizeof(nLevels),        1, fp))
+        )
+    {
+        fclose(fp);
+        xbitmap_details::HandleError( FileName, errno );
+        return xerr::create_f<xerr::default_states, "Fail to read in file">();
+    }
+
+    if( Signature != std::uint32_t('XBTL') )
+    {
+        fclose(fp);
+        return xerr::create_f<xerr::default_states, "Wrong file signature">();
+    }
+
+    if( false
+        || Width == 0 || Height == 0 || TileSize == 0 || TileSize > 0xffff
+        || nLevels < 1 || nLevels > std::bit_width( std::max( Width, Height ) )
+        || Format >= xbitmap::format::ENUM_COUNT
+        || xbitmap_details::getFormatInfo( Format ).m_BlockWidth != 1 || xbitmap_details::getFormatInfo( Format ).m_BlockBytes == 0
+        || std::uint64_t( TileSize ) * TileSize * xbitmap_details::getFormatInfo( Format ).m_BlockBytes > 0xffffffff
+        )
+    {
+        fclose(fp);
+        return xerr::create_f<xerr::default_states, "Corrupted tiled bitmap header">();
+    }
+
+    m_TileSize   = TileSize;
+    m_Format     = Format;
+    m_ColorSpace = ColorSpace;
+
+    const auto TexelSize = xbitmap_details::getFormatInfo( m_Format ).m_BlockBytes;
+    auto       Offset    = static_cast<std::uint64_t>( ftell( fp ) );
+    for( int iLevel = 0; iLevel < nLevels; ++iLevel )
+    {
+        AddLevel( xbitmap_details::getMipDimension( Width, iLevel ), xbitmap_details::getMipDimension( Height, iLevel ) );
+        m_Levels.back().m_FileName   = FileName;
+        m_Levels.back().m_FileOffset = Offset;
+        Offset += std::uint64_t( m_Levels.back().m_Width ) * m_Levels.back().m_Height * TexelSize;
+    }
+
+    // The handle becomes the first one of the pool of level 0
+    m_Levels[0].m_Handles.push_back( fp );
+    return {};
+}
+
+//-------------------------------------------------------------------------------
+// Tiles are written one at a time, the ones that had to be read from a file for
+// it are evicted again right after
+//-------------------------------------------------------------------------------
+xerr xbitmap_tiled::Save( const std::wstring_view FileName ) const noexcept
+{
+    assert( getLevelCount() > 0 );
+
+    FILE* fp;
+    if( auto Err = _wfopen_s( &fp, std::wstring(FileName).c_str(), L"wb" ); Err )
+    {
+        xbitmap_details::HandleError( FileName, Err );
+        return xerr::create_f<xerr::default_states, "Fail to open file">();
+    }
+
+    static constexpr std::uint32_t Signature('XBTL');
+    const std::uint8_t             nLevels = static_cast<std::uint8_t>( getLevelCount() );
+
+    if( false
+        || (1 != fwrite(&Signature,             sizeof(Signature),              1, fp))
+        || (1 != fwrite(&m_Levels[0].m_Width,   sizeof(m_Levels[0].m_Width),    1, fp))
+        || (1 != fwrite(&m_Levels[0].m_Height,  sizeof(m_Levels[0].m_Height),   1, fp))
+        || (1 != fwrite(&m_TileSize,            sizeof(m_TileSize),             1, fp))
+        || (1 != fwrite(&m_Format,              sizeof(m_Format),               1, fp))
+        || (1 != fwrite(&m_ColorSpace,          sizeof(m_ColorSpace),           1, fp))
+        || (1 != fwrite(&nLevels,               sizeof(nLevels),                1, fp))
+        )
+    {
+        fclose(fp);
+        xbitmap_details::HandleError( FileName, errno );
+        return xerr::create_f<xerr::default_states, "Fail to write data to file">();
+    }
+
+    std::vector<std::byte> Zeros;
+    for( int iLevel = 0; iLevel < nLevels; ++iLevel )
+    {
+        auto&       Level     = m_Levels[iLevel];
+        const bool  bStreamed = Level.m_FileName.empty() == false;
+
+        for( std::uint32_t TileY = 0; TileY < Level.m_nTilesY; ++TileY )
+        for( std::uint32_t TileX = 0; TileX < Level.m_nTilesX; ++TileX )
+        {
+            const bool bResident = isResident( TileX, TileY, iLevel );
+            bool       bOk;
+            if( bResident || bStreamed )
+            {
+                const auto Data = getTile( TileX, TileY, iLevel ).getMip<std::byte>( 0 );
+                bOk = 1 == fwrite( Data.data(), Data.size(), 1, fp );
+                if( bResident == false ) ReleaseTile( Level, std::size_t(TileY) * Level.m_nTilesX + TileX );
+            }
+            else
+            {
+                const auto Rect = getTileRect( TileX, TileY, iLevel );
+                Zeros.assign( std::size_t( Rect.m_Right - Rect.m_Left ) * ( Rect.m_Bottom - Rect.m_Top ) * xbitmap_details::getFormatInfo( m_Format ).m_BlockBytes, std::byte{0} );
+                bOk = 1 == fwrite( Zeros.data(), Zeros.size(), 1, fp );
+            }
+
+            if( bOk == false )
+            {
+                fclose(fp);
+                xbitmap_details::HandleError( FileName, errno );
+                return xerr::create_f<xerr::default_states, "Fail to write data to file">();
+            }
+        }
+    }
+
+    fclose(fp);
+    return {};
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// SAMPLING
+//////////////////////////////////////////////////////////////////////////////////
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Decoded texel channels as linear RGBA, channels the format lacks read 0 (alpha 1)
+    //-------------------------------------------------------------------------------
+    inline xcolorf ToColor( const texel_codec& Codec, const float* pTexel ) noexcept
+    {
+        xcolorf Color( 0.0f, 0.0f, 0.0f, 1.0f );
+        for( int i = 0; i < Codec.m_nChannels; ++i ) if( Codec.m_Channels[i] >= 0 ) Color[ Codec.m_Channels[i] ] = pTexel[i];
+        return Color;
+    }
+
+    //-------------------------------------------------------------------------------
+    // What the sampler needs from one mip of a face/frame
+    //-------------------------------------------------------------------------------
+    struct sampler_mip
+    {
+        const std::byte*            m_pData;
+        std::uint32_t               m_Width;
+        std::uint32_t               m_Height;
+        std::uint32_t               m_TexelSize;
+        xbitmap::texel_layout       m_Layout;
+        xbitmap::wrap_mode          m_WrapU;
+        xbitmap::wrap_mode          m_WrapV;
+    };
+
+    inline sampler_mip getSamplerMip( const xbitmap& Bitmap, const int iMip, const int iFace, const int iFrame ) noexcept
+    {
+        return { Bitmap.getMip<std::byte>( iMip, iFace, iFrame ).data()
+               , getMipDimension( Bitmap.getWidth(),  iMip )
+               , getMipDimension( Bitmap.getHeight(), iMip )
+               , getFormatInfo( Bitmap.getFormat() ).m_BlockBytes
+               , Bitmap.getLayout()
+               , Bitmap.getUWrapMode()
+               , Bitmap.getVWrapMode() };
+    }
+
+    //-------------------------------------------------------------------------------
+    // The four texels of a bilinear sample (x0y0, x1y0, x0y1, x1y1) as texel
+    // indices, -1 for the clamp color, and the weights of x1 and y1
+    //-------------------------------------------------------------------------------
+    struct bilinear_tap
+    {
+        std::array<std::int64_t, 4> m_Index;
+        float                       m_FracX;
+        float                       m_FracY;
+    };
+
+    // Texel coordinates are kept where floats still have fractions
+    constexpr float max_sample_coordinate_v = float( 1 << 22 );
+
+    inline void getBilinearTaps( const sampler_mip& Mip, const std::array<float, 2>* pUV, const std::size_t Count, bilinear_tap* pTaps ) noexcept
+    {
+        assert( Count <= 4 );
+        alignas(16) std::array<float, 4> FloorX, FloorY, FracX, FracY;
+
+#if XBITMAP_SSE2
+        if( Count == 4 )
+        {
+            const auto A     = _mm_loadu_ps( &pUV[0][0] );
+            const auto B     = _mm_loadu_ps( &pUV[2][0] );
+            const auto Limit = _mm_set1_ps( max_sample_coordinate_v );
+            const auto Half  = _mm_set1_ps( 0.5f );
+            const auto One   = _mm_set1_ps( 1.0f );
+
+            const auto Split = [&]( const __m128 UV, const std::uint32_t Size, float* pFloor, float* pFrac ) noexcept
+            {
+                const auto X = _mm_max_ps( _mm_min_ps( _mm_sub_ps( _mm_mul_ps( UV, _mm_set1_ps( float( Size ) ) ), Half ), Limit ), _mm_sub_ps( _mm_setzero_ps(), Limit ) );
+                const auto T = _mm_cvtepi32_ps( _mm_cvttps_epi32( X ) );
+                const auto F = _mm_sub_ps( T, _mm_and_ps( _mm_cmpgt_ps( T, X ), One ) );
+                _mm_store_ps( pFloor, F );
+                _mm_store_ps( pFrac,  _mm_sub_ps( X, F ) );
+            };
+
+            Split( _mm_shuffle_ps( A, B, _MM_SHUFFLE( 2, 0, 2, 0 ) ), Mip.m_Width,  FloorX.data(), FracX.data() );
+            Split( _mm_shuffle_ps( A, B, _MM_SHUFFLE( 3, 1, 3, 1 ) ), Mip.m_Height, FloorY.data(), FracY.data() );
+        }
+        else
+#endif
+        {
+            for( std::size_t i = 0; i < Count; ++i )
+            {
+                const float X = std::clamp( pUV[i][0] * Mip.m_Width  - 0.5f, -max_sample_coordinate_v, max_sample_coordinate_v );
+                const float Y = std::clamp( pUV[i][1] * Mip.m_Height - 0.5f, -max_sample_coordinate_v, max_sample_coordinate_v );
+                FloorX[i] = std::floor( X );
+                FloorY[i] = std::floor( Y );
+                FracX[i]  = X - FloorX[i];
+                FracY[i]  = Y - FloorY[i];
+            }
+        }
+
+        for( std::size_t i = 0; i < Count; ++i )
+        {
+            const int  X0 = static_cast<int>( FloorX[i] );
+            const int  Y0 = static_cast<int>( FloorY[i] );
+            const auto W  = static_cast<int>( Mip.m_Width );
+            const auto H  = static_cast<int>( Mip.m_Height );
+            const std::array<int, 2> X{ WrapCoordinate( X0, W, Mip.m_WrapU ), WrapCoordinate( X0 + 1, W, Mip.m_WrapU ) };
+            const std::array<int, 2> Y{ WrapCoordinate( Y0, H, Mip.m_WrapV ), WrapCoordinate( Y0 + 1, H, Mip.m_WrapV ) };
+
+            for( int t = 0; t < 4; ++t )
+            {
+                const auto x = X[ t & 1 ];
+                const auto y = Y[ t >> 1 ];
+                pTaps[i].m_Index[t] = ( x < 0 || y < 0 ) ? -1 : std::int64_t( getTexelIndex( Mip.m_Layout, std::uint32_t(x), std::uint32_t(y), Mip.m_Width, Mip.m_Height ) );
+            }
+            pTaps[i].m_FracX = FracX[i];
+            pTaps[i].m_FracY = FracY[i];
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Blends four 32 bit texels byte by byte. The weights are 8 bit fixed point and
+    // always add up to 256 so a constant area stays exactly constant.
+    //-------------------------------------------------------------------------------
+    inline std::uint32_t BlendFixed( const std::array<std::uint32_t, 4>& T, const float FracX, const float FracY ) noexcept
+    {
+        const int Fx  = static_cast<int>( FracX * 256.0f + 0.5f );
+        const int Fy  = static_cast<int>( FracY * 256.0f + 0.5f );
+        const int W11 = ( Fx * Fy + 128 ) >> 8;
+        const int W10 = Fx - W11;
+        const int W01 = Fy - W11;
+        const int W00 = 256 - Fx - Fy + W11;
+
+#if XBITMAP_SSE2
+        const auto Zero = _mm_setzero_si128();
+        const auto Top  = _mm_unpacklo_epi8( _mm_unpacklo_epi8( _mm_cvtsi32_si128( int(T[0]) ), _mm_cvtsi32_si128( int(T[1]) ) ), Zero );
+        const auto Bot  = _mm_unpacklo_epi8( _mm_unpacklo_epi8( _mm_cvtsi32_si128( int(T[2]) ), _mm_cvtsi32_si128( int(T[3]) ) ), Zero );
+        auto       Sum  = _mm_add_epi32( _mm_madd_epi16( Top, _mm_set1_epi32( W00 | ( W10 << 16 ) ) )
+                                       , _mm_madd_epi16( Bot, _mm_set1_epi32( W01 | ( W11 << 16 ) ) ) );
+        Sum = _mm_srli_epi32( _mm_add_epi32( Sum, _mm_set1_epi32( 128 ) ), 8 );
+        Sum = _mm_packs_epi32( Sum, Sum );
+        return static_cast<std::uint32_t>( _mm_cvtsi128_si32( _mm_packus_epi16( Sum, Sum ) ) );
+#else
+        std::uint32_t Result = 0;
+        for( int b = 0; b < 32; b += 8 )
+        {
+            const auto C = ( ( T[0] >> b ) & 0xff ) * W00 + ( ( T[1] >> b ) & 0xff ) * W10 + ( ( T[2] >> b ) & 0xff ) * W01 + ( ( T[3] >> b ) & 0xff ) * W11;
+            Result |= ( ( C + 128 ) >> 8 ) << b;
+        }
+        return Result;
+#endif
+    }
+
+    //-------------------------------------------------------------------------------
+    // Bilinear samples in the byte order of the texels, Border is the clamp color
+    // in that same order
+    //-------------------------------------------------------------------------------
+    static void SampleBilinearFixed( const sampler_mip& Mip, std::span<const std::array<float, 2>> UVs, std::uint32_t* pOut, const std::uint32_t Border ) noexcept
+    {
+        const auto pTexels = reinterpret_cast<const std::uint32_t*>( Mip.m_pData );
+
+        std::array<bilinear_tap, 4> Taps;
+        for( std::size_t i = 0; i < UVs.size(); i += 4 )
+        {
+            const auto Count = std::min<std::size_t>( 4, UVs.size() - i );
+            getBilinearTaps( Mip, &UVs[i], Count, Taps.data() );
+
+            for( std::size_t s = 0; s < Count; ++s )
+            {
+                std::array<std::uint32_t, 4> T;
+                for( int t = 0; t < 4; ++t ) T[t] = Taps[s].m_Index[t] < 0 ? Border : pTexels[ Taps[s].m_Index[t] ];
+                pOut[ i + s ] = BlendFixed( T, Taps[s].m_FracX, Taps[s].m_FracY );
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------
+    // Bilinear samples of any uncompressed format, decoded (sRGB to linear) before
+    // blending. pOut gets m_nChannels floats per sample.
+    //-------------------------------------------------------------------------------
+    static void SampleBilinearFloat( const sampler_mip& Mip, const texel_codec& Codec, std::span<const std::array<float, 2>> UVs, float* pOut, const float* pBorder ) noexcept
+    {
+        const auto nC = static_cast<std::size_t>( Codec.m_nChannels );
+
+        std::array<bilinear_tap, 4>             Taps;
+        std::array<std::array<float, 4>, 4>     Texels;
+        for( std::size_t i = 0; i < UVs.size(); i += 4 )
+        {
+            const auto Count = std::min<std::size_t>( 4, UVs.size() - i );
+            getBilinearTaps( Mip, &UVs[i], Count, Taps.data() );
+
+            for( std::size_t s = 0; s < Count; ++s )
+            {
+                const auto& Tap = Taps[s];
+                for( int t = 0; t < 4; ++t )
+                {
+                    if( Tap.m_Index[t] < 0 ) std::copy_n( pBorder, nC, Texels[t].data() );
+                    else                     Codec.Decode( &Mip.m_pData[ Tap.m_Index[t] * Mip.m_TexelSize ], 1, Texels[t].data() );
+                }
+
+                const std::array<float, 4> W{ ( 1 - Tap.m_FracX ) * ( 1 - Tap.m_FracY ), Tap.m_FracX * ( 1 - Tap.m_FracY )
+                                            , ( 1 - Tap.m_FracX ) * Tap.m_FracY,       Tap.m_FracX * Tap.m_FracY };
+                auto pDest = &pOut[ ( i + s ) * nC ];
+#if XBITMAP_SSE2
+                if( nC == 4 )
+                {
+                    auto Sum = _mm_mul_ps( _mm_loadu_ps( Texels[0].data() ), _mm_set1_ps( W[0] ) );
+                    for( int t = 1; t < 4; ++t ) Sum = _mm_add_ps( Sum, _mm_mul_ps( _mm_loadu_ps( Texels[t].data() ), _mm_set1_ps( W[t] ) ) );
+                    _mm_storeu_ps( pDest, Sum );
+                    continue;
+                }
+#endif
+                for( std::size_t c = 0; c < nC; ++c ) pDest[c] = Texels[0][c] * W[0] + Texels[1][c] * W[1] + Texels[2][c] * W[2] + Texels[3][c] * W[3];
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_sampler::Bind( const xbitmap& Bitmap, const int iMip, const int iFace, const int iFrame ) noexcept
+{
+    assert( Bitmap.isValid() );
+    assert( iMip   >= 0 && iMip   < Bitmap.getMipCount() );
+    assert( iFace  >= 0 && iFace  < Bitmap.getFaceCount() );
+    assert( iFrame >= 0 && iFrame < Bitmap.getFrameCount() );
+    assert( xbitmap_details::getFormatInfo( Bitmap.getFormat() ).m_BlockWidth == 1 );
+
+    m_pBitmap = &Bitmap;
+    m_iMip    = iMip;
+    m_iFace   = iFace;
+    m_iFrame  = iFrame;
+}
+
+//-------------------------------------------------------------------------------
+// The bytes are blended as stored (sRGB is not decoded) and then moved into
+// xcolori order
+//-------------------------------------------------------------------------------
+void xbitmap_sampler::SampleBilinear( std::span<const uv> UVs, std::span<xcolori> Out ) const noexcept
+{
+    assert( m_pBitmap );
+    assert( Out.size() >= UVs.size() );
+    if( UVs.empty() ) return;
+
+    std::array<int, 4> Channels;
+    [[maybe_unused]] const auto nBytes = xbitmap_details::getByteChannels( m_pBitmap->getFormat(), Channels );
+    assert( nBytes == 4 );
+
+    // Clamp color into the texel byte order, and the way back
+    const std::array<int, 4> Identity{ 0, 1, 2, 3 };
+    const auto      ToTexel  = xbitmap_details::getByteSwizzle( Channels, Identity );
+    const auto      ToColor  = xbitmap_details::getByteSwizzle( Identity, Channels );
+    std::uint32_t   Border;
+    xbitmap_details::SwizzleRow( ToTexel, &m_pBitmap->m_ClampColor.m_Value, &Border, 1, false );
+
+    const auto pOut = &Out[0].m_Value;
+    xbitmap_details::SampleBilinearFixed( xbitmap_details::getSamplerMip( *m_pBitmap, m_iMip, m_iFace, m_iFrame ), UVs, pOut, Border );
+    if( Channels != Identity ) xbitmap_details::SwizzleRow( ToColor, pOut, pOut, static_cast<std::uint32_t>( UVs.size() ), false );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_sampler::SampleBilinear( std::span<const uv> UVs, std::span<xcolorf> Out ) const noexcept
+{
+    assert( m_pBitmap );
+    assert( Out.size() >= UVs.size() );
+
+    const xbitmap_details::texel_codec Codec( m_pBitmap->getFormat(), m_pBitmap->getColorSpace() == xbitmap::color_space::SRGB );
+    const auto           nC = static_cast<std::size_t>( Codec.m_nChannels );
+    std::array<float, 4> Border;
+    Codec.DecodeColor( m_pBitmap->m_ClampColor, Border.data() );
+
+    // Batches go through a small buffer of decoded channels
+    constexpr std::size_t   batch_v = 256;
+    std::array<float, batch_v * 4> Samples;
+    const auto              Mip = xbitmap_details::getSamplerMip( *m_pBitmap, m_iMip, m_iFace, m_iFrame );
+    for( std::size_t i = 0; i < UVs.size(); i += batch_v )
+    {
+        const auto Count = std::min( batch_v, UVs.size() - i );
+        xbitmap_details::SampleBilinearFloat( Mip, Codec, UVs.subspan( i, Count ), Samples.data(), Border.data() );
+        for( std::size_t s = 0; s < Count; ++s ) Out[ i + s ] = xbitmap_details::ToColor( Codec, &Samples[ s * nC ] );
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+xcolorf xbitmap::getPixelColor( const std::uint32_t X, const std::uint32_t Y, const int iMip, const int iFace, const int iFrame ) const noexcept
+{
+    assert( X < xbitmap_details::getMipDimension( getWidth(),  iMip ) );
+    assert( Y < xbitmap_details::getMipDimension( getHeight(), iMip ) );
+
+    const xbitmap_details::texel_codec Codec( getFormat(), getColorSpace() == color_space::SRGB );
+    assert( Codec.m_Info.m_BlockWidth == 1 );
+
+    std::array<float, 4> Texel;
+    Codec.Decode( &getMip<std::byte>( iMip, iFace, iFrame )[ std::size_t( getTexelIndex( X, Y, iMip ) ) * Codec.m_Info.m_BlockBytes ], 1, Texel.data() );
+    return xbitmap_details::ToColor( Codec, Texel.data() );
+}
+
+//-------------------------------------------------------------------------------
+
+xcolorf xbitmap::getBilinearColor( const float U, const float V, const int iMip, const int iFace, const int iFrame ) const noexcept
+{
+    const xbitmap_sampler::uv UV{ U, V };
+    xcolorf                   Color;
+    xbitmap_sampler( *this, iMip, iFace, iFrame ).SampleBilinear( { &UV, 1 }, { &Color, 1 } );
+    return Color;
+}
+
+namespace xbitmap_details
+{
+    //-------------------------------------------------------------------------------
+    // Trilinear (MaxAnisotropy == 1) or anisotropic sampling of the mips from iBaseMip
+    // down. Footprints follow the usual GPU rules: the derivatives are measured in
+    // texels of the base mip, the anisotropy is the ratio of the long and short
+    // axes (up to MaxAnisotropy) and the level of detail is log2( long / anisotropy ).
+    // The bilinear taps of a batch are grouped by mip so each mip is sampled as one
+    // batch, and then accumulated into their samples.
+    //-------------------------------------------------------------------------------
+    struct mip_tap
+    {
+        std::array<float, 2>        m_UV;
+        float                       m_Weight;
+        std::uint32_t               m_iSample;
+    };
+
+    static void SampleMipChain( const xbitmap& Bitmap, const int iBaseMip, const int iFace, const int iFrame
+                              , std::span<const std::array<float, 2>> UVs, std::span<const xbitmap_sampler::uv_derivatives> Derivatives
+                              , std::span<xcolorf> Out, const int MaxAnisotropy ) noexcept
+    {
+        assert( Derivatives.size() >= UVs.size() && Out.size() >= UVs.size() );
+        assert( MaxAnisotropy >= 1 );
+
+        const texel_codec Codec( Bitmap.getFormat(), Bitmap.getColorSpace() == xbitmap::color_space::SRGB );
+        const auto        nC      = static_cast<std::size_t>( Codec.m_nChannels );
+        const int         nLevels = Bitmap.getMipCount() - iBaseMip;
+        const float       W       = float( getMipDimension( Bitmap.getWidth(),  iBaseMip ) );
+        const float       H       = float( getMipDimension( Bitmap.getHeight(), iBaseMip ) );
+
+        std::array<float, 4> Border;
+        Codec.DecodeColor( Bitmap.m_ClampColor, Border.data() );
+
+        std::vector<sampler_mip>            Mips( nLevels );
+        for( int i = 0; i < nLevels; ++i ) Mips[i] = getSamplerMip( Bitmap, iBaseMip + i, iFace, iFrame );
+
+        constexpr std::size_t               batch_v = 256;
+        std::vector<std::vector<mip_tap>>   Buckets( nLevels );
+        std::vector<std::array<float, 2>>   TapUVs;
+        std::vector<float>                  Texels;
+        std::array<float, batch_v * 4>      Accum;
+
+        for( std::size_t iBegin = 0; iBegin < UVs.size(); iBegin += batch_v )
+        {
+            const auto Count = std::min( batch_v, UVs.size() - iBegin );
+            for( auto& Bucket : Buckets ) Bucket.clear();
+
+            for( std::size_t s = 0; s < Count; ++s )
+            {
+                const auto& UV = UVs[ iBegin + s ];
+                const auto& D  = Derivatives[ iBegin + s ];
+                const float Lx = std::hypot( D.m_dUVdx[0] * W, D.m_dUVdx[1] * H );
+                const float Ly = std::hypot( D.m_dUVdy[0] * W, D.m_dUVdy[1] * H );
+                const float Major = std::max( Lx, Ly );
+                const float Minor = std::min( Lx, Ly );
+                const auto& Axis  = Lx >= Ly ? D.m_dUVdx : D.m_dUVdy;
+
+                const float Ratio = Minor > 0 ? std::min( Major / Minor, float( MaxAnisotropy ) ) : ( Major > 0 ? float( MaxAnisotropy ) : 1.0f );
+                const int   nTaps = std::max( 1, static_cast<int>( std::ceil( Ratio - 0.001f ) ) );
+                const float Lod   = Major > 0 ? std::clamp( std::log2( Major / Ratio ), 0.0f, float( nLevels - 1 ) ) : 0.0f;
+                const int   iLo   = static_cast<int>( Lod );
+                const float Blend = Lod - iLo;
+
+                for( int t = 0; t < nTaps; ++t )
+                {
+                    const float Offset = nTaps == 1 ? 0.0f : ( t + 0.5f ) / nTaps - 0.5f;
+                    const std::array<float, 2> P{ UV[0] + Axis[0] * Offset, UV[1] + Axis[1] * Offset };
+
+                    Buckets[iLo].push_back( { P, ( 1 - Blend ) / nTaps, std::uint32_t(s) } );
+                    if( Blend > 0 ) Buckets[ iLo + 1 ].push_back( { P, Blend / nTaps, std::uint32_t(s) } );
+                }
+            }
+
+            std::fill_n( Accum.begin(), Count * nC, 0.0f );
+            for( int iLevel = 0; iLevel < nLevels; ++iLevel )
+            {
+                const auto& Bucket = Buckets[iLevel];
+                if( Bucket.empty() ) continue;
+
+                TapUVs.resize( Bucket.size() );
+                Texels.resize( Bucket.size() * nC );
+                for( std::size_t i = 0; i < Bucket.size(); ++i ) TapUVs[i] = Bucket[i].m_UV;
+                SampleBilinearFloat( Mips[iLevel], Codec, TapUVs, Texels.data(), Border.data() );
+
+                for( std::size_t i = 0; i < Bucket.size(); ++i )
+                for( std::size_t c = 0; c < nC; ++c ) Accum[ Bucket[i].m_iSample * nC + c ] += Texels[ i * nC + c ] * Bucket[i].m_Weight;
+            }
+
+            for( std::size_t s = 0; s < Count; ++s ) Out[ iBegin + s ] = ToColor( Codec, &Accum[ s * nC ] );
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_sampler::SampleTrilinear( std::span<const uv> UVs, std::span<const uv_derivatives> Derivatives, std::span<xcolorf> Out ) const noexcept
+{
+    assert( m_pBitmap );
+    xbitmap_details::SampleMipChain( *m_pBitmap, m_iMip, m_iFace, m_iFrame, UVs, Derivatives, Out, 1 );
+}
+
+//-------------------------------------------------------------------------------
+
+void xbitmap_sampler::SampleAnisotropic( std::span<const uv> UVs, std::span<const uv_derivatives> Derivatives, std::span<xcolorf> Out, const int MaxAnisotropy ) const noexcept
+{
+    assert( m_pBitmap );
+    xbitmap_details::SampleMipChain( *m_pBitmap, m_iMip, m_iFace, m_iFrame, UVs, Derivatives, Out, MaxAnisotropy );
+}
@@ -3,8 +3,15 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "xcolor.h"
 #include "source/xerr.h"
@@ -208,6 +215,139 @@ public:
     , ENUM_COUNT
     };
 
+    // Order of the texels inside every mip (uncompressed formats). Mip generation (box and separable
+    // filters), resizing and rotation address the texels through the layout, other kernels reorder
+    // the bitmap to LINEAR while they run
+    enum class texel_layout : std::uint8_t
+    { LINEAR                                                        // Row major, what views, files and most kernels use
+    , MORTON                                                        // Z-order curve, power of two sizes only
+    , TILED_4X4                                                     // Row major tiles of 4x4 texels, row major inside
+    , TILED_8X8                                                     // Row major tiles of 8x8 texels, row major inside
+    , ENUM_COUNT
+    };
+
+    // Derivative kernel used to turn a height map into a normal map
+    enum class normal_kernel : std::uint8_t
+    { SOBEL                                                         // 3x3 [1 2 1] smoothing, cheap and soft
+    , SCHARR                                                        // 3x3 [3 10 3] smoothing, better rotational symmetry
+    , ENUM_COUNT
+    };
+
+    // Filter used to build each mip from the one above it
+    enum class mip_filter : std::uint8_t
+    { BOX                                                           // 2x2 average, the fastest
+    , KAISER                                                        // Kaiser windowed sinc, sharp with little ringing
+    , LANCZOS3                                                      // 3 lobe windowed sinc, the sharpest
+    , MITCHELL                                                      // Mitchell-Netravali cubic (B = C = 1/3), soft without visible ringing
+    , ENUM_COUNT
+    };
+
+    // Reconstruction filter used when a bitmap is sampled at arbitrary positions
+    enum class sample_filter : std::uint8_t
+    { BILINEAR                                                      // 2x2 texels
+    , BICUBIC                                                       // 4x4 texels Catmull-Rom, sharper, negative lobes clamped at 0
+    , ENUM_COUNT
+    };
+
+    // Clockwise rotation in 90 degree steps
+    enum class rotation : std::uint8_t
+    { CW_90
+    , CW_180
+    , CW_270
+    , ENUM_COUNT
+    };
+
+    struct rect                                                     // Texel rectangle, [Left, Right) x [Top, Bottom)
+    {
+        std::uint32_t           m_Left;
+        std::uint32_t           m_Top;
+        std::uint32_t           m_Right;
+        std::uint32_t           m_Bottom;
+    };
+
+    using sh9 = std::array<std::array<float, 3>, 9>;              // L2 spherical harmonics, RGB per coefficient
+
+    // Non owning window over the texels of one mip of a face/frame, or a rectangle of it (uncompressed formats only)
+    template< typename T >                                          // std::byte or const std::byte
+    struct basic_view
+    {
+        T*                      m_pData         { nullptr };
+        std::uint32_t           m_Width         { 0 };              // In texels
+        std::uint32_t           m_Height        { 0 };              // In texels
+        std::uint32_t           m_RowPitch      { 0 };              // Bytes from the start of a row to the start of the next
+        std::uint8_t            m_TexelSize     { 0 };              // Bytes per texel
+        format                  m_Format        { format::INVALID };
+
+        template< typename U = T >
+        inline      std::span<U>                getRow                  ( std::uint32_t y
+                                                                        ) const noexcept;
+        inline      basic_view                  getSubView              ( const rect& Rect
+                                                                        ) const noexcept;
+        constexpr                               operator basic_view<const std::byte> ( void
+                                                                        ) const noexcept;
+    };
+
+    using view       = basic_view<std::byte>;
+    using const_view = basic_view<const std::byte>;
+
+    struct blit_options
+    {
+        bool                    m_bPremultiplyAlpha         { false };              // Color channels are multiplied by alpha on the way
+        bool                    m_bFlipY                    { false };              // The first source row lands on the last destination row
+    };
+
+    struct atlas_settings
+    {
+        std::uint32_t           m_MaxSize                   { 4096 };               // Largest side the atlas can grow to, sides are powers of two
+        std::uint32_t           m_Gutter                    { 2 };                  // Texels around each entry filled following its wrap modes
+        std::uint32_t           m_Alignment                 { 4 };                  // Entries (gutter included) start and end at multiples of it, keeps BC blocks whole
+        format                  m_Format                    { format::XCOLOR };     // Any uncompressed format, sources are converted as they are copied
+        int                     m_nMips                     { 1 };                  // -1 == getFullMipChainCount()
+    };
+
+    struct atlas_entry
+    {
+        rect                    m_Rect;                                             // Texels of the entry in the atlas, gutter excluded
+        std::array<float, 4>    m_UV;                                               // The same rectangle as U0, V0, U1, V1
+    };
+
+    struct staging_subresource
+    {
+        std::uint64_t           m_Offset;                                           // Bytes from the start of the staging buffer
+        std::uint32_t           m_RowPitch;                                         // Bytes from the start of a row to the start of the next
+        std::uint32_t           m_RowSize;                                          // Bytes of texels in a row, the rest of the pitch is padding
+        std::uint32_t           m_nRows;                                            // Rows of blocks for block compressed formats
+        std::uint32_t           m_Width;                                            // In texels
+        std::uint32_t           m_Height;                                           // In texels
+    };
+
+    struct staging_layout                                           // Where every mip, face and frame goes in a GPU upload buffer
+    {
+        std::vector<staging_subresource> m_Subresources;                            // Frame, face then mip order (the D3D12 subresource order)
+        std::uint64_t           m_TotalSize                 { 0 };                  // Bytes the staging buffer needs
+        std::uint32_t           m_RowPitchAlignment         { 256 };
+        std::uint32_t           m_OffsetAlignment           { 512 };                // Of every subresource
+        std::uint32_t           m_Width                     { 0 };                  // Of mip 0
+        std::uint32_t           m_Height                    { 0 };
+        format                  m_Format                    { format::INVALID };
+        color_space             m_ColorSpace                { color_space::SRGB };
+        int                     m_nMips                     { 0 };
+        int                     m_nFaces                    { 0 };
+        int                     m_nFrames                   { 0 };
+    };
+
+    struct mip_settings
+    {
+        mip_filter              m_Filter                    { mip_filter::BOX };
+        bool                    m_bPreserveAlphaCoverage    { false };              // Keep the alpha test coverage of mip 0 in every mip (cutouts)
+        float                   m_AlphaReference            { 0.5f };               // Alpha test threshold the coverage is measured at
+        bool                    m_bNormalMap                { false };              // XCOLOR normals: average the vectors and renormalize (box filter)
+        float                   m_ToksvigPower              { 0 };                  // Specular power for the Toksvig factor, 0 == none
+        int                     m_ToksvigChannel            { -1 };                 // xcolori channel (0-3) that gets the Toksvig factor, -1 == none
+        xbitmap*                m_pToksvigBitmap            { nullptr };            // Optional R8 bitmap (same mips) that gets the Toksvig factor
+        bool                    m_bSeamlessCubemap          { false };              // Cube maps filter across face edges (tent filter) and match the edges
+    };
+
 public:
 
    constexpr                                xbitmap                 ( void 
@@ -275,6 +415,14 @@ public:
                                                                     ) noexcept;
     constexpr   color_space                 getColorSpace           ( void
                                                                     ) const noexcept;
+    constexpr   texel_layout                getLayout               ( void
+                                                                    ) const noexcept;
+                void                        setLayout               ( texel_layout Layout       // Reorders every mip, face and frame
+                                                                    ) noexcept;
+    inline      std::uint32_t               getTexelIndex           ( std::uint32_t x
+                                                                    , std::uint32_t y
+                                                                    , int           iMip = 0
+                                                                    ) const noexcept;
     constexpr   std::uint64_t               getFrameSize            ( void 
                                                                     ) const noexcept;
     constexpr   int                         getFrameCount           ( void
@@ -296,7 +444,11 @@ public:
                                                                     ) const noexcept;
     constexpr   int                         getMipCount             ( void 
                                                                     ) const noexcept;
-                void                        FlipImageInY            ( void 
+                // Uncompressed formats and BC1-BC5, all mips, faces and frames. BC mips taller than a block whose height is not a
+                // multiple of 4 can not be flipped by moving blocks, they are decoded and encoded again which loses some quality
+                void                        FlipImageInY            ( void
+                                                                    ) noexcept;
+    static      void                        FlipImageInY            ( const view& View
                                                                     ) noexcept;
     template< typename T >
     inline      std::span<T>                getMip                  ( int iMip
@@ -312,11 +464,25 @@ public:
                                                                     ) const noexcept;
     inline      int                         getFullMipChainCount    ( void 
                                                                     ) const noexcept;
+                view                        getView                 ( int iMip   = 0
+                                                                    , int iFace  = 0
+                                                                    , int iFrame = 0
+                                                                    ) noexcept;
+                const_view                  getView                 ( int iMip   = 0
+                                                                    , int iFace  = 0
+                                                                    , int iFrame = 0
+                                                                    ) const noexcept;
     
                 void                        CreateResizedBitmap     ( xbitmap&          Dest         
                                                                     , std::uint32_t     FinalWidth
                                                                     , std::uint32_t     FinalHeight 
+                                                                    , mip_filter        Filter = mip_filter::MITCHELL
                                                                     ) const noexcept;
+    static      void                        Resize                  ( const view&       Dest                    // Straight alpha, borders clamp to the edge
+                                                                    , const const_view& Src
+                                                                    , mip_filter        Filter     = mip_filter::MITCHELL
+                                                                    , color_space       ColorSpace = color_space::SRGB
+                                                                    ) noexcept;
     
                 void                        setDefaultTexture       ( void 
                                                                     ) noexcept;
@@ -326,6 +492,21 @@ public:
                 void                        CreateBitmap            ( std::uint32_t Width
                                                                     , std::uint32_t Height 
                                                                     ) noexcept;
+                void                        CreateBitmap            ( std::uint32_t Width
+                                                                    , std::uint32_t Height
+                                                                    , format        Format
+                                                                    , int           nMips     = 1
+                                                                    , int           nFrames   = 1
+                                                                    , bool          isCubeMap = false
+                                                                    ) noexcept;
+                void                        GenerateMips            ( int           nMips = -1      // -1 == getFullMipChainCount()
+                                                                    ) noexcept;
+                void                        GenerateMips            ( const mip_settings& Settings
+                                                                    , int           nMips = -1      // -1 == getFullMipChainCount()
+                                                                    ) noexcept;
+    
+                void                        RegenerateMips          ( std::span<const rect>         DirtyRects      // in mip 0 texels, box filter only
+                                                                    ) noexcept;
     
                 void                        CreateFromMips          ( std::span<const xbitmap> MipList
                                                                     ) noexcept;
@@ -347,14 +528,139 @@ public:
                                                                     , bool                          isCubeMap = false
                                                                     ) noexcept;
 
+                // Normal maps (encoded as xcolori::setupFromNormal does, +Y up)
+                void                        CreateNormalMapFromHeight( xbitmap&                     Dest
+                                                                    , float                         Strength = 1.0f
+                                                                    , normal_kernel                 Kernel   = normal_kernel::SOBEL
+                                                                    ) const noexcept;
+                void                        ReconstructNormalZ      ( void
+                                                                    ) noexcept;
+    static      void                        PackNormals             ( std::span<xcolori>                          Dest
+                                                                    , std::span<const std::array<float,3>>        Normals
+                                                                    ) noexcept;
+    static      void                        UnpackNormals           ( std::span<std::array<float,3>>              Dest
+                                                                    , std::span<const xcolori>                    Colors
+                                                                    ) noexcept;
+    static      void                        UnpackNormalsXY         ( std::span<std::array<float,3>>              Dest
+                                                                    , std::span<const xcolori>                    Colors
+                                                                    ) noexcept;
+
+                // Saturating per channel math for R8 and the 32 bit xcolor formats (all mips, faces and frames)
+                void                        Add                     ( const xbitmap&                Src
+                                                                    ) noexcept;
+                void                        Add                     ( xcolori                       Color
+                                                                    ) noexcept;
+                void                        Subtract                ( const xbitmap&                Src
+                                                                    ) noexcept;
+                void                        Subtract                ( xcolori                       Color
+                                                                    ) noexcept;
+                void                        Multiply                ( const xbitmap&                Src
+                                                                    ) noexcept;
+                void                        Multiply                ( xcolori                       Color
+                                                                    ) noexcept;
+                void                        ScaleBias               ( const xcolorf&                Scale
+                                                                    , const xcolorf&                Bias
+                                                                    ) noexcept;
+    static      void                        Add                     ( const view&                   Dest
+                                                                    , const const_view&             Src
+                                                                    ) noexcept;
+    static      void                        Subtract                ( const view&                   Dest
+                                                                    , const const_view&             Src
+                                                                    ) noexcept;
+    static      void                        Multiply                ( const view&                   Dest
+                                                                    , const const_view&             Src
+                                                                    ) noexcept;
+
+                // Texels with alpha 0 take the color of the nearest visible texel (32 bit xcolor formats, all mips, faces and frames)
+                void                        BleedAlpha              ( void
+                                                                    ) noexcept;
+
+                // Copies a rectangle converting the format on the fly (uncompressed formats, same size rectangles)
+    static      void                        Blit                    ( xbitmap&                      Dest
+                                                                    , const rect&                   DestRect
+                                                                    , const xbitmap&                Src
+                                                                    , const rect&                   SrcRect
+                                                                    , const blit_options&           Options
+                                                                    ) noexcept;
+    static      void                        Blit                    ( const view&                   Dest
+                                                                    , const const_view&             Src
+                                                                    , const blit_options&           Options
+                                                                    ) noexcept;
+
+                // Packs mip 0 of every source into one bitmap with a skyline packer, Entries[i] tells where Sources[i] went
+    static      xerr                        CreateAtlas             ( xbitmap&                      Dest
+                                                                    , std::span<atlas_entry>        Entries
+                                                                    , std::span<const xbitmap>      Sources
+                                                                    , const atlas_settings&         Settings
+                                                                    ) noexcept;
+
+                // GPU upload, rows and subresources padded to the given alignments. WriteStaging fills the rows in
+                // parallel and leaves the padding alone, Dest can be a mapped buffer of at least m_TotalSize bytes.
+                // Staging files keep the padded layout so that an upload is a single copy of the loaded data.
+                staging_layout              getStagingLayout        ( std::uint32_t                 RowPitchAlignment = 256
+                                                                    , std::uint32_t                 OffsetAlignment   = 512
+                                                                    ) const noexcept;
+                void                        WriteStaging            ( std::span<std::byte>          Dest
+                                                                    , const staging_layout&         Layout
+                                                                    ) const noexcept;
+                xerr                        SaveStaging             ( const std::wstring_view       FileName
+                                                                    , std::uint32_t                 RowPitchAlignment = 256
+                                                                    , std::uint32_t                 OffsetAlignment   = 512
+                                                                    ) const noexcept;
+    static      xerr                        LoadStaging             ( const std::wstring_view       FileName
+                                                                    , staging_layout&               Layout
+                                                                    , std::vector<std::byte>&       Data
+                                                                    ) noexcept;
+
+                // Reorientation of uncompressed formats (all mips, faces and frames), width and height swap for 90/270
+                void                        Transpose               ( void
+                                                                    ) noexcept;
+                void                        Rotate                  ( rotation                      Rotation
+                                                                    ) noexcept;
+
+                // HDR cube maps (R16G16B16A16_SFLOAT or R32G32B32A32_FLOAT), faces in +X -X +Y -Y +Z -Z order
+                void                        CreateGGXSpecularCubemap( xbitmap&                      Dest
+                                                                    , int                           nMips    = -1   // -1 == getFullMipChainCount(), mip i has roughness i/(nMips-1)
+                                                                    , int                           nSamples = 64
+                                                                    ) const noexcept;
+                sh9                         ProjectSH9              ( int                           iFrame = 0      // cube map, or equirectangular for anything else
+                                                                    ) const noexcept;
+                void                        CreateIrradianceCubemap ( const sh9&                    SH
+                                                                    , std::uint32_t                 Size
+                                                                    , format                        Format = format::R32G32B32A32_FLOAT
+                                                                    ) noexcept;
+
+                // Environment map layouts (mip 0 of every frame, uncompressed formats), faces in +X -X +Y -Y +Z -Z order
+                void                        CreateCubemapFromEquirect( xbitmap&                     Dest
+                                                                    , std::uint32_t                 FaceSize = 0    // 0 == getWidth() / 4
+                                                                    , sample_filter                 Filter   = sample_filter::BICUBIC
+                                                                    ) const noexcept;
+                void                        CreateEquirectFromCubemap( xbitmap&                     Dest
+                                                                    , std::uint32_t                 Width    = 0    // 0 == 4 * face size, the height is half of it
+                                                                    , sample_filter                 Filter   = sample_filter::BICUBIC
+                                                                    ) const noexcept;
+
+                // Texels of uncompressed formats decoded to linear RGBA (missing channels read 0, alpha 1).
+                // getBilinearColor follows the wrap modes, xbitmap_sampler does the same for batches.
+                xcolorf                     getPixelColor           ( std::uint32_t                 X
+                                                                    , std::uint32_t                 Y
+                                                                    , int                           iMip   = 0
+                                                                    , int                           iFace  = 0
+                                                                    , int                           iFrame = 0
+                                                                    ) const noexcept;
+                xcolorf                     getBilinearColor        ( float                         U
+                                                                    , float                         V
+                                                                    , int                           iMip   = 0
+                                                                    , int                           iFace  = 0
+                                                                    , int                           iFrame = 0
+                                                                    ) const noexcept;
+
 /*
     void                    ConvertBitmap       ( s32 Bpp, xcolor::format Format );
     void                    ConvertBitmap       ( bitmap& Bitmap, s32 Bpp, xcolor::format Format ) const;    
 
     std::uint32_t                     GetPixel            ( s32 X, s32 Y, s32 Mip = 0 ) const;
     void                    SetPixel            ( s32 X, s32 Y, std::uint32_t Pixel, s32 Mip = 0 );
-    xcolor                  GetPixelColor       ( s32 X, s32 Y, s32 Mip = 0 ) const;
-    xcolor                  GetBilinearColor    ( f32 ParamU, f32 ParamV, bool Clamp=FALSE, s32 Mip = 0 ) const;
     void                    SetPixelColor       ( xcolor Color, s32 X, s32 Y, s32 Mip = 0 );
 */
 
@@ -403,11 +709,246 @@ public:
     std::uint16_t                   m_Width         { 0 };          // +2 width in pixels
     bit_pack_fields                 m_Flags         {};             // +2 all flags including the format of the bitmap
     std::uint8_t                    m_nMips         { 0 };          // +1 Number of mips
+    texel_layout                    m_Layout        { texel_layout::LINEAR }; // +1 Order of the texels inside the mips, not saved
     xcolori                         m_ClampColor    { ~0u };        // +4 a color to use for the wrapping modes 
                                                                     // 32 bytes total
 };
 static_assert( sizeof(xbitmap) == 32, "The bitmap structure should always be 32bytes long" );
 
+//----------------------------------------------------------------------------------------
+// Description:
+//     Collects the dirty rectangles of a bitmap being edited at runtime (paint tools,
+//     decals) and rebuilds only the affected part of its mip chain in the background.
+//     Rectangles are coalesced as they come in. The bitmap must be left alone from
+//     Flush until the rebuild is done (isBusy/Wait).
+//----------------------------------------------------------------------------------------
+class xbitmap_mip_updater
+{
+public:
+
+                                            xbitmap_mip_updater     ( void 
+                                                                    ) noexcept = default;
+                                           ~xbitmap_mip_updater     ( void
+                                                                    ) noexcept;
+                void                        MarkDirty               ( const xbitmap::rect&          Rect
+                                                                    ) noexcept;
+                void                        Flush                   ( xbitmap&                      Bitmap
+                                                                    ) noexcept;
+                void                        Wait                    ( void
+                                                                    ) noexcept;
+                bool                        isBusy                  ( void
+                                                                    ) const noexcept;
+    inline      std::span<const xbitmap::rect> getPending           ( void
+                                                                    ) const noexcept { return m_Pending; }
+
+protected:
+
+    std::vector<xbitmap::rect>      m_Pending       {};
+    std::future<void>               m_Work          {};
+};
+
+//----------------------------------------------------------------------------------------
+// Description:
+//     Bilinear sampling of one mip of a bitmap (uncompressed formats) for batches of UVs,
+//     texel centers at +0.5 like on the GPU. U and V follow the wrap modes of the bitmap,
+//     CLAMP_TO_COLOR reads m_ClampColor outside. The xcolori version is for 32 bit formats
+//     and blends the stored bytes with 8 bit fixed point weights, the xcolorf version
+//     takes any format and blends in linear space. The bitmap must outlive the sampler.
+//     Trilinear and anisotropic sampling walk the mip chain below the bound mip, the level
+//     of detail comes from the screen space derivatives of the UVs as on the GPU.
+//----------------------------------------------------------------------------------------
+class xbitmap_sampler
+{
+public:
+
+    using uv = std::array<float, 2>;
+
+    struct uv_derivatives
+    {
+        uv                      m_dUVdx;                                            // Change of the UV from one pixel to the next in X
+        uv                      m_dUVdy;                                            // Same in Y
+    };
+
+                                            xbitmap_sampler         ( void 
+                                                                    ) noexcept = default;
+    inline explicit                         xbitmap_sampler         ( const xbitmap&                Bitmap
+                                                                    , int                           iMip   = 0
+                                                                    , int                           iFace  = 0
+                                                                    , int                           iFrame = 0
+                                                                    ) noexcept { Bind( Bitmap, iMip, iFace, iFrame ); }
+                void                        Bind                    ( const xbitmap&                Bitmap
+                                                                    , int                           iMip   = 0
+                                                                    , int                           iFace  = 0
+                                                                    , int                           iFrame = 0
+                                                                    ) noexcept;
+                void                        SampleBilinear          ( std::span<const uv>           UVs
+                                                                    , std::span<xcolori>            Out
+                                                                    ) const noexcept;
+                void                        SampleBilinear          ( std::span<const uv>           UVs
+                                                                    , std::span<xcolorf>            Out
+                                                                    ) const noexcept;
+                void                        SampleTrilinear         ( std::span<const uv>           UVs
+                                                                    , std::span<const uv_derivatives> Derivatives
+                                                                    , std::span<xcolorf>            Out
+                                                                    ) const noexcept;
+                void                        SampleAnisotropic       ( std::span<const uv>           UVs         // Trilinear taps along the major axis of the footprint
+                                                                    , std::span<const uv_derivatives> Derivatives
+                                                                    , std::span<xcolorf>            Out
+                                                                    , int                           MaxAnisotropy = 16
+                                                                    ) const noexcept;
+
+protected:
+
+    const xbitmap*                  m_pBitmap       { nullptr };
+    int                             m_iMip          { 0 };
+    int                             m_iFace         { 0 };
+    int                             m_iFrame        { 0 };
+};
+
+//----------------------------------------------------------------------------------------
+// Description:
+//     Images past the xbitmap limits (65535 texels per side, 4 GiB per face) kept as a
+//     grid of single mip xbitmap tiles under one logical width and height. Level 0 is
+//     the image, the levels below are its mip chain with the same tile size. Tiles are
+//     created (zero filled) or read from the file given to Open when first touched, and
+//     Evict lets go of them again so only the working set stays in memory. Uncompressed
+//     formats only, the tiles are always row major.
+//----------------------------------------------------------------------------------------
+class xbitmap_tiled
+{
+public:
+
+                                            xbitmap_tiled           ( void 
+                                                                    ) noexcept = default;
+                                           ~xbitmap_tiled           ( void
+                                                                    ) noexcept;
+                                            xbitmap_tiled           ( const xbitmap_tiled& Src
+                                                                    ) noexcept = delete;
+                void                        Create                  ( std::uint32_t                 Width
+                                                                    , std::uint32_t                 Height
+                                                                    , xbitmap::format               Format     = xbitmap::format::XCOLOR
+                                                                    , std::uint32_t                 TileSize   = 4096
+                                                                    , xbitmap::color_space          ColorSpace = xbitmap::color_space::SRGB
+                                                                    ) noexcept;
+                void                        Kill                    ( void
+                                                                    ) noexcept;
+                xerr                        Open                    ( const std::wstring_view       FileName    // Keeps the file open, tiles are read on demand
+                                                                    ) noexcept;
+                xerr                        Save                    ( const std::wstring_view       FileName    // Not the file this one was opened from
+                                                                    ) const noexcept;
+    inline      void                        setSpillPath            ( const std::wstring_view       Directory   // Where the levels made here are written, the temp directory if empty
+                                                                    ) noexcept { m_SpillPath = Directory; }
+
+    inline      std::uint32_t               getWidth                ( int iLevel = 0 
+                                                                    ) const noexcept { return m_Levels[iLevel].m_Width; }
+    inline      std::uint32_t               getHeight               ( int iLevel = 0 
+                                                                    ) const noexcept { return m_Levels[iLevel].m_Height; }
+    inline      std::uint32_t               getTileCountX           ( int iLevel = 0 
+                                                                    ) const noexcept { return m_Levels[iLevel].m_nTilesX; }
+    inline      std::uint32_t               getTileCountY           ( int iLevel = 0 
+                                                                    ) const noexcept { return m_Levels[iLevel].m_nTilesY; }
+    inline      int                         getLevelCount           ( void 
+                                                                    ) const noexcept { return static_cast<int>( m_Levels.size() ); }
+    inline      std::uint32_t               getTileSize             ( void 
+                                                                    ) const noexcept { return m_TileSize; }
+    inline      xbitmap::format             getFormat               ( void 
+                                                                    ) const noexcept { return m_Format; }
+    inline      xbitmap::color_space        getColorSpace           ( void 
+                                                                    ) const noexcept { return m_ColorSpace; }
+                xbitmap::rect               getTileRect             ( std::uint32_t                 TileX       // In texels of the level
+                                                                    , std::uint32_t                 TileY
+                                                                    , int                           iLevel = 0
+                                                                    ) const noexcept;
+                xbitmap&                    getTile                 ( std::uint32_t                 TileX       // Safe to call from several threads
+                                                                    , std::uint32_t                 TileY
+                                                                    , int                           iLevel = 0
+                                                                    ) const noexcept;
+                bool                        isResident              ( std::uint32_t                 TileX
+                                                                    , std::uint32_t                 TileY
+                                                                    , int                           iLevel = 0
+                                                                    ) const noexcept;
+                void                        Evict                   ( std::uint32_t                 TileX       // Changes to a tile are lost unless saved first
+                                                                    , std::uint32_t                 TileY
+                                                                    , int                           iLevel = 0
+                                                                    ) noexcept;
+
+                // Copies between any rectangle of a level and a view of the same format and size
+                void                        ReadRegion              ( const xbitmap::rect&          Rect
+                                                                    , const xbitmap::view&          Dest
+                                                                    , int                           iLevel = 0
+                                                                    ) const noexcept;
+                void                        WriteRegion             ( const xbitmap::rect&          Rect
+                                                                    , const xbitmap::const_view&    Src
+                                                                    , int                           iLevel = 0
+                                                                    ) noexcept;
+
+                // Tiles are processed in parallel. Resize and GenerateMips filter across the tile edges, sRGB in linear space.
+                // The levels they make or convert from a file are written to a spill file a row of tiles at a time, then read back on demand
+                xerr                        Convert                 ( xbitmap::format               Format
+                                                                    ) noexcept;
+                xerr                        CreateResized           ( xbitmap_tiled&                Dest        // Level 0 only, same format and tile size
+                                                                    , std::uint32_t                 Width
+                                                                    , std::uint32_t                 Height
+                                                                    , xbitmap::mip_filter           Filter = xbitmap::mip_filter::MITCHELL
+                                                                    ) const noexcept;
+                xerr                        GenerateMips            ( int                           nLevels = -1  // -1 == down to 1x1
+                                                                    , xbitmap::mip_filter           Filter  = xbitmap::mip_filter::BOX
+                                                                    ) noexcept;
+
+protected:
+
+    enum class tile_state : std::uint8_t
+    { EMPTY
+    , LOADING                                                       // One thread is creating or reading it, the others wait
+    , RESIDENT
+    };
+
+    struct level
+    {
+        std::uint32_t                               m_Width         { 0 };
+        std::uint32_t                               m_Height        { 0 };
+        std::uint32_t                               m_nTilesX       { 0 };
+        std::uint32_t                               m_nTilesY       { 0 };
+        std::wstring                                m_FileName      {};     // Where the tiles of this level are kept, empty when only in memory
+        std::uint64_t                               m_FileOffset    { 0 };  // Where the tiles of this level start in the file
+        std::vector<xbitmap>                        m_Tiles         {};     // Row major, invalid until touched
+        std::unique_ptr<std::atomic<tile_state>[]>  m_State         {};     // One per tile, claims the tile while it is loaded
+        std::vector<std::FILE*>                     m_Handles       {};     // Read handles not in use, guarded by m_Mutex
+        bool                                        m_bSpilled      { false };  // m_FileName is a spill file deleted with the level
+    };
+
+                void                        AddLevel                ( std::uint32_t                 Width
+                                                                    , std::uint32_t                 Height
+                                                                    ) noexcept;
+                xerr                        ResampleLevel           ( const xbitmap_tiled&          Src
+                                                                    , int                           iSrcLevel
+                                                                    , int                           iDestLevel
+                                                                    , xbitmap::mip_filter           Filter
+                                                                    ) noexcept;
+                std::FILE*                  CreateSpillFile         ( std::wstring&                 FileName
+                                                                    ) const noexcept;
+                xerr                        SpillTileRow            ( level&                        Level
+                                                                    , std::uint32_t                 TileY
+                                                                    , std::FILE*                    pFile
+                                                                    ) const noexcept;
+                std::uint64_t               getTileFileOffset       ( std::uint32_t                 TileX
+                                                                    , std::uint32_t                 TileY
+                                                                    , int                           iLevel
+                                                                    ) const noexcept;
+                void                        ReleaseTile             ( level&                        Level
+                                                                    , std::size_t                   iTile
+                                                                    ) const noexcept;
+                void                        CloseLevel              ( level&                        Level
+                                                                    ) const noexcept;
+
+    mutable std::vector<level>      m_Levels        {};
+    mutable std::mutex              m_Mutex         {};             // Guards the pools of file handles
+    std::wstring                    m_SpillPath     {};
+    std::uint32_t                   m_TileSize      { 0 };
+    xbitmap::format                 m_Format        { xbitmap::format::INVALID };
+    xbitmap::color_space            m_ColorSpace    { xbitmap::color_space::SRGB };
+};
+
 //----------------------------------------------------------------------------------------
 
 #include "implementation/xbitmap_inline.h"